@@ -9,34 +9,46 @@
 
 #include <linux/limits.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <util/except.h>
 
 void tdn_host_log_trace(const char* format, ...) {
+    // keep the line together when logging from multiple threads
+    flockfile(stdout);
     printf("[*] ");
     va_list va;
     va_start(va, format);
     vprintf(format, va);
     va_end(va);
     printf("\n");
+    funlockfile(stdout);
 }
 
 void tdn_host_log_warn(const char* format, ...) {
+    // keep the line together when logging from multiple threads
+    flockfile(stdout);
     printf("[!] ");
     va_list va;
     va_start(va, format);
     vprintf(format, va);
     va_end(va);
     printf("\n");
+    funlockfile(stdout);
 }
 
 void tdn_host_log_error(const char* format, ...) {
+    // keep the line together when logging from multiple threads
+    flockfile(stdout);
     printf("[-] ");
     va_list va;
     va_start(va, format);
     vprintf(format, va);
     va_end(va);
     printf("\n");
+    funlockfile(stdout);
 }
 
 void tdn_host_printf(const char* format, ...) {
@@ -52,7 +64,7 @@ void tdn_host_vprintf(const char* format, va_list args) {
 }
 
 void* tdn_host_mallocz(size_t size, size_t align) {
-    void* ptr = malloc(size);
+    void* ptr = align > 16 ? aligned_alloc(align, ALIGN_UP(size, align)) : malloc(size);
     if (ptr == NULL) return NULL;
     memset(ptr, 0, size);
     return ptr;
@@ -83,6 +95,43 @@ void tdn_host_free_low(void* ptr) {
 
 }
 
+int tdn_host_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+typedef struct host_thread {
+    pthread_t thread;
+    void (*entry)(void* arg);
+    void* arg;
+} host_thread_t;
+
+static void* host_thread_entry(void* arg) {
+    host_thread_t* thread = arg;
+    thread->entry(thread->arg);
+    return NULL;
+}
+
+tdn_thread_t tdn_host_thread_start(void (*entry)(void* arg), void* arg) {
+    host_thread_t* thread = malloc(sizeof(host_thread_t));
+    if (thread == NULL) return NULL;
+    thread->entry = entry;
+    thread->arg = arg;
+
+    if (pthread_create(&thread->thread, NULL, host_thread_entry, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+
+    return thread;
+}
+
+void tdn_host_thread_join(tdn_thread_t _thread) {
+    host_thread_t* thread = _thread;
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
+
 size_t tdn_host_strnlen(const char* string, size_t maxlen) {
     return strnlen(string, maxlen);
 }
@@ -116,6 +165,25 @@ int tdn_host_read_file(tdn_file_t file, size_t offset, size_t size, void* buffer
     return 0;
 }
 
+const void* tdn_host_map_file(tdn_file_t file, size_t* out_size) {
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0 || st.st_size == 0) {
+        return NULL;
+    }
+
+    void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+
+    *out_size = st.st_size;
+    return ptr;
+}
+
+void tdn_host_unmap_file(const void* ptr, size_t size) {
+    munmap((void*)ptr, size);
+}
+
 void tdn_host_close_file(tdn_file_t file) {
     fclose(file);
 }
@@ -132,6 +200,11 @@ void tdn_host_gc_register_root(void* root) {
     (void)root;
 }
 
+void tdn_host_gc_register_root_range(void* roots, size_t count) {
+    (void)roots;
+    (void)count;
+}
+
 void tdn_host_gc_pin_object(void* object) {
 
 }
@@ -1,6 +1,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include "tomatodotnet/except.h"
 #include "util/except.h"
@@ -198,13 +199,18 @@ static tdn_err_t dump_type(RuntimeTypeInfo type, const char* method_to_dump) {
                    parameter->Attributes.In ? "in " : "",
                    parameter->Attributes.Out ? "out " : "");
             output_type_name(stdout, parameter->ParameterType, true);
-            if (parameter->Name != NULL) {
-                printf(" %U", parameter->Name);
+
+            String name;
+            CHECK_AND_RETHROW(tdn_get_parameter_name(parameter, &name));
+            if (name != NULL) {
+                printf(" %U", name);
             }
         }
         printf(")");
 
-        if (method->MethodBody != NULL) {
+        RuntimeMethodBody body;
+        CHECK_AND_RETHROW(tdn_get_method_body(method, &body));
+        if (body != NULL) {
             printf(" {\n");
 //            CHECK_AND_RETHROW(tdn_disasm_inst(method, ));
             TRACE("\t}");
@@ -223,25 +229,15 @@ cleanup:
 static tdn_err_t load_assembly_from_path(const char* filename, RuntimeAssembly* assembly) {
     tdn_err_t err = TDN_NO_ERROR;
     FILE* file = NULL;
-    void* image = NULL;
 
-    // load the test image
+    // open the image, the runtime will map it in place
     file = fopen(filename, "rb");
     CHECK_ERROR(file != NULL, -errno);
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    image = malloc(size);
-    CHECK_ERROR(image != NULL, -errno);
-    CHECK_ERROR(fread(image, size, 1, file) == 1, -errno);
-    fclose(file);
-    file = NULL;
-
-    // load the corelib
-    CHECK_AND_RETHROW(tdn_load_assembly_from_memory(image, size, assembly));
+
+    // load the assembly
+    CHECK_AND_RETHROW(tdn_load_assembly_from_file(file, assembly));
 
 cleanup:
-    free(image);
     if (file != NULL) fclose(file);
 
     return err;
@@ -267,7 +263,8 @@ int main(int argc, char* argv[]) {
     RuntimeAssembly corelib = NULL;
     CHECK_AND_RETHROW(load_assembly_from_path(argv[1], &corelib));
 
-    // now load the assembly we want to run
+    // now load the assembly we want to run, the assemblies it
+    // references are read and decoded in parallel
     RuntimeAssembly run = NULL;
     CHECK_AND_RETHROW(load_assembly_from_path(argv[3], &run));
 
@@ -281,6 +278,9 @@ int main(int argc, char* argv[]) {
 
     int (*entry_point)() = run->EntryPoint->MethodPtr;
     int tests_output = entry_point();
+
+    Object exception = tdn_jit_take_unhandled_exception();
+    CHECK(exception == NULL, "Unhandled exception of type %T", object_get_vtable(exception)->Type);
     TRACE("RETURNED = %d", tests_output);
 
 cleanup:
@@ -65,6 +65,13 @@ typedef struct tdn_il_inst {
         RuntimeFieldInfo field;
         RuntimeTypeInfo type;
         String string;
+        struct {
+            // the raw jump table, the targets are relative
+            // to the end of the instruction
+            const int32_t* offsets;
+            uint32_t count;
+            uint32_t base;
+        } switch_table;
     } operand;
     int operand_token;
 
@@ -79,6 +86,13 @@ const char* tdn_get_opcode_name(tdn_il_opcode_t opcode);
 
 tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t* inst);
 
+/**
+ * Get the pc of a target of a switch instruction
+ */
+static inline uint32_t tdn_get_switch_target(tdn_il_inst_t* inst, uint32_t index) {
+    return inst->operand.switch_table.base + inst->operand.switch_table.offsets[index];
+}
+
 /**
  * Convert to a more generic version for easier processing
  */
@@ -39,6 +39,7 @@ void tdn_host_map_rx(void* ptr, size_t size);
 // gc operation
 void* tdn_host_gc_alloc(size_t size, size_t alignment);
 void tdn_host_gc_register_root(void* root);
+void tdn_host_gc_register_root_range(void* roots, size_t count);
 void tdn_host_gc_pin_object(void* object);
 
 // used for debugging the jit, will dump spidir modules
@@ -48,6 +49,38 @@ void* tdn_host_jit_start_dump(void);
 void tdn_host_jit_end_dump(void* ctx);
 spidir_dump_status_t tdn_host_jit_dump_callback(const char* data, size_t size, void* ctx);
 
+// threading
+//
+// the loader runs some of its work on threads started with tdn_host_thread_start,
+// so the following must be safe to call from multiple threads at the same time:
+//  - the logging and raw logging functions
+//  - tdn_host_strnlen
+//  - tdn_host_mallocz, tdn_host_realloc and tdn_host_free
+//  - tdn_host_resolve_assembly, tdn_host_read_file, tdn_host_map_file and
+//    tdn_host_close_file, a single file is only ever used by one thread at
+//    a time, but different files are used concurrently while loading
+//
+// everything else (gc, mappings, jit dumps) is only called from the thread
+// that called into the runtime
+typedef void* tdn_thread_t;
+
+/**
+ * The amount of threads that can run at the same time, the runtime
+ * will not start more worker threads than this
+ */
+int tdn_host_cpu_count(void);
+
+/**
+ * Start a new thread that runs the given entry, return NULL if the thread
+ * can't be created, in which case the work is done on the calling thread
+ */
+tdn_thread_t tdn_host_thread_start(void (*entry)(void* arg), void* arg);
+
+/**
+ * Wait for a thread started with tdn_host_thread_start to exit and release it
+ */
+void tdn_host_thread_join(tdn_thread_t thread);
+
 // file management
 typedef void* tdn_file_t;
 
@@ -62,6 +95,18 @@ bool tdn_host_resolve_assembly(const char* name, uint16_t major_version, tdn_fil
  */
 int tdn_host_read_file(tdn_file_t file, size_t offset, size_t size, void* buffer);
 
+/**
+ * Map a file opened by tdn_host_resolve_assembly read-only into memory, the mapping
+ * must stay valid after the file is closed. Return NULL if the file can't be mapped,
+ * in which case the file will be read with tdn_host_read_file instead
+ */
+const void* tdn_host_map_file(tdn_file_t file, size_t* out_size);
+
+/**
+ * Unmap a mapping returned by tdn_host_map_file
+ */
+void tdn_host_unmap_file(const void* ptr, size_t size);
+
 /**
  * Close a file returned by tdn_host_resolve_assembly
  */
@@ -14,3 +14,9 @@ tdn_err_t tdn_jit_method(RuntimeMethodBase methodInfo);
  * that the vtable/itables are filled properly
  */
 tdn_err_t tdn_jit_type(RuntimeTypeInfo type);
+
+/**
+ * Take the exception that the managed code the host just called did not handle, NULL
+ * if it returned normally, must be checked after every call into managed code
+ */
+Object tdn_jit_take_unhandled_exception(void);
@@ -9,4 +9,29 @@
 
 tdn_err_t tdn_load_assembly_from_memory(const void* buffer, size_t buffer_size, RuntimeAssembly* assembly);
 
+/**
+ * Load the assembly in the given file, the assemblies it references are resolved
+ * by name and read and decoded in parallel like in tdn_load_assemblies
+ */
 tdn_err_t tdn_load_assembly_from_file(tdn_file_t file, RuntimeAssembly* assembly);
+
+/**
+ * Load a set of assemblies by name along side all the assemblies they reference. The whole
+ * reference graph is resolved first and the files are read and decoded in parallel, only
+ * adding them to the type system is done one at a time
+ */
+tdn_err_t tdn_load_assemblies(const char** names, const uint16_t* major_versions, size_t count, RuntimeAssembly* out_assemblies);
+
+/**
+ * Get the body of the method, bodies are only parsed when first needed so
+ * this must be used instead of reading MethodBody directly, the body is
+ * NULL for methods without one
+ */
+tdn_err_t tdn_get_method_body(RuntimeMethodBase method, RuntimeMethodBody* body);
+
+/**
+ * Get the name of the parameter, the name is only created when first needed
+ * so this must be used instead of reading Name directly, the name is NULL
+ * for parameters without one
+ */
+tdn_err_t tdn_get_parameter_name(ParameterInfo parameter, String* name);
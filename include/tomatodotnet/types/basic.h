@@ -18,6 +18,9 @@ typedef int32_t Int32;
 typedef int64_t Int64;
 typedef intptr_t IntPtr;
 
+typedef float Single;
+typedef double Double;
+
 typedef bool Boolean;
 typedef uint16_t Char;
 
@@ -39,6 +42,10 @@ typedef struct ObjectVTable {
     // checking quickly if implementing some type
     uint64_t InterfaceProduct;
 
+    // the dictionaries of the generic types in the hierarchy that
+    // share their code, indexed by the depth of the type
+    void*** GenericDictionaries;
+
     // the actual functions come now
     void* Functions[];
 } ObjectVTable;
@@ -52,7 +52,9 @@ typedef struct ParameterInfo {
     ParameterAttributes Attributes;
     RuntimeTypeInfo ParameterType;
     RuntimeMemberInfo Member;
-    String Name;
+
+    // created on first use, see tdn_get_parameter_name
+    _Atomic(String) Name;
     int Position;
     uint32_t IsReadOnly : 1;
     uint32_t : 31;
@@ -202,11 +204,6 @@ DEFINE_ARRAY(MethodBase)
 
 typedef struct RuntimeMethodInfo* RuntimeMethodInfo;
 
-typedef struct generic_method_instance {
-    size_t key;
-    RuntimeMethodInfo value;
-} generic_method_instance_t;
-
 // NOTE: does not exists, just used as a common type
 //       for our classes
 typedef struct RuntimeMethodBase {
@@ -215,13 +212,14 @@ typedef struct RuntimeMethodBase {
     ParameterInfo_Array Parameters;
     MethodAttributes Attributes;
     MethodImplAttributes MethodImplFlags;
-    RuntimeMethodBody MethodBody;
+
+    // parsed on first use, see tdn_get_method_body
+    _Atomic(RuntimeMethodBody) MethodBody;
     ParameterInfo ReturnParameter;
 
     // TODO: can we move this to be in RuntimeMethodInfo? do we want to?
     RuntimeTypeInfo_Array GenericArguments;
     RuntimeMethodInfo GenericMethodDefinition;
-    generic_method_instance_t* GenericMethodInstances;
 
     // The jitted method, this is what you want to call normally
     void* MethodPtr;
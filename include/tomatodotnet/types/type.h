@@ -62,11 +62,6 @@ typedef union GenericParameterAttributes {
     uint32_t value;
 } GenericParameterAttributes;
 
-typedef struct generic_type_instance {
-    size_t key;
-    RuntimeTypeInfo value;
-} generic_type_instance_t;
-
 typedef struct interface_impl {
     RuntimeTypeInfo key;
     int value;
@@ -101,7 +96,6 @@ typedef struct RuntimeTypeInfo {
 
     // The base of the type
     RuntimeTypeInfo BaseType;
-    generic_type_instance_t* GenericTypeInstances;
     RuntimeConstructorInfo TypeInitializer;
 
     // the interfaces this type implements
@@ -148,7 +142,8 @@ typedef struct RuntimeTypeInfo {
     uint32_t FillingVtable : 1;
     uint32_t EndFillingVtable : 1;
     uint32_t TypeInitStarted : 1;
-    uint32_t : 14;
+    uint32_t TypeInitFailed : 1;
+    uint32_t : 13;
     uint32_t QueuedTypeInit : 1;
     uint32_t IsGenericParameter : 1;
     uint32_t IsGenericTypeParameter : 1;
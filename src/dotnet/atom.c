@@ -0,0 +1,164 @@
+#include "atom.h"
+
+#include "tomatodotnet/host.h"
+#include "dotnet/gc/gc.h"
+#include "util/except.h"
+#include "util/string.h"
+#include "util/stb_ds.h"
+
+/**
+ * All the identifiers we have interned so far, the keys point directly into the
+ * #Strings heap of the assembly that first used the identifier, so the only
+ * copy of the name that we create is the String itself. The table keeps the
+ * precomputed hash of every key, so a lookup only hashes the probe once and never
+ * has to touch the UTF-16 data of the string.
+ *
+ * Atoms are never freed, not all of them are referenced from a reflection
+ * object (builtin names, names from a failed load), so they are rooted
+ */
+static struct {
+    const char* key;
+    String value;
+}* m_atoms = NULL;
+
+/**
+ * The heaps that atom keys point into, along with the
+ * atoms that use them, so a heap can be released
+ */
+typedef struct atom_heap {
+    const char* start;
+    size_t size;
+    int* atoms;
+} atom_heap_t;
+
+static atom_heap_t* m_atom_heaps = NULL;
+
+#define ATOM_ROOTS_CHUNK 256
+
+/**
+ * The atoms are rooted from chunks that never move, unlike the
+ * table itself which is reallocated as it grows
+ */
+static String* m_atom_roots = NULL;
+static size_t m_atom_roots_used = ATOM_ROOTS_CHUNK;
+
+static tdn_err_t atom_root(String atom) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    if (m_atom_roots_used == ATOM_ROOTS_CHUNK) {
+        String* chunk = tdn_host_mallocz(sizeof(String) * ATOM_ROOTS_CHUNK, _Alignof(String));
+        CHECK_ERROR(chunk != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        gc_register_root_range(chunk, ATOM_ROOTS_CHUNK);
+        m_atom_roots = chunk;
+        m_atom_roots_used = 0;
+    }
+
+    m_atom_roots[m_atom_roots_used++] = atom;
+
+cleanup:
+    return err;
+}
+
+static atom_heap_t* atom_find_heap(const char* ptr) {
+    for (int i = 0; i < arrlen(m_atom_heaps); i++) {
+        atom_heap_t* heap = &m_atom_heaps[i];
+        if (heap->start <= ptr && ptr < heap->start + heap->size) {
+            return heap;
+        }
+    }
+    return NULL;
+}
+
+void atom_register_heap(const char* heap, size_t heap_size) {
+    if (heap == NULL || atom_find_heap(heap) != NULL) {
+        return;
+    }
+
+    arrpush(m_atom_heaps, ((atom_heap_t){ .start = heap, .size = heap_size }));
+}
+
+tdn_err_t atom_intern(const char* cstr, String* out_atom) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // the empty name is always null
+    if (cstr[0] == '\0') {
+        *out_atom = NULL;
+        goto cleanup;
+    }
+
+    // check if we already have it
+    int idx = shgeti(m_atoms, cstr);
+    if (idx >= 0) {
+        *out_atom = m_atoms[idx].value;
+        goto cleanup;
+    }
+
+    // create and remember it
+    String atom = NULL;
+    CHECK_AND_RETHROW(tdn_create_string_from_cstr(cstr, &atom));
+    CHECK_AND_RETHROW(atom_root(atom));
+    shput(m_atoms, cstr, atom);
+
+    // remember which heap the key came from, names that are
+    // not from a heap (like the builtins) are never released
+    atom_heap_t* heap = atom_find_heap(cstr);
+    if (heap != NULL) {
+        arrpush(heap->atoms, shgeti(m_atoms, cstr));
+    }
+
+    *out_atom = atom;
+
+cleanup:
+    return err;
+}
+
+bool atom_lookup(const char* cstr, String* out_atom) {
+    if (cstr[0] == '\0') {
+        *out_atom = NULL;
+        return true;
+    }
+
+    if (m_atoms == NULL) {
+        return false;
+    }
+
+    int idx = shgeti(m_atoms, cstr);
+    if (idx < 0) {
+        return false;
+    }
+
+    *out_atom = m_atoms[idx].value;
+    return true;
+}
+
+void atom_release_heap(const char* heap, size_t heap_size) {
+    int heap_idx = -1;
+    for (int i = 0; i < arrlen(m_atom_heaps); i++) {
+        if (m_atom_heaps[i].start == heap) {
+            heap_idx = i;
+            break;
+        }
+    }
+
+    // nothing was interned from it
+    if (heap_idx < 0) {
+        return;
+    }
+
+    atom_heap_t* entry = &m_atom_heaps[heap_idx];
+    for (int i = 0; i < arrlen(entry->atoms); i++) {
+        int idx = entry->atoms[i];
+
+        // the hash and content stay the same, so we can just
+        // replace the key with a copy in place
+        const char* key = m_atoms[idx].key;
+        size_t len = strlen(key);
+        char* copy = tdn_host_mallocz(len + 1, 1);
+        ASSERT(copy != NULL);
+        memcpy(copy, key, len);
+        m_atoms[idx].key = copy;
+    }
+
+    arrfree(entry->atoms);
+    arrdelswap(m_atom_heaps, heap_idx);
+}
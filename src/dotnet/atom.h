@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tomatodotnet/except.h"
+#include "tomatodotnet/types/basic.h"
+
+/**
+ * Get the interned string for the given metadata identifier, creating it if this
+ * is the first time we see it. The same identifier always results in the same
+ * String object, so names that were interned can be compared by pointer.
+ *
+ * The identifier is referenced in place and not copied, so it must either live
+ * forever or be released with atom_release_heap before it is freed.
+ *
+ * An empty identifier is interned as NULL, same as tdn_create_string_from_cstr
+ */
+tdn_err_t atom_intern(const char* cstr, String* out_atom);
+
+/**
+ * Lookup the interned string of an identifier without creating it, returns false
+ * if the identifier was never interned, in which case nothing can be named by it
+ */
+bool atom_lookup(const char* cstr, String* out_atom);
+
+/**
+ * Register a #Strings heap that identifiers are going to be interned from, the
+ * atoms keyed by it are tracked so releasing the heap only touches them
+ */
+void atom_register_heap(const char* heap, size_t heap_size);
+
+/**
+ * Called before a #Strings heap is freed, any atom that still references
+ * the heap gets its own copy of the identifier so it stays valid
+ */
+void atom_release_heap(const char* heap, size_t heap_size);
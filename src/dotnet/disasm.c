@@ -5,6 +5,7 @@
 #include <util/string_builder.h>
 
 #include "gc/gc.h"
+#include "loader.h"
 #include "metadata/metadata.h"
 #include "metadata/metadata_tables.h"
 #include "metadata/sig.h"
@@ -67,10 +68,30 @@ const char* tdn_get_opcode_name(tdn_il_opcode_t opcode) {
     }
 }
 
+/**
+ * Types are only filled on first use, a method operand means the jit is about
+ * to call it so its owner and signature need to be ready
+ */
+static tdn_err_t init_method_types(RuntimeMethodBase method) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK_AND_RETHROW(tdn_type_init(method->DeclaringType));
+    CHECK_AND_RETHROW(tdn_type_init(method->ReturnParameter->ParameterType));
+    for (int i = 0; i < method->Parameters->Length; i++) {
+        CHECK_AND_RETHROW(tdn_type_init(method->Parameters->Elements[i]->ParameterType));
+    }
+
+cleanup:
+    return err;
+}
+
 tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t* inst) {
     tdn_err_t err = TDN_NO_ERROR;
     RuntimeAssembly assembly = method->Module->Assembly;
+
+    CHECK_AND_RETHROW(tdn_method_load_body(method));
     RuntimeMethodBody body = method->MethodBody;
+    CHECK(body != NULL);
 
     uint32_t start_pc = pc;
     memset(inst, 0, sizeof(*inst));
@@ -107,6 +128,10 @@ tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t*
                     assembly, inst->operand_token,
                     method->DeclaringType->GenericArguments, method->GenericArguments,
                     &inst->operand.field));
+
+            // the jit is about to use the field, make sure its types are filled
+            CHECK_AND_RETHROW(tdn_type_init(inst->operand.field->DeclaringType));
+            CHECK_AND_RETHROW(tdn_type_init(inst->operand.field->FieldType));
         } break;
 
         case InlineI: {
@@ -126,6 +151,7 @@ tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t*
                     assembly, inst->operand_token,
                     method->DeclaringType->GenericArguments, method->GenericArguments,
                     &inst->operand.method));
+            CHECK_AND_RETHROW(init_method_types(inst->operand.method));
         } break;
 
         case InlineNone: {
@@ -182,8 +208,20 @@ tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t*
             inst->operand.string = string;
         } break;
 
-        case InlineSwitch:
-            CHECK_FAIL("TODO: InlineSwitch");
+        case InlineSwitch: {
+            inst->operand_type = TDN_IL_SWITCH;
+            uint32_t count = FETCH(uint32_t);
+            CHECK(count <= (body->ILSize - pc) / sizeof(int32_t));
+            inst->operand.switch_table.offsets = (const int32_t*)&body->IL[pc];
+            inst->operand.switch_table.count = count;
+            pc += count * sizeof(int32_t);
+            inst->operand.switch_table.base = pc;
+
+            // make sure all the targets are inside the method
+            for (uint32_t i = 0; i < count; i++) {
+                CHECK(tdn_get_switch_target(inst, i) < body->ILSize);
+            }
+        } break;
 
         case InlineTok: {
             inst->operand_type = TDN_IL_TYPE;
@@ -192,6 +230,7 @@ tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t*
                     assembly, inst->operand_token,
                     method->DeclaringType->GenericArguments, method->GenericArguments,
                     &inst->operand.type));
+            CHECK_AND_RETHROW(tdn_type_init(inst->operand.type));
         } break;
 
         case InlineType: {
@@ -201,6 +240,7 @@ tdn_err_t tdn_disasm_inst(RuntimeMethodBase method, uint32_t pc, tdn_il_inst_t*
                     assembly, inst->operand_token,
                     method->DeclaringType->GenericArguments, method->GenericArguments,
                     &inst->operand.type));
+            CHECK_AND_RETHROW(tdn_type_init(inst->operand.type));
         } break;
 
         case InlineVar: {
@@ -292,15 +332,15 @@ void tdn_normalize_inst(tdn_il_inst_t* inst) {
         case CEE_LDELEM_U1: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tByte; break;
         case CEE_LDELEM_U2: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tUInt16; break;
         case CEE_LDELEM_U4: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tUInt32; break;
-        case CEE_LDELEM_R4: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = NULL; break;
-        case CEE_LDELEM_R8: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = NULL; break;
+        case CEE_LDELEM_R4: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSingle; break;
+        case CEE_LDELEM_R8: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tDouble; break;
         case CEE_LDELEM_I: inst->opcode = CEE_LDELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tIntPtr; break;
         case CEE_STELEM_I1: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSByte; break;
         case CEE_STELEM_I2: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt16; break;
         case CEE_STELEM_I4: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt32; break;
         case CEE_STELEM_I8: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt64; break;
-//        case CEE_STELEM_R4: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = NULL; break;
-//        case CEE_STELEM_R8: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = NULL; break;
+        case CEE_STELEM_R4: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSingle; break;
+        case CEE_STELEM_R8: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tDouble; break;
         case CEE_STELEM_I: inst->opcode = CEE_STELEM; inst->operand_type = TDN_IL_TYPE; inst->operand.type = tIntPtr; break;
 
         case CEE_LDIND_I1: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSByte; break;
@@ -310,11 +350,15 @@ void tdn_normalize_inst(tdn_il_inst_t* inst) {
         case CEE_LDIND_U1: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tByte; break;
         case CEE_LDIND_U2: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tUInt16; break;
         case CEE_LDIND_U4: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tUInt32; break;
+        case CEE_LDIND_R4: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSingle; break;
+        case CEE_LDIND_R8: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tDouble; break;
 
         case CEE_STIND_I1: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSByte; break;
         case CEE_STIND_I2: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt16; break;
         case CEE_STIND_I4: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt32; break;
         case CEE_STIND_I8: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tInt64; break;
+        case CEE_STIND_R4: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tSingle; break;
+        case CEE_STIND_R8: inst->operand_type = TDN_IL_TYPE; inst->operand.type = tDouble; break;
 
         case CEE_LEAVE_S: inst->opcode = CEE_LEAVE; break;
         default: break;
@@ -380,7 +424,13 @@ int tdn_disasm_print_start(RuntimeMethodBody body, uint32_t pc, tdn_il_inst_t in
         } break;
 
         case TDN_IL_STRING: tdn_host_printf(" %U", inst.operand.string); break;
-        case TDN_IL_SWITCH: ASSERT(!"TODO: switch");
+        case TDN_IL_SWITCH: {
+            tdn_host_printf(" (");
+            for (uint32_t i = 0; i < inst.operand.switch_table.count; i++) {
+                tdn_host_printf(i == 0 ? "IL_%04x" : ", IL_%04x", tdn_get_switch_target(&inst, i));
+            }
+            tdn_host_printf(")");
+        } break;
     }
     tdn_host_printf("\n");
 
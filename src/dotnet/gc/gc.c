@@ -58,3 +58,9 @@ void* gc_raw_alloc(size_t size) {
 void gc_register_root(void* ptr) {
     tdn_host_gc_register_root(ptr);
 }
+
+void gc_register_root_range(void* ptr, size_t count) {
+    if (count != 0) {
+        tdn_host_gc_register_root_range(ptr, count);
+    }
+}
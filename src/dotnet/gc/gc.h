@@ -9,6 +9,11 @@ void* gc_raw_alloc(size_t size);
 
 void gc_register_root(void* ptr);
 
+/**
+ * Register count consecutive object references starting at ptr as roots
+ */
+void gc_register_root_range(void* ptr, size_t count);
+
 #define GC_NEW(type) \
     ({ \
         type ___ptr = gc_new(t##type, sizeof(struct type)); \
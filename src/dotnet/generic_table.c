@@ -0,0 +1,370 @@
+#include "generic_table.h"
+
+#include <stdatomic.h>
+
+#include "tomatodotnet/host.h"
+#include "util/except.h"
+#include "util/alloc.h"
+#include "util/defs.h"
+#include "util/stb_ds.h"
+#include "util/string.h"
+
+typedef enum generic_entry_state {
+    // the instance is still being created by the owner
+    GENERIC_ENTRY_PENDING,
+
+    // the instance is ready to be used by everyone
+    GENERIC_ENTRY_READY,
+
+    // creating the instance failed, the entry is ignored
+    GENERIC_ENTRY_FAILED,
+} generic_entry_state_t;
+
+typedef struct generic_table_thread {
+    // the pending entry this thread waits for, used to
+    // find threads that wait for each other
+    _Atomic(struct generic_entry*) waiting_for;
+} generic_table_thread_t;
+
+/**
+ * An instantiation, only the state changes once it is added to the table. The
+ * arguments are copied so the key does not depend on the managed array of the instance
+ */
+typedef struct generic_entry {
+    void* definition;
+    void* instance;
+    size_t hash;
+    _Atomic(generic_entry_state_t) state;
+
+    // the thread that creates the instance, it may see it while pending
+    generic_table_thread_t* owner;
+
+    // links failed entries that wait to be freed
+    struct generic_entry* next_retired;
+
+    size_t args_count;
+    RuntimeTypeInfo args[];
+} generic_entry_t;
+
+/**
+ * The chain nodes belong to a single bucket array, so growing the table
+ * never touches a chain that a reader might be walking right now
+ */
+typedef struct generic_node {
+    struct generic_node* next;
+    generic_entry_t* entry;
+} generic_node_t;
+
+typedef struct generic_table {
+    size_t mask;
+    size_t count;
+
+    // links old tables that wait to be freed
+    struct generic_table* next_retired;
+
+    // the nodes are allocated along side the table, enough for
+    // a load factor of 3/4, so adding never allocates
+    size_t capacity;
+    generic_node_t* nodes;
+
+    _Atomic(generic_node_t*) buckets[];
+} generic_table_t;
+
+#define GENERIC_TABLE_INITIAL_SIZE 256
+
+/**
+ * The current table, readers only ever load it and walk the chains
+ */
+static _Atomic(generic_table_t*) m_generic_table = NULL;
+
+/**
+ * The amount of threads that are inside of the table right now, old tables and
+ * failed entries are only freed once nobody else might still be walking them
+ */
+static atomic_size_t m_generic_table_users = 0;
+
+/**
+ * Old tables and failed entries dropped by a rebuild, protected by the lock
+ */
+static generic_table_t* m_retired_tables = NULL;
+static generic_entry_t* m_retired_entries = NULL;
+
+/**
+ * Serializes the writers, nothing is allocated while it is held
+ */
+static atomic_flag m_generic_table_lock = ATOMIC_FLAG_INIT;
+
+static _Thread_local generic_table_thread_t m_generic_table_thread;
+
+static void generic_table_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&m_generic_table_lock, memory_order_acquire)) {
+        CPU_RELAX();
+    }
+}
+
+static void generic_table_unlock(void) {
+    atomic_flag_clear_explicit(&m_generic_table_lock, memory_order_release);
+}
+
+/**
+ * Start using the table, the returned table and everything reachable
+ * from it stays valid until generic_table_leave
+ */
+static generic_table_t* generic_table_enter(void) {
+    // sequentially consistent, so a rebuild either sees us
+    // or we see the table that it published
+    atomic_fetch_add(&m_generic_table_users, 1);
+    return atomic_load(&m_generic_table);
+}
+
+static void generic_table_leave(void) {
+    atomic_fetch_sub_explicit(&m_generic_table_users, 1, memory_order_release);
+}
+
+static size_t generic_hash(void* definition, RuntimeTypeInfo_Array args) {
+    return stbds_hash_bytes(args->Elements, sizeof(RuntimeTypeInfo) * args->Length, (size_t)definition);
+}
+
+static bool generic_entry_matches(generic_entry_t* entry, size_t hash, void* definition, RuntimeTypeInfo_Array args) {
+    return entry->hash == hash &&
+            entry->definition == definition &&
+            entry->args_count == args->Length &&
+            memcmp(entry->args, args->Elements, sizeof(RuntimeTypeInfo) * args->Length) == 0 &&
+            atomic_load_explicit(&entry->state, memory_order_acquire) != GENERIC_ENTRY_FAILED;
+}
+
+static generic_entry_t* generic_table_find(generic_table_t* table, size_t hash, void* definition, RuntimeTypeInfo_Array args) {
+    if (table == NULL) {
+        return NULL;
+    }
+
+    generic_node_t* node = atomic_load_explicit(&table->buckets[hash & table->mask], memory_order_acquire);
+    while (node != NULL) {
+        if (generic_entry_matches(node->entry, hash, definition, args)) {
+            return node->entry;
+        }
+        node = node->next;
+    }
+
+    return NULL;
+}
+
+void* generic_table_lookup(void* definition, RuntimeTypeInfo_Array args) {
+    size_t hash = generic_hash(definition, args);
+    void* instance = NULL;
+
+    generic_table_t* table = generic_table_enter();
+    generic_entry_t* entry = generic_table_find(table, hash, definition, args);
+    if (entry != NULL && atomic_load_explicit(&entry->state, memory_order_acquire) == GENERIC_ENTRY_READY) {
+        instance = entry->instance;
+    }
+    generic_table_leave();
+
+    return instance;
+}
+
+static void generic_table_add_node(generic_table_t* table, generic_entry_t* entry) {
+    generic_node_t* node = &table->nodes[table->count++];
+    node->entry = entry;
+
+    // publish the node, it is fully initialized by now
+    _Atomic(generic_node_t*)* bucket = &table->buckets[entry->hash & table->mask];
+    node->next = atomic_load_explicit(bucket, memory_order_relaxed);
+    atomic_store_explicit(bucket, node, memory_order_release);
+}
+
+static generic_table_t* generic_table_alloc(size_t size) {
+    size_t capacity = size / 4 * 3;
+    generic_table_t* table = tdn_mallocz(
+        sizeof(generic_table_t) +
+        sizeof(generic_node_t*) * size +
+        sizeof(generic_node_t) * capacity);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->mask = size - 1;
+    table->capacity = capacity;
+    table->nodes = (generic_node_t*)&table->buckets[size];
+    return table;
+}
+
+static void generic_table_rebuild(generic_table_t* table, generic_table_t* new_table) {
+    // rebuild all the chains in the new table, nobody can see it yet,
+    // failed entries are dropped on the way and freed with the old table
+    for (size_t i = 0; i <= table->mask; i++) {
+        generic_node_t* node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+        while (node != NULL) {
+            generic_entry_t* entry = node->entry;
+            if (atomic_load_explicit(&entry->state, memory_order_acquire) != GENERIC_ENTRY_FAILED) {
+                generic_table_add_node(new_table, entry);
+            } else {
+                entry->next_retired = m_retired_entries;
+                m_retired_entries = entry;
+            }
+            node = node->next;
+        }
+    }
+
+    table->next_retired = m_retired_tables;
+    m_retired_tables = table;
+}
+
+static void generic_table_free_retired(generic_table_t* tables, generic_entry_t* entries) {
+    while (tables != NULL) {
+        generic_table_t* next = tables->next_retired;
+        tdn_host_free(tables);
+        tables = next;
+    }
+
+    while (entries != NULL) {
+        generic_entry_t* next = entries->next_retired;
+        tdn_host_free(entries);
+        entries = next;
+    }
+}
+
+/**
+ * Check if waiting for an entry of the given owner would wait for ourselves, either
+ * because the owner waits for us, or for another thread that eventually does
+ */
+static bool generic_table_would_deadlock(generic_table_thread_t* self, generic_table_thread_t* owner) {
+    while (owner != NULL) {
+        if (owner == self) {
+            return true;
+        }
+
+        generic_entry_t* waiting_for = atomic_load_explicit(&owner->waiting_for, memory_order_acquire);
+        if (waiting_for == NULL) {
+            break;
+        }
+
+        owner = waiting_for->owner;
+    }
+
+    return false;
+}
+
+tdn_err_t generic_table_insert(void* definition, RuntimeTypeInfo_Array args, void* instance, void** out_instance) {
+    tdn_err_t err = TDN_NO_ERROR;
+    generic_table_thread_t* self = &m_generic_table_thread;
+    generic_table_t* new_table = NULL;
+    generic_table_t* retired_tables = NULL;
+    generic_entry_t* retired_entries = NULL;
+    bool locked = false;
+
+    generic_table_enter();
+
+    size_t hash = generic_hash(definition, args);
+
+    // prepare the entry before taking the lock
+    generic_entry_t* entry = tdn_mallocz(sizeof(generic_entry_t) + sizeof(RuntimeTypeInfo) * args->Length);
+    CHECK_ERROR(entry != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    entry->definition = definition;
+    entry->instance = instance;
+    entry->hash = hash;
+    entry->owner = self;
+    entry->args_count = args->Length;
+    memcpy(entry->args, args->Elements, sizeof(RuntimeTypeInfo) * args->Length);
+
+    for (;;) {
+        generic_table_lock();
+        locked = true;
+
+        // someone might have beaten us to it
+        generic_table_t* table = atomic_load_explicit(&m_generic_table, memory_order_relaxed);
+        generic_entry_t* existing = generic_table_find(table, hash, definition, args);
+        if (existing != NULL) {
+            // the creator sees its own pending instance, needed for
+            // recursive expansion, everyone else waits for it
+            if (atomic_load_explicit(&existing->state, memory_order_acquire) == GENERIC_ENTRY_READY || existing->owner == self) {
+                *out_instance = existing->instance;
+                goto cleanup;
+            }
+
+            generic_table_unlock();
+            locked = false;
+
+            // the owner might be waiting for something that we are creating, in
+            // which case we see its pending instance, like the recursive case
+            atomic_store_explicit(&self->waiting_for, existing, memory_order_release);
+            while (atomic_load_explicit(&existing->state, memory_order_acquire) == GENERIC_ENTRY_PENDING) {
+                if (generic_table_would_deadlock(self, existing->owner)) {
+                    atomic_store_explicit(&self->waiting_for, NULL, memory_order_release);
+                    *out_instance = existing->instance;
+                    goto cleanup;
+                }
+                CPU_RELAX();
+            }
+            atomic_store_explicit(&self->waiting_for, NULL, memory_order_release);
+            continue;
+        }
+
+        if (table != NULL && table->count < table->capacity) {
+            generic_table_add_node(table, entry);
+            entry = NULL;
+            *out_instance = instance;
+            goto cleanup;
+        }
+
+        // the table is full, allocate a bigger one without holding the lock
+        size_t size = table == NULL ? GENERIC_TABLE_INITIAL_SIZE : (table->mask + 1) * 2;
+        generic_table_unlock();
+        locked = false;
+
+        new_table = generic_table_alloc(size);
+        CHECK_ERROR(new_table != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+        generic_table_lock();
+        locked = true;
+
+        // someone else might have grown it in the meanwhile, in
+        // which case just try again with their table
+        if (atomic_load_explicit(&m_generic_table, memory_order_relaxed) == table) {
+            if (table != NULL) {
+                generic_table_rebuild(table, new_table);
+            }
+
+            // and now let the readers use it
+            atomic_store(&m_generic_table, new_table);
+            new_table = NULL;
+
+            // if we are the only one inside then nobody can still walk the
+            // retired tables, anyone that comes later sees the new table
+            if (atomic_load(&m_generic_table_users) == 1) {
+                retired_tables = m_retired_tables;
+                retired_entries = m_retired_entries;
+                m_retired_tables = NULL;
+                m_retired_entries = NULL;
+            }
+        }
+
+        generic_table_unlock();
+        locked = false;
+
+        tdn_host_free(new_table);
+        new_table = NULL;
+        generic_table_free_retired(retired_tables, retired_entries);
+        retired_tables = NULL;
+        retired_entries = NULL;
+    }
+
+cleanup:
+    if (locked) {
+        generic_table_unlock();
+    }
+    generic_table_leave();
+    tdn_host_free(new_table);
+    tdn_host_free(entry);
+
+    return err;
+}
+
+void generic_table_publish(void* definition, RuntimeTypeInfo_Array args, void* instance, bool created) {
+    size_t hash = generic_hash(definition, args);
+    generic_table_t* table = generic_table_enter();
+    generic_entry_t* entry = generic_table_find(table, hash, definition, args);
+    ASSERT(entry != NULL && entry->instance == instance && entry->owner == &m_generic_table_thread);
+    atomic_store_explicit(&entry->state, created ? GENERIC_ENTRY_READY : GENERIC_ENTRY_FAILED, memory_order_release);
+    generic_table_leave();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "tomatodotnet/except.h"
+#include "tomatodotnet/types/type.h"
+
+/**
+ * Lookup the instantiation of a generic definition (either a type or a method) with the
+ * given arguments, returns NULL if it was not created yet. The lookup takes no locks
+ * so it can be done from any thread at any time
+ */
+void* generic_table_lookup(void* definition, RuntimeTypeInfo_Array args);
+
+/**
+ * Add the instantiation of a generic definition with the given arguments, the instance
+ * stays pending and only the calling thread can see it until it is published. If someone
+ * else added the same instantiation in the meanwhile then the existing instantiation
+ * is returned (waiting for it to be published first) and the new one should be dropped,
+ * if its creator waits for us then it is returned while pending instead of deadlocking
+ */
+tdn_err_t generic_table_insert(void* definition, RuntimeTypeInfo_Array args, void* instance, void** out_instance);
+
+/**
+ * Finish an instantiation added by generic_table_insert on this thread, if it was created
+ * it becomes visible to everyone, otherwise it is removed so it can be created again
+ */
+void generic_table_publish(void* definition, RuntimeTypeInfo_Array args, void* instance, bool created);
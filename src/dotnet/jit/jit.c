@@ -7,6 +7,7 @@
 
 #include "jit_basic_block.h"
 #include "jit_emit.h"
+#include "jit_helpers.h"
 #include "jit_verify.h"
 
 static void jit_spidir_log_callback(spidir_log_level_t level, const char* module, size_t module_len, const char* message, size_t message_len) {
@@ -33,6 +34,7 @@ void jit_queue_cctor(jit_cctor_t type) {
 static void jit_call_cctors() {
     for (int i = 0; i < arrlen(m_jit_cctors_to_run); i++) {
         m_jit_cctors_to_run[i]();
+        jit_check_unhandled_exception();
     }
 
     arrfree(m_jit_cctors_to_run);
@@ -68,6 +70,10 @@ cleanup:
     return err;
 }
 
+Object tdn_jit_take_unhandled_exception(void) {
+    return jit_take_pending_exception();
+}
+
 // TODO: protect with a lock, only one assembly/method/type can be jitted at any given time
 //       this ensures easier ordering between different jitting sessions
 
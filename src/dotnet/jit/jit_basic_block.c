@@ -1,55 +1,35 @@
 #include "jit_basic_block.h"
 
 #include <tomatodotnet/disasm.h>
-#include <util/alloc.h>
 #include <util/except.h>
 #include <util/stb_ds.h>
 #include <util/string.h>
 
-static void swap_basic_blocks(jit_basic_block_t** a, jit_basic_block_t** b) {
-    jit_basic_block_t* temp = *a;
-    *a = *b;
-    *b = temp;
-}
+typedef struct leaders {
+    // a bit for every pc that starts a basic block
+    uint64_t* bits;
 
-static int partition_basic_blocks(jit_basic_block_t* arr[], int low, int high) {
-    uint32_t p = arr[low]->start;
-    int i = low;
-    int j = high;
+    // the amount of bits that are set
+    size_t count;
+} leaders_t;
 
-    while (i < j) {
-        while (arr[i]->start <= p && i <= high - 1) {
-            i++;
-        }
+static tdn_err_t mark_leader(RuntimeMethodBody body, leaders_t* leaders, uint32_t pc) {
+    tdn_err_t err = TDN_NO_ERROR;
 
-        while (arr[j]->start > p && j >= low + 1) {
-            j--;
-        }
-        if (i < j) {
-            swap_basic_blocks(&arr[i], &arr[j]);
-        }
-    }
-    swap_basic_blocks(&arr[low], &arr[j]);
-    return j;
-}
+    CHECK(pc < body->ILSize);
 
-static void sort_basic_blocks(jit_basic_block_t* arr[], int low, int high) {
-    if (low < high) {
-        int pi = partition_basic_blocks(arr, low, high);
-        sort_basic_blocks(arr, low, pi - 1);
-        sort_basic_blocks(arr, pi + 1, high);
+    uint64_t mask = 1ull << (pc % 64);
+    if ((leaders->bits[pc / 64] & mask) == 0) {
+        leaders->bits[pc / 64] |= mask;
+        leaders->count++;
     }
-}
 
-static void jit_add_basic_block(jit_method_t* method, uint32_t pc) {
-    if (hmgeti(method->labels, pc) < 0) {
-        jit_basic_block_t* block = tdn_mallocz(sizeof(jit_basic_block_t));
-        block->start = pc;
-        block->end = -1;
+cleanup:
+    return err;
+}
 
-        arrpush(method->basic_blocks, block);
-        hmput(method->labels, pc, block);
-    }
+static bool is_leader(leaders_t* leaders, uint32_t pc) {
+    return (leaders->bits[pc / 64] & (1ull << (pc % 64))) != 0;
 }
 
 tdn_err_t jit_find_basic_blocks(jit_method_t* jmethod) {
@@ -57,8 +37,16 @@ tdn_err_t jit_find_basic_blocks(jit_method_t* jmethod) {
     RuntimeMethodBase method = jmethod->method;
     RuntimeMethodBody body = method->MethodBody;
 
+    // the bitmap is only needed while we are here, but its
+    // cheaper to just get it from the session's memory
+    leaders_t leaders = {
+        .bits = jit_alloc((body->ILSize + 63) / 64 * sizeof(uint64_t))
+    };
+    CHECK_ERROR(leaders.bits != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
     // the first block always exists
-    jit_add_basic_block(jmethod, 0);
+    CHECK(body->ILSize > 0);
+    CHECK_AND_RETHROW(mark_leader(body, &leaders, 0));
 
     //
     // add all the finally/filter/fault/catch regions
@@ -66,49 +54,68 @@ tdn_err_t jit_find_basic_blocks(jit_method_t* jmethod) {
     if (body->ExceptionHandlingClauses != NULL) {
         for (int i = 0; i < body->ExceptionHandlingClauses->Length; i++) {
             RuntimeExceptionHandlingClause clause = body->ExceptionHandlingClauses->Elements[i];
-            jit_add_basic_block(jmethod, clause->HandlerOffset);
+            CHECK_AND_RETHROW(mark_leader(body, &leaders, clause->HandlerOffset));
             if (clause->Flags == COR_ILEXCEPTION_CLAUSE_FILTER) {
-                jit_add_basic_block(jmethod, clause->FilterOffset);
+                CHECK_AND_RETHROW(mark_leader(body, &leaders, clause->FilterOffset));
             }
         }
     }
 
-    // go over the opcodes
+    // go over the opcodes, decode them and mark all the leaders
     uint32_t pc = 0;
     while (pc < body->ILSize) {
-        // get the instruction and normalize it for easier processing
+        // get the instruction and save it for the verifier and emitter,
+        // and normalize it for easier processing
         tdn_il_inst_t inst;
         CHECK_AND_RETHROW(tdn_disasm_inst(method, pc, &inst));
+        arrpush(jmethod->insts, inst);
         tdn_normalize_inst(&inst);
         pc += inst.length;
 
         // check for basic blocks created by
         if (inst.control_flow == TDN_IL_CF_BRANCH) {
-            jit_add_basic_block(jmethod, inst.operand.branch_target);
+            CHECK_AND_RETHROW(mark_leader(body, &leaders, inst.operand.branch_target));
         } else if (inst.control_flow == TDN_IL_CF_COND_BRANCH) {
-            // and now add the new blocks, make sure the basic block at the current PC
-            // will
-            jit_add_basic_block(jmethod, inst.operand.branch_target);
-            jit_add_basic_block(jmethod, pc);
-        }
+            if (inst.operand_type == TDN_IL_SWITCH) {
+                for (uint32_t i = 0; i < inst.operand.switch_table.count; i++) {
+                    CHECK_AND_RETHROW(mark_leader(body, &leaders, tdn_get_switch_target(&inst, i)));
+                }
+            } else {
+                CHECK_AND_RETHROW(mark_leader(body, &leaders, inst.operand.branch_target));
+            }
 
-        // TODO: support for switch
+            // the fallthrough starts a block as well, unless this is the last
+            // instruction, in which case the verifier will complain about it
+            if (pc < body->ILSize) {
+                CHECK_AND_RETHROW(mark_leader(body, &leaders, pc));
+            }
+        }
     }
 
-    // sort the basic blocks
-    sort_basic_blocks(jmethod->basic_blocks, 0, arrlen(jmethod->basic_blocks) - 1);
-
-    // rebuild the labels lookup and fill in the
-    // end of each basic block
-    hmfree(jmethod->labels);
-    for (int i = 0; i < arrlen(jmethod->basic_blocks); i++) {
-        if (i != arrlen(jmethod->basic_blocks) - 1) {
-            jmethod->basic_blocks[i]->end = jmethod->basic_blocks[i + 1]->start;
-        } else {
-            jmethod->basic_blocks[i]->end = body->ILSize;
+    // now create the blocks in order, every leader must be
+    // the start of an instruction
+    jit_basic_block_t* block = NULL;
+    pc = 0;
+    for (uint32_t i = 0; i < arrlen(jmethod->insts); i++) {
+        if (is_leader(&leaders, pc)) {
+            if (block != NULL) {
+                block->end = pc;
+            }
+
+            block = jit_alloc(sizeof(jit_basic_block_t));
+            CHECK_ERROR(block != NULL, TDN_ERROR_OUT_OF_MEMORY);
+            block->start = pc;
+            block->first_inst = i;
+
+            arrpush(jmethod->basic_blocks, block);
+            hmput(jmethod->labels, pc, block);
         }
-        hmput(jmethod->labels, jmethod->basic_blocks[i]->start, jmethod->basic_blocks[i]);
+
+        pc += jmethod->insts[i].length;
     }
+    block->end = body->ILSize;
+
+    CHECK(arrlen(jmethod->basic_blocks) == leaders.count, "block starts mid-instruction");
 
 cleanup:
     return err;
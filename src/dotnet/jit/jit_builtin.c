@@ -1,5 +1,6 @@
 #include "jit_builtin.h"
 
+#include <dotnet/atom.h>
 #include <dotnet/types.h>
 #include <tomatodotnet/types/type.h>
 #include <util/except.h>
@@ -12,7 +13,7 @@
 // System.Object
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void emit_object_get_type(spidir_builder_handle_t builder) {
+static void emit_object_get_type(spidir_builder_handle_t builder, RuntimeMethodBase method) {
     // get the object
     spidir_value_t arg0 = spidir_builder_build_param_ref(builder, 0);
 
@@ -32,12 +33,12 @@ static void emit_object_get_type(spidir_builder_handle_t builder) {
 // System.Runtime.CompilerServices.Unsafe
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void emit_unsafe_as(spidir_builder_handle_t builder) {
+static void emit_unsafe_as(spidir_builder_handle_t builder, RuntimeMethodBase method) {
     spidir_value_t arg0 = spidir_builder_build_param_ref(builder, 0);
     spidir_builder_build_return(builder, arg0);
 }
 
-static void emit_unsafe_are_same(spidir_builder_handle_t builder) {
+static void emit_unsafe_are_same(spidir_builder_handle_t builder, RuntimeMethodBase method) {
     spidir_value_t arg0 = spidir_builder_build_param_ref(builder, 0);
     spidir_value_t arg1 = spidir_builder_build_param_ref(builder, 1);
     spidir_builder_build_return(builder,
@@ -45,7 +46,7 @@ static void emit_unsafe_are_same(spidir_builder_handle_t builder) {
             SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, arg0, arg1));
 }
 
-static void emit_unsafe_add_byte_offset(spidir_builder_handle_t builder) {
+static void emit_unsafe_add_byte_offset(spidir_builder_handle_t builder, RuntimeMethodBase method) {
     spidir_value_t arg0 = spidir_builder_build_param_ref(builder, 0);
     spidir_value_t arg1 = spidir_builder_build_param_ref(builder, 1);
     spidir_builder_build_return(builder,
@@ -75,7 +76,7 @@ static void emit_memory_marshal_get_array_data_reference(spidir_builder_handle_t
 // System.Buffer
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void emit_buffer_memmove(spidir_builder_handle_t builder, RuntimeMethodBase method) {
+static void emit_buffer_copy(spidir_builder_handle_t builder, RuntimeMethodBase method, bool overlapping) {
     RuntimeTypeInfo copy_type = method->Parameters->Elements[0]->ParameterType->ElementType;
     RuntimeTypeInfo len_type = method->Parameters->Elements[2]->ParameterType;
 
@@ -98,11 +99,19 @@ static void emit_buffer_memmove(spidir_builder_handle_t builder, RuntimeMethodBa
     );
 
     // TODO: use gc_memcpy when applicable
-    // TODO: right now we don't do that but we can use versions
-    //       that assume certain alignment (or lack there of)
+    spidir_function_t func = g_jit_memcpy;
+    if (overlapping) {
+        // when the element is aligned to 8 both pointers and the
+        // length are as well, so we can move whole words at a time
+        if (copy_type->StackAlignment >= 8 && copy_type->StackSize % 8 == 0) {
+            func = g_jit_memmove_aligned_8;
+        } else {
+            func = g_jit_memmove;
+        }
+    }
 
     spidir_builder_build_call(builder,
-        g_jit_memcpy,
+        func,
         3,
         (spidir_value_t[]){
             dst,
@@ -114,30 +123,898 @@ static void emit_buffer_memmove(spidir_builder_handle_t builder, RuntimeMethodBa
     spidir_builder_build_return(builder, SPIDIR_VALUE_INVALID);
 }
 
+static void emit_buffer_memmove(spidir_builder_handle_t builder, RuntimeMethodBase method) {
+    emit_buffer_copy(builder, method, true);
+}
+
+static void emit_unsafe_copy_block(spidir_builder_handle_t builder, RuntimeMethodBase method) {
+    // cpblk does not allow the ranges to overlap
+    emit_buffer_copy(builder, method, false);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // System.Numerics.BitOperations
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// TODO: use spidir opcodes for these
+static bool is_32bit_operand(RuntimeTypeInfo type) {
+    return tdn_get_intermediate_type(type) == tInt32;
+}
 
-static void emit_bit_operations_leading_zero_count(spidir_builder_handle_t builder, RuntimeMethodBase method) {
-    spidir_function_t func;
-    if (method->Parameters->Elements[0]->ParameterType == tUInt32) {
-        func = g_jit_leading_zero_count_32;
-    } else if (method->Parameters->Elements[0]->ParameterType == tUInt64) {
-        func = g_jit_leading_zero_count_64;
+static spidir_value_t emit_bit_helper_call(spidir_builder_handle_t builder, RuntimeTypeInfo type,
+    spidir_function_t func32, spidir_function_t func64, spidir_value_t value
+) {
+    return spidir_builder_build_call(builder,
+        is_32bit_operand(type) ? func32 : func64,
+        1, (spidir_value_t[]){ value });
+}
+
+static spidir_value_t emit_bit_operations_leading_zero_count(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    return emit_bit_helper_call(builder, type, g_jit_leading_zero_count_32, g_jit_leading_zero_count_64, args[0]);
+}
+
+static spidir_value_t emit_bit_operations_trailing_zero_count(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    return emit_bit_helper_call(builder, type, g_jit_trailing_zero_count_32, g_jit_trailing_zero_count_64, args[0]);
+}
+
+static spidir_value_t emit_bit_operations_pop_count(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    return emit_bit_helper_call(builder, type, g_jit_pop_count_32, g_jit_pop_count_64, args[0]);
+}
+
+static spidir_value_t emit_bit_operations_log2(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    bool is_32bit = is_32bit_operand(type);
+    spidir_value_type_t spidir_type = is_32bit ? SPIDIR_TYPE_I32 : SPIDIR_TYPE_I64;
+
+    // (bits - 1) - lzcnt(value | 1), the or makes log2(0) be 0
+    spidir_value_t value = spidir_builder_build_or(builder, args[0],
+        spidir_builder_build_iconst(builder, spidir_type, 1));
+    value = emit_bit_helper_call(builder, type, g_jit_leading_zero_count_32, g_jit_leading_zero_count_64, value);
+    return spidir_builder_build_isub(builder,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, is_32bit ? 31 : 63),
+        value);
+}
+
+static spidir_value_t emit_bit_operations_rotate(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args, bool left) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    uint64_t mask = is_32bit_operand(type) ? 31 : 63;
+
+    // the offset is taken modulo the width, and the other side is
+    // shifted by the negated offset so an offset of zero works
+    spidir_value_t offset = spidir_builder_build_and(builder, args[1],
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, mask));
+    spidir_value_t other = spidir_builder_build_isub(builder,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, 0), args[1]);
+    other = spidir_builder_build_and(builder, other,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, mask));
+
+    spidir_value_t left_amount = left ? offset : other;
+    spidir_value_t right_amount = left ? other : offset;
+
+    return spidir_builder_build_or(builder,
+        spidir_builder_build_shl(builder, args[0], left_amount),
+        spidir_builder_build_lshr(builder, args[0], right_amount));
+}
+
+static spidir_value_t emit_bit_operations_rotate_left(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_bit_operations_rotate(builder, method, args, true);
+}
+
+static spidir_value_t emit_bit_operations_rotate_right(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_bit_operations_rotate(builder, method, args, false);
+}
+
+static spidir_value_t emit_bit_operations_is_pow2(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->Parameters->Elements[0]->ParameterType;
+    spidir_value_type_t spidir_type = is_32bit_operand(type) ? SPIDIR_TYPE_I32 : SPIDIR_TYPE_I64;
+    spidir_value_t zero = spidir_builder_build_iconst(builder, spidir_type, 0);
+
+    // (value & (value - 1)) == 0, without branching
+    spidir_value_t single_bit = spidir_builder_build_and(builder, args[0],
+        spidir_builder_build_isub(builder, args[0],
+            spidir_builder_build_iconst(builder, spidir_type, 1)));
+    single_bit = spidir_builder_build_icmp(builder, SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, single_bit, zero);
+
+    // and the value must be positive for the signed overloads
+    spidir_value_t positive;
+    if (type == tInt32 || type == tInt64 || type == tIntPtr) {
+        positive = spidir_builder_build_icmp(builder, SPIDIR_ICMP_SLT, SPIDIR_TYPE_I32, zero, args[0]);
     } else {
-        ASSERT(!"Invalid LeadingZeroCount parameter type");
+        positive = spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32, args[0], zero);
     }
 
-    spidir_value_t res = spidir_builder_build_call(builder,
-        func,
-        1,
-        (spidir_value_t[]){
-            spidir_builder_build_param_ref(builder, 0)
+    return spidir_builder_build_and(builder, single_bit, positive);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// System.SpanHelpers
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static RuntimeTypeInfo get_parameter_type(RuntimeMethodBase method, int i) {
+    return method->Parameters->Elements[i]->ParameterType;
+}
+
+static bool is_nuint_or_int(RuntimeTypeInfo type) {
+    return type == tUIntPtr || type == tInt32;
+}
+
+static spidir_value_t emit_length_to_i64(spidir_builder_handle_t builder, RuntimeTypeInfo type, spidir_value_t length) {
+    if (type == tInt32) {
+        length = spidir_builder_build_iext(builder, length);
+        length = spidir_builder_build_and(builder, length,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, UINT32_MAX));
+    }
+    return length;
+}
+
+/**
+ * (ref T searchSpace, T value0, ..., int length) with T being byte or char
+ */
+static bool span_helpers_is_search(RuntimeMethodBase method, int min_values, int max_values) {
+    int count = method->Parameters->Length;
+    if (count < min_values + 2 || count > max_values + 2) return false;
+    if (method->ReturnParameter->ParameterType != tInt32) return false;
+
+    RuntimeTypeInfo search_space = get_parameter_type(method, 0);
+    if (!search_space->IsByRef) return false;
+
+    RuntimeTypeInfo element = search_space->ElementType;
+    if (element != tByte && element != tChar) return false;
+
+    for (int i = 1; i < count - 1; i++) {
+        if (get_parameter_type(method, i) != element) return false;
+    }
+
+    return get_parameter_type(method, count - 1) == tInt32;
+}
+
+static bool span_helpers_index_of_supported(RuntimeMethodBase method) {
+    return span_helpers_is_search(method, 1, 1);
+}
+
+static bool span_helpers_index_of_any_supported(RuntimeMethodBase method) {
+    return span_helpers_is_search(method, 2, 3);
+}
+
+static bool span_helpers_last_index_of_supported(RuntimeMethodBase method) {
+    return span_helpers_is_search(method, 1, 1);
+}
+
+static spidir_value_t emit_span_helpers_index_of_any(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    int count = method->Parameters->Length;
+    bool is_char = get_parameter_type(method, 0)->ElementType == tChar;
+
+    // the helper always takes three values, repeat the last
+    // one for the overloads that search for less
+    spidir_value_t value0 = args[1];
+    spidir_value_t value1 = count > 3 ? args[2] : value0;
+    spidir_value_t value2 = count > 4 ? args[3] : value1;
+
+    return spidir_builder_build_call(builder,
+        is_char ? g_jit_index_of_any_char : g_jit_index_of_any_byte,
+        5, (spidir_value_t[]){ args[0], value0, value1, value2, args[count - 1] });
+}
+
+static spidir_value_t emit_span_helpers_last_index_of(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    bool is_char = get_parameter_type(method, 0)->ElementType == tChar;
+    return spidir_builder_build_call(builder,
+        is_char ? g_jit_last_index_of_char : g_jit_last_index_of_byte,
+        3, (spidir_value_t[]){ args[0], args[1], args[2] });
+}
+
+static bool span_helpers_sequence_equal_supported(RuntimeMethodBase method) {
+    if (method->Parameters->Length != 3) return false;
+    if (method->ReturnParameter->ParameterType != tBoolean) return false;
+
+    RuntimeTypeInfo first = get_parameter_type(method, 0);
+    RuntimeTypeInfo second = get_parameter_type(method, 1);
+    return first->IsByRef && first->ElementType == tByte &&
+           second->IsByRef && second->ElementType == tByte &&
+           is_nuint_or_int(get_parameter_type(method, 2));
+}
+
+static spidir_value_t emit_span_helpers_sequence_equal(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    spidir_value_t length = emit_length_to_i64(builder, get_parameter_type(method, 2), args[2]);
+    return spidir_builder_build_call(builder,
+        g_jit_sequence_equal,
+        3, (spidir_value_t[]){ args[0], args[1], length });
+}
+
+static bool span_helpers_fill_supported(RuntimeMethodBase method) {
+    if (method->Parameters->Length != 3) return false;
+
+    RuntimeTypeInfo ref = get_parameter_type(method, 0);
+    if (!ref->IsByRef) return false;
+
+    // only plain integers, anything else is a normal call
+    RuntimeTypeInfo element = ref->ElementType;
+    RuntimeTypeInfo intermediate = tdn_get_intermediate_type(element);
+    if (intermediate != tInt32 && intermediate != tInt64 && intermediate != tIntPtr) return false;
+    if (get_parameter_type(method, 2) != element) return false;
+
+    return is_nuint_or_int(get_parameter_type(method, 1));
+}
+
+static spidir_value_t emit_span_helpers_fill(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo element = get_parameter_type(method, 0)->ElementType;
+    spidir_value_t count = emit_length_to_i64(builder, get_parameter_type(method, 1), args[1]);
+
+    spidir_function_t func;
+    switch (element->StackSize) {
+        case 1: func = g_jit_fill_1; break;
+        case 2: func = g_jit_fill_2; break;
+        case 4: func = g_jit_fill_4; break;
+        default: func = g_jit_fill_8; break;
+    }
+
+    spidir_builder_build_call(builder, func, 3, (spidir_value_t[]){ args[0], count, args[2] });
+    return SPIDIR_VALUE_INVALID;
+}
+
+static bool span_helpers_clear_supported(RuntimeMethodBase method) {
+    if (method->Parameters->Length != 2) return false;
+
+    RuntimeTypeInfo ref = get_parameter_type(method, 0);
+    return ref->IsByRef && ref->ElementType == tByte &&
+           is_nuint_or_int(get_parameter_type(method, 1));
+}
+
+static spidir_value_t emit_span_helpers_clear(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    spidir_value_t length = emit_length_to_i64(builder, get_parameter_type(method, 1), args[1]);
+    spidir_builder_build_call(builder, g_jit_bzero, 2, (spidir_value_t[]){ args[0], length });
+    return SPIDIR_VALUE_INVALID;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// System.Math
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool is_signed_integer(RuntimeTypeInfo type) {
+    return type == tSByte || type == tInt16 || type == tInt32 || type == tInt64 || type == tIntPtr;
+}
+
+static bool is_unsigned_integer(RuntimeTypeInfo type) {
+    return type == tByte || type == tUInt16 || type == tUInt32 || type == tUInt64 || type == tUIntPtr;
+}
+
+static bool is_integer(RuntimeTypeInfo type) {
+    return is_signed_integer(type) || is_unsigned_integer(type);
+}
+
+static spidir_value_type_t get_integer_spidir_type(RuntimeTypeInfo type) {
+    return is_32bit_operand(type) ? SPIDIR_TYPE_I32 : SPIDIR_TYPE_I64;
+}
+
+/**
+ * Turn the 0/1 result of an icmp into all zeros or all ones
+ */
+static spidir_value_t emit_compare_mask(spidir_builder_handle_t builder, spidir_value_type_t type, spidir_value_t cond) {
+    if (type == SPIDIR_TYPE_I64) {
+        cond = spidir_builder_build_iext(builder, cond);
+        cond = spidir_builder_build_and(builder, cond,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, 1));
+    }
+    return spidir_builder_build_isub(builder, spidir_builder_build_iconst(builder, type, 0), cond);
+}
+
+/**
+ * Returns a if the condition is true, otherwise b, without branching
+ */
+static spidir_value_t emit_select(spidir_builder_handle_t builder, RuntimeTypeInfo type, spidir_value_t cond, spidir_value_t a, spidir_value_t b) {
+    // b ^ ((a ^ b) & mask)
+    spidir_value_t mask = emit_compare_mask(builder, get_integer_spidir_type(type), cond);
+    spidir_value_t diff = spidir_builder_build_xor(builder, a, b);
+    return spidir_builder_build_xor(builder, b, spidir_builder_build_and(builder, diff, mask));
+}
+
+/**
+ * Returns a if a < b, otherwise b, without branching
+ */
+static spidir_value_t emit_select_less(spidir_builder_handle_t builder, RuntimeTypeInfo type, spidir_value_t a, spidir_value_t b) {
+    spidir_value_t less = spidir_builder_build_icmp(builder,
+        is_signed_integer(type) ? SPIDIR_ICMP_SLT : SPIDIR_ICMP_ULT,
+        SPIDIR_TYPE_I32, a, b);
+    return emit_select(builder, type, less, a, b);
+}
+
+/**
+ * Returns a if a > b, otherwise b, without branching
+ */
+static spidir_value_t emit_select_greater(spidir_builder_handle_t builder, RuntimeTypeInfo type, spidir_value_t a, spidir_value_t b) {
+    spidir_value_t greater = spidir_builder_build_icmp(builder,
+        is_signed_integer(type) ? SPIDIR_ICMP_SLT : SPIDIR_ICMP_ULT,
+        SPIDIR_TYPE_I32, b, a);
+    return emit_select(builder, type, greater, a, b);
+}
+
+/**
+ * Emit a call to a throw helper if the condition is true, the check is the
+ * only branch and it is never taken on the normal path
+ */
+static void emit_throw_if(spidir_builder_handle_t builder, spidir_value_t cond, spidir_function_t throw_helper) {
+    spidir_block_t valid = spidir_builder_create_block(builder);
+    spidir_block_t invalid = spidir_builder_create_block(builder);
+    spidir_builder_build_brcond(builder, cond, invalid, valid);
+
+    spidir_builder_set_block(builder, invalid);
+    spidir_builder_build_call(builder, throw_helper, 0, NULL);
+    spidir_builder_build_unreachable(builder);
+
+    spidir_builder_set_block(builder, valid);
+}
+
+static spidir_mem_size_t get_integer_mem_size(RuntimeTypeInfo type) {
+    switch (type->StackSize) {
+        case 1: return SPIDIR_MEM_SIZE_1;
+        case 2: return SPIDIR_MEM_SIZE_2;
+        case 4: return SPIDIR_MEM_SIZE_4;
+        default: return SPIDIR_MEM_SIZE_8;
+    }
+}
+
+/**
+ * All the parameters and the return value are of the same integer type
+ */
+static bool math_is_integer_op(RuntimeMethodBase method, int count) {
+    if (method->Parameters->Length != count) return false;
+
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    if (!is_integer(type)) return false;
+
+    for (int i = 0; i < count; i++) {
+        if (get_parameter_type(method, i) != type) return false;
+    }
+
+    return true;
+}
+
+static bool math_min_max_supported(RuntimeMethodBase method) {
+    return math_is_integer_op(method, 2);
+}
+
+static spidir_value_t emit_math_min(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return emit_select_less(builder, type, args[0], args[1]);
+}
+
+static spidir_value_t emit_math_max(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return emit_select_greater(builder, type, args[0], args[1]);
+}
+
+static bool math_clamp_supported(RuntimeMethodBase method) {
+    return math_is_integer_op(method, 3);
+}
+
+static spidir_value_t emit_math_clamp(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    spidir_value_t value = args[0];
+    spidir_value_t min = args[1];
+    spidir_value_t max = args[2];
+
+    // min > max is an ArgumentException
+    emit_throw_if(builder,
+        spidir_builder_build_icmp(builder,
+            is_signed_integer(type) ? SPIDIR_ICMP_SLT : SPIDIR_ICMP_ULT,
+            SPIDIR_TYPE_I32, max, min),
+        g_jit_throw_argument_exception);
+
+    value = emit_select_greater(builder, type, value, min);
+    return emit_select_less(builder, type, value, max);
+}
+
+static bool math_abs_supported(RuntimeMethodBase method) {
+    return math_is_integer_op(method, 1) && is_signed_integer(method->ReturnParameter->ParameterType);
+}
+
+static spidir_value_t emit_math_abs(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    spidir_value_type_t spidir_type = get_integer_spidir_type(type);
+    spidir_value_t value = args[0];
+
+    // the small types are already sign extended to 32bit, so
+    // only the MinValue of the type itself has no positive form
+    uint64_t min_value;
+    switch (type->StackSize) {
+        case 1: min_value = (uint32_t)INT8_MIN; break;
+        case 2: min_value = (uint32_t)INT16_MIN; break;
+        case 4: min_value = (uint32_t)INT32_MIN; break;
+        default: min_value = (uint64_t)INT64_MIN; break;
+    }
+    emit_throw_if(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, value,
+            spidir_builder_build_iconst(builder, spidir_type, min_value)),
+        g_jit_throw_overflow_exception);
+
+    // (value ^ sign) - sign
+    spidir_value_t sign = spidir_builder_build_ashr(builder, value,
+        spidir_builder_build_iconst(builder, spidir_type, spidir_type == SPIDIR_TYPE_I32 ? 31 : 63));
+    return spidir_builder_build_isub(builder, spidir_builder_build_xor(builder, value, sign), sign);
+}
+
+static bool math_sign_supported(RuntimeMethodBase method) {
+    return method->Parameters->Length == 1 &&
+           method->ReturnParameter->ParameterType == tInt32 &&
+           is_signed_integer(get_parameter_type(method, 0));
+}
+
+static spidir_value_t emit_math_sign(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    spidir_value_type_t spidir_type = get_integer_spidir_type(get_parameter_type(method, 0));
+    spidir_value_t zero = spidir_builder_build_iconst(builder, spidir_type, 0);
+
+    // (value > 0) - (value < 0)
+    spidir_value_t positive = spidir_builder_build_icmp(builder, SPIDIR_ICMP_SLT, SPIDIR_TYPE_I32, zero, args[0]);
+    spidir_value_t negative = spidir_builder_build_icmp(builder, SPIDIR_ICMP_SLT, SPIDIR_TYPE_I32, args[0], zero);
+    return spidir_builder_build_isub(builder, positive, negative);
+}
+
+static bool math_big_mul_supported(RuntimeMethodBase method) {
+    RuntimeTypeInfo ret = method->ReturnParameter->ParameterType;
+    int count = method->Parameters->Length;
+    if (count < 2) return false;
+
+    RuntimeTypeInfo a = get_parameter_type(method, 0);
+    RuntimeTypeInfo b = get_parameter_type(method, 1);
+    if (a != b) return false;
+
+    // the 32x32->64 overloads
+    if (count == 2) {
+        return (a == tInt32 && ret == tInt64) || (a == tUInt32 && ret == tUInt64);
+    }
+
+    // the 64x64->128 overloads that return the high half
+    // and the low half through an out parameter
+    if (count == 3) {
+        RuntimeTypeInfo low = get_parameter_type(method, 2);
+        return (a == tInt64 || a == tUInt64) && ret == a &&
+               low->IsByRef && low->ElementType == a;
+    }
+
+    return false;
+}
+
+static spidir_value_t emit_math_big_mul(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = get_parameter_type(method, 0);
+
+    if (method->Parameters->Length == 2) {
+        spidir_value_t a = spidir_builder_build_iext(builder, args[0]);
+        spidir_value_t b = spidir_builder_build_iext(builder, args[1]);
+        if (type == tInt32) {
+            a = spidir_builder_build_sfill(builder, 32, a);
+            b = spidir_builder_build_sfill(builder, 32, b);
+        } else {
+            spidir_value_t low_mask = spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, UINT32_MAX);
+            a = spidir_builder_build_and(builder, a, low_mask);
+            b = spidir_builder_build_and(builder, b, low_mask);
         }
-    );
-    spidir_builder_build_return(builder, res);
+        return spidir_builder_build_imul(builder, a, b);
+    }
+
+    // the low half is the same for both signed and unsigned
+    spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8,
+        spidir_builder_build_imul(builder, args[0], args[1]),
+        args[2]);
+
+    return spidir_builder_build_call(builder,
+        type == tInt64 ? g_jit_mul_high_s64 : g_jit_mul_high_u64,
+        2, (spidir_value_t[]){ args[0], args[1] });
+}
+
+static bool math_div_rem_supported(RuntimeMethodBase method) {
+    // only the out overloads, the tuple ones return a struct
+    if (method->Parameters->Length != 3) return false;
+
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    if (type != tInt32 && type != tInt64) return false;
+
+    RuntimeTypeInfo result = get_parameter_type(method, 2);
+    return get_parameter_type(method, 0) == type &&
+           get_parameter_type(method, 1) == type &&
+           result->IsByRef && result->ElementType == type;
+}
+
+static spidir_value_t emit_math_div_rem(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+
+    // a single divide, the remainder is recovered with a multiply
+    spidir_value_t quotient = spidir_builder_build_sdiv(builder, args[0], args[1]);
+    spidir_value_t remainder = spidir_builder_build_isub(builder, args[0],
+        spidir_builder_build_imul(builder, quotient, args[1]));
+
+    spidir_builder_build_store(builder, get_integer_mem_size(type), remainder, args[2]);
+    return quotient;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// System.Runtime.Intrinsics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static spidir_value_t emit_vector_is_hardware_accelerated(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    // sse2 is part of x86-64, so only the 256bit vectors depend on the cpu,
+    // this is a constant so the corelib only keeps one of its paths
+    bool accelerated = method->DeclaringType == tVector128 || g_jit_cpu_features.avx2;
+    return spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, accelerated);
+}
+
+/**
+ * The size of a Vector128<T> or Vector256<T>, zero for any other type
+ */
+static size_t get_vector_size(RuntimeTypeInfo type) {
+    RuntimeTypeInfo definition = type->GenericTypeDefinition;
+    if (definition == NULL) return 0;
+    if (definition == tVector128Generic) return 16;
+    if (definition == tVector256Generic) return 32;
+    return 0;
+}
+
+/**
+ * The lane of a vector type, -1 if this is not a vector or
+ * the element type is not one the hardware supports
+ */
+static int get_vector_lane(RuntimeTypeInfo type) {
+    if (get_vector_size(type) == 0) return -1;
+
+    RuntimeTypeInfo element = type->GenericArguments->Elements[0];
+    if (element == tSingle) return JIT_VECTOR_LANE_F32;
+    if (element == tDouble) return JIT_VECTOR_LANE_F64;
+    if (!is_integer(element)) return -1;
+
+    switch (element->StackSize) {
+        case 1: return JIT_VECTOR_LANE_I8;
+        case 2: return JIT_VECTOR_LANE_I16;
+        case 4: return JIT_VECTOR_LANE_I32;
+        default: return JIT_VECTOR_LANE_I64;
+    }
+}
+
+static bool is_integer_vector_lane(int lane) {
+    return lane >= JIT_VECTOR_LANE_I8 && lane <= JIT_VECTOR_LANE_I64;
+}
+
+/**
+ * The vector that is returned through the pointer after the parameters
+ */
+static spidir_value_t get_vector_result(RuntimeMethodBase method, spidir_value_t* args) {
+    return args[method->Parameters->Length];
+}
+
+static spidir_value_t emit_vector_word_ptr(spidir_builder_handle_t builder, spidir_value_t vector, size_t offset) {
+    return spidir_builder_build_ptroff(builder, vector,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, offset));
+}
+
+typedef enum vector_bitwise_op {
+    VECTOR_BITWISE_COPY,
+    VECTOR_BITWISE_NOT,
+    VECTOR_BITWISE_AND,
+    VECTOR_BITWISE_AND_NOT,
+    VECTOR_BITWISE_OR,
+    VECTOR_BITWISE_XOR,
+} vector_bitwise_op_t;
+
+/**
+ * The bitwise operations do not care about the lanes, so they are done
+ * inline one word at a time instead of calling a helper
+ */
+static void emit_vector_bitwise(spidir_builder_handle_t builder, size_t size, vector_bitwise_op_t op,
+    spidir_value_t result, spidir_value_t left, spidir_value_t right
+) {
+    for (size_t offset = 0; offset < size; offset += 8) {
+        spidir_value_t value = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
+            emit_vector_word_ptr(builder, left, offset));
+
+        spidir_value_t other = SPIDIR_VALUE_INVALID;
+        if (op != VECTOR_BITWISE_COPY && op != VECTOR_BITWISE_NOT) {
+            other = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
+                emit_vector_word_ptr(builder, right, offset));
+        }
+
+        spidir_value_t ones = spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, UINT64_MAX);
+        switch (op) {
+            case VECTOR_BITWISE_COPY: break;
+            case VECTOR_BITWISE_NOT: value = spidir_builder_build_xor(builder, value, ones); break;
+            case VECTOR_BITWISE_AND: value = spidir_builder_build_and(builder, value, other); break;
+            case VECTOR_BITWISE_AND_NOT:
+                value = spidir_builder_build_and(builder, value,
+                    spidir_builder_build_xor(builder, other, ones));
+                break;
+            case VECTOR_BITWISE_OR: value = spidir_builder_build_or(builder, value, other); break;
+            case VECTOR_BITWISE_XOR: value = spidir_builder_build_xor(builder, value, other); break;
+        }
+
+        spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, value,
+            emit_vector_word_ptr(builder, result, offset));
+    }
+}
+
+/**
+ * Store the same word to the whole vector
+ */
+static void emit_vector_fill(spidir_builder_handle_t builder, size_t size, spidir_value_t result, spidir_value_t word) {
+    for (size_t offset = 0; offset < size; offset += 8) {
+        spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, word,
+            emit_vector_word_ptr(builder, result, offset));
+    }
+}
+
+/**
+ * (Vector<T> left, Vector<T> right) -> Vector<T>
+ */
+static bool vector_is_binary_op(RuntimeMethodBase method) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return method->Parameters->Length == 2 &&
+           get_vector_lane(type) >= 0 &&
+           get_parameter_type(method, 0) == type &&
+           get_parameter_type(method, 1) == type;
+}
+
+/**
+ * (Vector<T> value) -> Vector<T>
+ */
+static bool vector_is_unary_op(RuntimeMethodBase method) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return method->Parameters->Length == 1 &&
+           get_vector_lane(type) >= 0 &&
+           get_parameter_type(method, 0) == type;
+}
+
+static spidir_value_t emit_vector_bitwise_builtin(spidir_builder_handle_t builder, RuntimeMethodBase method,
+    spidir_value_t* args, vector_bitwise_op_t op
+) {
+    size_t size = get_vector_size(method->ReturnParameter->ParameterType);
+    spidir_value_t right = method->Parameters->Length > 1 ? args[1] : SPIDIR_VALUE_INVALID;
+    emit_vector_bitwise(builder, size, op, get_vector_result(method, args), args[0], right);
+    return SPIDIR_VALUE_INVALID;
+}
+
+static spidir_value_t emit_vector_bitwise_and(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_AND);
+}
+
+static spidir_value_t emit_vector_bitwise_or(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_OR);
+}
+
+static spidir_value_t emit_vector_xor(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_XOR);
+}
+
+static spidir_value_t emit_vector_and_not(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_AND_NOT);
+}
+
+static spidir_value_t emit_vector_ones_complement(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_NOT);
+}
+
+static spidir_value_t emit_vector_lane_helper(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args,
+    spidir_function_t func128, spidir_function_t func256
+) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    spidir_builder_build_call(builder,
+        get_vector_size(type) == 16 ? func128 : func256,
+        4, (spidir_value_t[]){
+            get_vector_result(method, args), args[0], args[1],
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, get_vector_lane(type))
+        });
+    return SPIDIR_VALUE_INVALID;
+}
+
+static spidir_value_t emit_vector_add(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_lane_helper(builder, method, args, g_jit_vector128_add, g_jit_vector256_add);
+}
+
+static spidir_value_t emit_vector_subtract(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_lane_helper(builder, method, args, g_jit_vector128_subtract, g_jit_vector256_subtract);
+}
+
+static spidir_value_t emit_vector_equals(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_lane_helper(builder, method, args, g_jit_vector128_equals, g_jit_vector256_equals);
+}
+
+static bool vector_extract_most_significant_bits_supported(RuntimeMethodBase method) {
+    return method->Parameters->Length == 1 &&
+           method->ReturnParameter->ParameterType == tUInt32 &&
+           get_vector_lane(get_parameter_type(method, 0)) >= 0;
+}
+
+static spidir_value_t emit_vector_extract_most_significant_bits(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = get_parameter_type(method, 0);
+    return spidir_builder_build_call(builder,
+        get_vector_size(type) == 16 ?
+            g_jit_vector128_extract_most_significant_bits :
+            g_jit_vector256_extract_most_significant_bits,
+        2, (spidir_value_t[]){
+            args[0],
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, get_vector_lane(type))
+        });
+}
+
+/**
+ * (Vector<T> left, Vector<T> right) -> bool, floats are left out since
+ * comparing them is not the same as comparing their bits
+ */
+static bool vector_equals_all_supported(RuntimeMethodBase method) {
+    if (method->Parameters->Length != 2) return false;
+    if (method->ReturnParameter->ParameterType != tBoolean) return false;
+
+    RuntimeTypeInfo type = get_parameter_type(method, 0);
+    return is_integer_vector_lane(get_vector_lane(type)) &&
+           get_parameter_type(method, 1) == type;
+}
+
+static spidir_value_t emit_vector_compare_all(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args, spidir_icmp_kind_t kind) {
+    size_t size = get_vector_size(get_parameter_type(method, 0));
+
+    // or together the difference of every word
+    spidir_value_t diff = spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, 0);
+    for (size_t offset = 0; offset < size; offset += 8) {
+        spidir_value_t left = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
+            emit_vector_word_ptr(builder, args[0], offset));
+        spidir_value_t right = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
+            emit_vector_word_ptr(builder, args[1], offset));
+        diff = spidir_builder_build_or(builder, diff, spidir_builder_build_xor(builder, left, right));
+    }
+
+    return spidir_builder_build_icmp(builder, kind, SPIDIR_TYPE_I32, diff,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, 0));
+}
+
+static spidir_value_t emit_vector_equals_all(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_compare_all(builder, method, args, SPIDIR_ICMP_EQ);
+}
+
+static spidir_value_t emit_vector_not_equals_any(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_compare_all(builder, method, args, SPIDIR_ICMP_NE);
+}
+
+/**
+ * Create(T value) -> Vector<T>, only for integers, floats are
+ * kept as doubles on the stack
+ */
+static bool vector_create_supported(RuntimeMethodBase method) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return method->Parameters->Length == 1 &&
+           is_integer_vector_lane(get_vector_lane(type)) &&
+           get_parameter_type(method, 0) == type->GenericArguments->Elements[0];
+}
+
+static spidir_value_t emit_vector_create(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    spidir_value_t value = args[0];
+
+    // repeat the element across a word, the multiply puts a copy of
+    // the zero extended element in every lane of the word
+    uint64_t repeat;
+    uint64_t mask;
+    switch (type->GenericArguments->Elements[0]->StackSize) {
+        case 1: repeat = 0x0101010101010101ull; mask = UINT8_MAX; break;
+        case 2: repeat = 0x0001000100010001ull; mask = UINT16_MAX; break;
+        case 4: repeat = 0x0000000100000001ull; mask = UINT32_MAX; break;
+        default: repeat = 1; mask = UINT64_MAX; break;
+    }
+
+    if (repeat != 1) {
+        value = spidir_builder_build_iext(builder, value);
+        value = spidir_builder_build_and(builder, value,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, mask));
+        value = spidir_builder_build_imul(builder, value,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, repeat));
+    }
+
+    emit_vector_fill(builder, get_vector_size(type), get_vector_result(method, args), value);
+    return SPIDIR_VALUE_INVALID;
+}
+
+/**
+ * (ref T source) or (ref T source, nuint elementOffset) -> Vector<T>
+ */
+static bool vector_load_unsafe_supported(RuntimeMethodBase method) {
+    int count = method->Parameters->Length;
+    if (count != 1 && count != 2) return false;
+
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    if (get_vector_lane(type) < 0) return false;
+
+    RuntimeTypeInfo source = get_parameter_type(method, 0);
+    return source->IsByRef && source->ElementType == type->GenericArguments->Elements[0] &&
+           (count == 1 || get_parameter_type(method, 1) == tUIntPtr);
+}
+
+static spidir_value_t emit_vector_element_ptr(spidir_builder_handle_t builder, RuntimeTypeInfo element,
+    spidir_value_t ptr, spidir_value_t index
+) {
+    return spidir_builder_build_ptroff(builder, ptr,
+        spidir_builder_build_imul(builder, index,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, element->StackSize)));
+}
+
+static spidir_value_t emit_vector_load_unsafe(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+
+    spidir_value_t source = args[0];
+    if (method->Parameters->Length == 2) {
+        source = emit_vector_element_ptr(builder, type->GenericArguments->Elements[0], source, args[1]);
+    }
+
+    emit_vector_bitwise(builder, get_vector_size(type), VECTOR_BITWISE_COPY,
+        get_vector_result(method, args), source, SPIDIR_VALUE_INVALID);
+    return SPIDIR_VALUE_INVALID;
+}
+
+/**
+ * (Vector<T> source, ref T destination) or (Vector<T> source, ref T destination, nuint elementOffset)
+ */
+static bool vector_store_unsafe_supported(RuntimeMethodBase method) {
+    int count = method->Parameters->Length;
+    if (count != 2 && count != 3) return false;
+    if (method->ReturnParameter->ParameterType != tVoid) return false;
+
+    RuntimeTypeInfo type = get_parameter_type(method, 0);
+    if (get_vector_lane(type) < 0) return false;
+
+    RuntimeTypeInfo destination = get_parameter_type(method, 1);
+    return destination->IsByRef && destination->ElementType == type->GenericArguments->Elements[0] &&
+           (count == 2 || get_parameter_type(method, 2) == tUIntPtr);
+}
+
+static spidir_value_t emit_vector_store_unsafe(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = get_parameter_type(method, 0);
+
+    spidir_value_t destination = args[1];
+    if (method->Parameters->Length == 3) {
+        destination = emit_vector_element_ptr(builder, type->GenericArguments->Elements[0], destination, args[2]);
+    }
+
+    emit_vector_bitwise(builder, get_vector_size(type), VECTOR_BITWISE_COPY,
+        destination, args[0], SPIDIR_VALUE_INVALID);
+    return SPIDIR_VALUE_INVALID;
+}
+
+/**
+ * The As casts between vectors of the same size, only the bits are kept
+ */
+static bool vector_as_supported(RuntimeMethodBase method) {
+    if (method->Parameters->Length != 1) return false;
+
+    RuntimeTypeInfo from = get_parameter_type(method, 0);
+    RuntimeTypeInfo to = method->ReturnParameter->ParameterType;
+    return get_vector_lane(from) >= 0 && get_vector_lane(to) >= 0 &&
+           get_vector_size(from) == get_vector_size(to);
+}
+
+static spidir_value_t emit_vector_as(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    return emit_vector_bitwise_builtin(builder, method, args, VECTOR_BITWISE_COPY);
+}
+
+/**
+ * The static properties of Vector<T>, either the vector itself or the count
+ */
+static bool vector_constant_supported(RuntimeMethodBase method) {
+    RuntimeTypeInfo type = method->ReturnParameter->ParameterType;
+    return method->Parameters->Length == 0 &&
+           get_vector_lane(method->DeclaringType) >= 0 &&
+           (type == method->DeclaringType || type == tInt32);
+}
+
+static spidir_value_t emit_vector_get_zero(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    emit_vector_fill(builder, get_vector_size(method->DeclaringType), get_vector_result(method, args),
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, 0));
+    return SPIDIR_VALUE_INVALID;
+}
+
+static spidir_value_t emit_vector_get_all_bits_set(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    emit_vector_fill(builder, get_vector_size(method->DeclaringType), get_vector_result(method, args),
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, UINT64_MAX));
+    return SPIDIR_VALUE_INVALID;
+}
+
+static spidir_value_t emit_vector_get_count(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args) {
+    RuntimeTypeInfo type = method->DeclaringType;
+    size_t count = get_vector_size(type) / type->GenericArguments->Elements[0]->StackSize;
+    return spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, count);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -172,7 +1049,7 @@ static void emit_debug_print(spidir_builder_handle_t builder, RuntimeMethodBase
 // Delegate handling
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void emit_delegate_ctor(spidir_builder_handle_t builder) {
+static void emit_delegate_ctor(spidir_builder_handle_t builder, RuntimeMethodBase ctor) {
     spidir_value_t delegate = spidir_builder_build_param_ref(builder, 0);
     spidir_value_t target = spidir_builder_build_param_ref(builder, 1);
     spidir_value_t method = spidir_builder_build_param_ref(builder, 2);
@@ -227,79 +1104,265 @@ static void emit_delegate_invoke(spidir_builder_handle_t builder, RuntimeMethodB
 // Generic emit code
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void jit_emit_builtin(spidir_builder_handle_t handle, void* _ctx) {
+typedef void (*jit_builtin_emit_t)(spidir_builder_handle_t builder, RuntimeMethodBase method);
+
+typedef struct jit_builtin {
+    RuntimeTypeInfo* type;
+    const char* name;
+    jit_builtin_emit_t emit;
+} jit_builtin_t;
+
+/**
+ * All the builtin methods, delegates are registered under MulticastDelegate
+ * since the methods are generated for every delegate type
+ */
+static jit_builtin_t m_builtins[] = {
+    { &tObject, "GetType", emit_object_get_type },
+    { &tUnsafe, "As", emit_unsafe_as },
+    { &tUnsafe, "AsRef", emit_unsafe_as },
+    { &tUnsafe, "AreSame", emit_unsafe_are_same },
+    { &tUnsafe, "CopyBlockUnaligned", emit_unsafe_copy_block },
+    { &tUnsafe, "AddByteOffset", emit_unsafe_add_byte_offset },
+    { &tMemoryMarshal, "GetArrayDataReference", emit_memory_marshal_get_array_data_reference },
+    { &tBuffer, "Memmove", emit_buffer_memmove },
+    { &tDebug, "Print", emit_debug_print },
+    { &tMulticastDelegate, ".ctor", emit_delegate_ctor },
+    { &tMulticastDelegate, "Invoke", emit_delegate_invoke },
+};
+
+typedef spidir_value_t (*jit_inline_builtin_emit_t)(spidir_builder_handle_t builder, RuntimeMethodBase method, spidir_value_t* args);
+
+typedef bool (*jit_inline_builtin_supported_t)(RuntimeMethodBase method);
+
+typedef struct jit_inline_builtin {
+    RuntimeTypeInfo* type;
+    const char* name;
+    jit_inline_builtin_emit_t emit;
+
+    // if set, overloads it returns false for are called normally
+    jit_inline_builtin_supported_t supported;
+} jit_inline_builtin_t;
+
+/**
+ * The vector builtins are the same for both sizes, the ones of Vector<T>
+ * are found through the generic type definition
+ */
+#define JIT_VECTOR_BUILTIN(name, emit, supported) \
+    { &tVector128, name, emit, supported }, \
+    { &tVector256, name, emit, supported }
+
+#define JIT_VECTOR_GENERIC_BUILTIN(name, emit, supported) \
+    { &tVector128Generic, name, emit, supported }, \
+    { &tVector256Generic, name, emit, supported }
+
+/**
+ * The builtins that are emitted right at the call site, these must all be
+ * static methods, when called indirectly they get a function wrapping them
+ */
+static jit_inline_builtin_t m_inline_builtins[] = {
+    { &tBitOperations, "LeadingZeroCount", emit_bit_operations_leading_zero_count },
+    { &tBitOperations, "TrailingZeroCount", emit_bit_operations_trailing_zero_count },
+    { &tBitOperations, "PopCount", emit_bit_operations_pop_count },
+    { &tBitOperations, "Log2", emit_bit_operations_log2 },
+    { &tBitOperations, "RotateLeft", emit_bit_operations_rotate_left },
+    { &tBitOperations, "RotateRight", emit_bit_operations_rotate_right },
+    { &tBitOperations, "IsPow2", emit_bit_operations_is_pow2 },
+    JIT_VECTOR_BUILTIN("get_IsHardwareAccelerated", emit_vector_is_hardware_accelerated, NULL),
+    JIT_VECTOR_BUILTIN("Add", emit_vector_add, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("Subtract", emit_vector_subtract, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("Equals", emit_vector_equals, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("BitwiseAnd", emit_vector_bitwise_and, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("BitwiseOr", emit_vector_bitwise_or, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("Xor", emit_vector_xor, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("AndNot", emit_vector_and_not, vector_is_binary_op),
+    JIT_VECTOR_BUILTIN("OnesComplement", emit_vector_ones_complement, vector_is_unary_op),
+    JIT_VECTOR_BUILTIN("ExtractMostSignificantBits", emit_vector_extract_most_significant_bits, vector_extract_most_significant_bits_supported),
+    JIT_VECTOR_BUILTIN("EqualsAll", emit_vector_equals_all, vector_equals_all_supported),
+    JIT_VECTOR_BUILTIN("Create", emit_vector_create, vector_create_supported),
+    JIT_VECTOR_BUILTIN("LoadUnsafe", emit_vector_load_unsafe, vector_load_unsafe_supported),
+    JIT_VECTOR_BUILTIN("StoreUnsafe", emit_vector_store_unsafe, vector_store_unsafe_supported),
+    JIT_VECTOR_BUILTIN("As", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsByte", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsSByte", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsInt16", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsUInt16", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsInt32", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsUInt32", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsInt64", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsUInt64", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsSingle", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_BUILTIN("AsDouble", emit_vector_as, vector_as_supported),
+    JIT_VECTOR_GENERIC_BUILTIN("op_Addition", emit_vector_add, vector_is_binary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_Subtraction", emit_vector_subtract, vector_is_binary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_BitwiseAnd", emit_vector_bitwise_and, vector_is_binary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_BitwiseOr", emit_vector_bitwise_or, vector_is_binary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_ExclusiveOr", emit_vector_xor, vector_is_binary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_OnesComplement", emit_vector_ones_complement, vector_is_unary_op),
+    JIT_VECTOR_GENERIC_BUILTIN("op_Equality", emit_vector_equals_all, vector_equals_all_supported),
+    JIT_VECTOR_GENERIC_BUILTIN("op_Inequality", emit_vector_not_equals_any, vector_equals_all_supported),
+    JIT_VECTOR_GENERIC_BUILTIN("get_Zero", emit_vector_get_zero, vector_constant_supported),
+    JIT_VECTOR_GENERIC_BUILTIN("get_AllBitsSet", emit_vector_get_all_bits_set, vector_constant_supported),
+    JIT_VECTOR_GENERIC_BUILTIN("get_Count", emit_vector_get_count, vector_constant_supported),
+    { &tSpanHelpers, "IndexOf", emit_span_helpers_index_of_any, span_helpers_index_of_supported },
+    { &tSpanHelpers, "IndexOfAny", emit_span_helpers_index_of_any, span_helpers_index_of_any_supported },
+    { &tSpanHelpers, "LastIndexOf", emit_span_helpers_last_index_of, span_helpers_last_index_of_supported },
+    { &tSpanHelpers, "SequenceEqual", emit_span_helpers_sequence_equal, span_helpers_sequence_equal_supported },
+    { &tSpanHelpers, "Fill", emit_span_helpers_fill, span_helpers_fill_supported },
+    { &tSpanHelpers, "ClearWithoutReferences", emit_span_helpers_clear, span_helpers_clear_supported },
+    { &tMath, "Min", emit_math_min, math_min_max_supported },
+    { &tMath, "Max", emit_math_max, math_min_max_supported },
+    { &tMath, "Clamp", emit_math_clamp, math_clamp_supported },
+    { &tMath, "Abs", emit_math_abs, math_abs_supported },
+    { &tMath, "Sign", emit_math_sign, math_sign_supported },
+    { &tMath, "BigMul", emit_math_big_mul, math_big_mul_supported },
+    { &tMath, "DivRem", emit_math_div_rem, math_div_rem_supported },
+};
+
+typedef struct jit_builtin_key {
+    RuntimeTypeInfo type;
+    String name;
+} jit_builtin_key_t;
+
+/**
+ * Maps the declaring type and the name atom to the emitter
+ */
+static struct {
+    jit_builtin_key_t key;
+    jit_builtin_emit_t value;
+}* m_builtin_table = NULL;
+
+static struct {
+    jit_builtin_key_t key;
+    jit_inline_builtin_t* value;
+}* m_inline_builtin_table = NULL;
+
+static tdn_err_t jit_init_builtin_table(void) {
     tdn_err_t err = TDN_NO_ERROR;
-    jit_builtin_context_t* ctx = _ctx;
-    RuntimeMethodBase method = ctx->method;
-    RuntimeTypeInfo type = method->DeclaringType;
 
-    // prepare the main block
-    spidir_block_t block = spidir_builder_create_block(handle);
-    spidir_builder_set_block(handle, block);
-    spidir_builder_set_entry_block(handle, block);
+    for (int i = 0; i < ARRAY_LENGTH(m_builtins); i++) {
+        jit_builtin_t* builtin = &m_builtins[i];
+        CHECK(*builtin->type != NULL);
 
-    // and now check it
-    if (type == tObject) {
-        CHECK(tdn_compare_string_to_cstr(method->Name, "GetType"));
-        emit_object_get_type(handle);
-
-    } else if (type == tUnsafe) {
-        if (tdn_compare_string_to_cstr(method->Name, "As")) {
-            emit_unsafe_as(handle);
-        } else if (tdn_compare_string_to_cstr(method->Name, "AsRef")) {
-            emit_unsafe_as(handle);
-        } else if (tdn_compare_string_to_cstr(method->Name, "AreSame")) {
-            emit_unsafe_are_same(handle);
-        } else if (tdn_compare_string_to_cstr(method->Name, "CopyBlockUnaligned")) {
-            emit_buffer_memmove(handle, method);
-        } else if (tdn_compare_string_to_cstr(method->Name, "AddByteOffset")) {
-            emit_unsafe_add_byte_offset(handle);
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
-        }
+        jit_builtin_key_t key = { .type = *builtin->type };
+        CHECK_AND_RETHROW(atom_intern(builtin->name, &key.name));
+        hmput(m_builtin_table, key, builtin->emit);
+    }
 
-    } else if (type == tMemoryMarshal) {
-        if (tdn_compare_string_to_cstr(method->Name, "GetArrayDataReference")) {
-            emit_memory_marshal_get_array_data_reference(handle, method);
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
-        }
+    for (int i = 0; i < ARRAY_LENGTH(m_inline_builtins); i++) {
+        jit_inline_builtin_t* builtin = &m_inline_builtins[i];
 
-    } else if (type == tBuffer) {
-        if (tdn_compare_string_to_cstr(method->Name, "Memmove")) {
-            emit_buffer_memmove(handle, method);
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
+        // optional corelib type that is missing
+        if (*builtin->type == NULL) {
+            continue;
         }
 
-    } else if (type == tBitOperations) {
-        if (tdn_compare_string_to_cstr(method->Name, "LeadingZeroCount")) {
-            emit_bit_operations_leading_zero_count(handle, method);
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
-        }
+        jit_builtin_key_t key = { .type = *builtin->type };
+        CHECK_AND_RETHROW(atom_intern(builtin->name, &key.name));
+        hmput(m_inline_builtin_table, key, builtin);
+    }
 
-    } else if (type == tDebug) {
-        if (tdn_compare_string_to_cstr(method->Name, "Print")) {
-            emit_debug_print(handle, method);
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
-        }
+cleanup:
+    return err;
+}
 
-    } else if (type->BaseType == tMulticastDelegate) {
-        // this is a delegate instance, the ctor takes
-        if (tdn_compare_string_to_cstr(method->Name, ".ctor")) {
-            emit_delegate_ctor(handle);
+/**
+ * Find the inline builtin of a method, the methods of a generic type
+ * instance are registered under the generic type definition
+ */
+static jit_inline_builtin_t* find_inline_builtin(RuntimeTypeInfo type, String name) {
+    jit_builtin_key_t key = { .type = type, .name = name };
+    int idx = hmgeti(m_inline_builtin_table, key);
+    if (idx < 0 && type->GenericTypeDefinition != NULL && type->GenericTypeDefinition != type) {
+        key.type = type->GenericTypeDefinition;
+        idx = hmgeti(m_inline_builtin_table, key);
+    }
+    return idx < 0 ? NULL : m_inline_builtin_table[idx].value;
+}
 
-        } else if (tdn_compare_string_to_cstr(method->Name, "Invoke")) {
-            emit_delegate_invoke(handle, method);
+static void emit_inline_builtin_function(spidir_builder_handle_t builder, RuntimeMethodBase method, jit_inline_builtin_emit_t emit) {
+    spidir_value_t* args = NULL;
+    for (int i = 0; i < method->Parameters->Length; i++) {
+        arrpush(args, spidir_builder_build_param_ref(builder, i));
+    }
 
-        } else {
-            CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
-        }
+    // struct results are returned through the pointer after the parameters
+    if (jit_get_spidir_ret_type(method) == SPIDIR_TYPE_NONE &&
+        method->ReturnParameter->ParameterType != tVoid
+    ) {
+        arrpush(args, spidir_builder_build_param_ref(builder, method->Parameters->Length));
+    }
+
+    spidir_builder_build_return(builder, emit(builder, method, args));
+
+    arrfree(args);
+}
+
+tdn_err_t jit_emit_inline_builtin(
+    spidir_builder_handle_t builder,
+    RuntimeMethodBase method,
+    spidir_value_t* args,
+    spidir_value_t* result,
+    bool* inlined
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    *inlined = false;
+
+    // build the table on first use, same as jit_emit_builtin
+    if (m_builtin_table == NULL) {
+        CHECK_AND_RETHROW(jit_init_builtin_table());
+    }
+
+    jit_inline_builtin_t* builtin = find_inline_builtin(method->DeclaringType, method->Name);
+    if (builtin == NULL) {
+        goto cleanup;
+    }
+
+    if (builtin->supported != NULL && !builtin->supported(method)) {
+        goto cleanup;
+    }
+
+    *result = builtin->emit(builder, method, args);
+    *inlined = true;
+
+cleanup:
+    return err;
+}
+
+void jit_emit_builtin(spidir_builder_handle_t handle, void* _ctx) {
+    tdn_err_t err = TDN_NO_ERROR;
+    jit_builtin_context_t* ctx = _ctx;
+    RuntimeMethodBase method = ctx->method;
+    RuntimeTypeInfo type = method->DeclaringType;
+
+    // build the table on first use, we need all the types
+    // to be loaded before we can do it
+    if (m_builtin_table == NULL) {
+        CHECK_AND_RETHROW(jit_init_builtin_table());
+    }
+
+    // prepare the main block
+    spidir_block_t block = spidir_builder_create_block(handle);
+    spidir_builder_set_block(handle, block);
+    spidir_builder_set_entry_block(handle, block);
+
+    // all delegate types share the same builtins
+    if (type->BaseType == tMulticastDelegate) {
+        type = tMulticastDelegate;
+    }
 
+    // the name is an atom so this is a single hash probe
+    jit_builtin_key_t key = { .type = type, .name = method->Name };
+    int idx = hmgeti(m_builtin_table, key);
+    if (idx >= 0) {
+        m_builtin_table[idx].value(handle, method);
     } else {
-        CHECK_FAIL("Invalid function %T::%U", method->DeclaringType, method->Name);
+        // called indirectly, wrap the inline form
+        jit_inline_builtin_t* builtin = find_inline_builtin(method->DeclaringType, method->Name);
+        CHECK(builtin != NULL, "Invalid function %T::%U", method->DeclaringType, method->Name);
+        CHECK(builtin->supported == NULL || builtin->supported(method),
+            "Invalid function %T::%U", method->DeclaringType, method->Name);
+        emit_inline_builtin_function(handle, method, builtin->emit);
     }
 
 cleanup:
@@ -10,3 +10,15 @@ typedef struct jit_builtin_context {
 } jit_builtin_context_t;
 
 void jit_emit_builtin(spidir_builder_handle_t handle, void* ctx);
+
+/**
+ * Emit the builtin in place of a direct call to it, if the method has no
+ * inline form then inlined is set to false and a normal call is needed
+ */
+tdn_err_t jit_emit_inline_builtin(
+    spidir_builder_handle_t builder,
+    RuntimeMethodBase method,
+    spidir_value_t* args,
+    spidir_value_t* result,
+    bool* inlined
+);
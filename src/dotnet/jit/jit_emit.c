@@ -2,6 +2,7 @@
 
 #include <stdalign.h>
 #include <dotnet/gc/gc.h>
+#include <dotnet/loader.h>
 #include <dotnet/metadata/metadata.h>
 #include <util/except.h>
 #include <util/stb_ds.h>
@@ -29,21 +30,57 @@ static spidir_module_handle_t m_jit_module = NULL;
 
 spidir_function_t g_jit_bzero;
 spidir_function_t g_jit_memcpy;
+spidir_function_t g_jit_memmove;
+spidir_function_t g_jit_memmove_aligned_8;
 
 spidir_function_t g_jit_leading_zero_count_32;
 spidir_function_t g_jit_leading_zero_count_64;
+spidir_function_t g_jit_trailing_zero_count_32;
+spidir_function_t g_jit_trailing_zero_count_64;
+spidir_function_t g_jit_pop_count_32;
+spidir_function_t g_jit_pop_count_64;
+
+spidir_function_t g_jit_index_of_any_byte;
+spidir_function_t g_jit_index_of_any_char;
+spidir_function_t g_jit_last_index_of_byte;
+spidir_function_t g_jit_last_index_of_char;
+spidir_function_t g_jit_sequence_equal;
+spidir_function_t g_jit_fill_1;
+spidir_function_t g_jit_fill_2;
+spidir_function_t g_jit_fill_4;
+spidir_function_t g_jit_fill_8;
+
+spidir_function_t g_jit_mul_high_u64;
+spidir_function_t g_jit_mul_high_s64;
+
+spidir_function_t g_jit_vector128_add;
+spidir_function_t g_jit_vector128_subtract;
+spidir_function_t g_jit_vector128_equals;
+spidir_function_t g_jit_vector128_extract_most_significant_bits;
+spidir_function_t g_jit_vector256_add;
+spidir_function_t g_jit_vector256_subtract;
+spidir_function_t g_jit_vector256_equals;
+spidir_function_t g_jit_vector256_extract_most_significant_bits;
+spidir_function_t g_jit_throw_overflow_exception;
+spidir_function_t g_jit_throw_argument_exception;
 
 static spidir_function_t m_jit_gc_new;
 static spidir_function_t m_jit_gc_newarr;
 static spidir_function_t m_jit_gc_newstr;
 
-static spidir_function_t m_jit_throw;
+static spidir_function_t m_jit_set_pending_exception;
+static spidir_function_t m_jit_take_pending_exception;
 
 static spidir_function_t m_jit_throw_invalid_cast_exception;
 static spidir_function_t m_jit_throw_index_out_of_range_exception;
 
 static spidir_function_t m_jit_interface_downcast;
 
+static spidir_function_t m_jit_run_type_initializer;
+
+static spidir_function_t m_jit_get_method_body;
+static spidir_function_t m_jit_get_parameter_name;
+
 static struct {
     spidir_function_t key;
     void* value;
@@ -111,6 +148,30 @@ static void create_jit_helpers() {
     );
     hmput(m_jit_helper_lookup, g_jit_memcpy, jit_memcpy);
 
+    g_jit_memmove = spidir_module_create_extern_function(m_jit_module,
+        "jit_memmove",
+        SPIDIR_TYPE_NONE,
+        3,
+        (spidir_value_type_t[]){
+            SPIDIR_TYPE_PTR,
+            SPIDIR_TYPE_PTR,
+            SPIDIR_TYPE_I64
+        }
+    );
+    hmput(m_jit_helper_lookup, g_jit_memmove, jit_memmove);
+
+    g_jit_memmove_aligned_8 = spidir_module_create_extern_function(m_jit_module,
+        "jit_memmove_aligned_8",
+        SPIDIR_TYPE_NONE,
+        3,
+        (spidir_value_type_t[]){
+            SPIDIR_TYPE_PTR,
+            SPIDIR_TYPE_PTR,
+            SPIDIR_TYPE_I64
+        }
+    );
+    hmput(m_jit_helper_lookup, g_jit_memmove_aligned_8, jit_memmove_aligned_8);
+
     m_jit_gc_new = spidir_module_create_extern_function(m_jit_module,
         "jit_gc_new",
         SPIDIR_TYPE_PTR,
@@ -153,16 +214,19 @@ static void create_jit_helpers() {
     );
     hmput(m_jit_helper_lookup, m_jit_interface_downcast, jit_interface_downcast);
 
-    m_jit_throw = spidir_module_create_extern_function(m_jit_module,
-        "jit_throw",
+    m_jit_set_pending_exception = spidir_module_create_extern_function(m_jit_module,
+        "jit_set_pending_exception",
         SPIDIR_TYPE_NONE,
-        2,
-        (spidir_value_type_t[]){
-            SPIDIR_TYPE_PTR,
-            SPIDIR_TYPE_I32,
-        }
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR }
+    );
+    hmput(m_jit_helper_lookup, m_jit_set_pending_exception, jit_set_pending_exception);
+
+    m_jit_take_pending_exception = spidir_module_create_extern_function(m_jit_module,
+        "jit_take_pending_exception",
+        SPIDIR_TYPE_PTR,
+        0, NULL
     );
-    hmput(m_jit_helper_lookup, m_jit_throw, jit_throw);
+    hmput(m_jit_helper_lookup, m_jit_take_pending_exception, jit_take_pending_exception);
 
     m_jit_throw_invalid_cast_exception = spidir_module_create_extern_function(m_jit_module,
         "jit_throw_invalid_cast_exception",
@@ -178,19 +242,243 @@ static void create_jit_helpers() {
     );
     hmput(m_jit_helper_lookup, m_jit_throw_index_out_of_range_exception, jit_throw_index_out_of_range_exception);
 
+    g_jit_throw_overflow_exception = spidir_module_create_extern_function(m_jit_module,
+        "jit_throw_overflow_exception",
+        SPIDIR_TYPE_NONE,
+        0, NULL
+    );
+    hmput(m_jit_helper_lookup, g_jit_throw_overflow_exception, jit_throw_overflow_exception);
+
+    g_jit_throw_argument_exception = spidir_module_create_extern_function(m_jit_module,
+        "jit_throw_argument_exception",
+        SPIDIR_TYPE_NONE,
+        0, NULL
+    );
+    hmput(m_jit_helper_lookup, g_jit_throw_argument_exception, jit_throw_argument_exception);
+
+    m_jit_run_type_initializer = spidir_module_create_extern_function(m_jit_module,
+        "jit_run_type_initializer",
+        SPIDIR_TYPE_NONE,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR }
+    );
+    hmput(m_jit_helper_lookup, m_jit_run_type_initializer, jit_run_type_initializer);
+
+    m_jit_get_method_body = spidir_module_create_extern_function(m_jit_module,
+        "jit_get_method_body",
+        SPIDIR_TYPE_PTR,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR }
+    );
+    hmput(m_jit_helper_lookup, m_jit_get_method_body, jit_get_method_body);
+
+    m_jit_get_parameter_name = spidir_module_create_extern_function(m_jit_module,
+        "jit_get_parameter_name",
+        SPIDIR_TYPE_PTR,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR }
+    );
+    hmput(m_jit_helper_lookup, m_jit_get_parameter_name, jit_get_parameter_name);
+
+    // the bit helpers are a single instruction when the cpu has it
+    jit_detect_cpu_features();
+
     g_jit_leading_zero_count_32 = spidir_module_create_extern_function(m_jit_module,
         "jit_leading_zero_count_32",
         SPIDIR_TYPE_I32,
         1, (spidir_value_type_t[]){ SPIDIR_TYPE_I32 }
     );
-    hmput(m_jit_helper_lookup, g_jit_leading_zero_count_32, jit_leading_zero_count_32);
+    hmput(m_jit_helper_lookup, g_jit_leading_zero_count_32,
+        g_jit_cpu_features.lzcnt ? jit_lzcnt_32 : jit_leading_zero_count_32);
 
     g_jit_leading_zero_count_64 = spidir_module_create_extern_function(m_jit_module,
         "jit_leading_zero_count_64",
         SPIDIR_TYPE_I32,
         1, (spidir_value_type_t[]){ SPIDIR_TYPE_I64 }
     );
-    hmput(m_jit_helper_lookup, g_jit_leading_zero_count_64, jit_leading_zero_count_32);
+    hmput(m_jit_helper_lookup, g_jit_leading_zero_count_64,
+        g_jit_cpu_features.lzcnt ? jit_lzcnt_64 : jit_leading_zero_count_64);
+
+    g_jit_trailing_zero_count_32 = spidir_module_create_extern_function(m_jit_module,
+        "jit_trailing_zero_count_32",
+        SPIDIR_TYPE_I32,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_trailing_zero_count_32,
+        g_jit_cpu_features.bmi1 ? jit_tzcnt_32 : jit_trailing_zero_count_32);
+
+    g_jit_trailing_zero_count_64 = spidir_module_create_extern_function(m_jit_module,
+        "jit_trailing_zero_count_64",
+        SPIDIR_TYPE_I32,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_trailing_zero_count_64,
+        g_jit_cpu_features.bmi1 ? jit_tzcnt_64 : jit_trailing_zero_count_64);
+
+    g_jit_pop_count_32 = spidir_module_create_extern_function(m_jit_module,
+        "jit_pop_count_32",
+        SPIDIR_TYPE_I32,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_pop_count_32,
+        g_jit_cpu_features.popcnt ? jit_popcnt_32 : jit_pop_count_32);
+
+    g_jit_pop_count_64 = spidir_module_create_extern_function(m_jit_module,
+        "jit_pop_count_64",
+        SPIDIR_TYPE_I32,
+        1, (spidir_value_type_t[]){ SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_pop_count_64,
+        g_jit_cpu_features.popcnt ? jit_popcnt_64 : jit_pop_count_64);
+
+    // the span helpers are vectorized when the cpu has avx2
+    bool avx2 = g_jit_cpu_features.avx2;
+
+    g_jit_index_of_any_byte = spidir_module_create_extern_function(m_jit_module,
+        "jit_index_of_any_byte",
+        SPIDIR_TYPE_I32,
+        5, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_index_of_any_byte,
+        avx2 ? jit_index_of_any_byte_avx2 : jit_index_of_any_byte);
+
+    g_jit_index_of_any_char = spidir_module_create_extern_function(m_jit_module,
+        "jit_index_of_any_char",
+        SPIDIR_TYPE_I32,
+        5, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_index_of_any_char,
+        avx2 ? jit_index_of_any_char_avx2 : jit_index_of_any_char);
+
+    g_jit_last_index_of_byte = spidir_module_create_extern_function(m_jit_module,
+        "jit_last_index_of_byte",
+        SPIDIR_TYPE_I32,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_last_index_of_byte,
+        avx2 ? jit_last_index_of_byte_avx2 : jit_last_index_of_byte);
+
+    g_jit_last_index_of_char = spidir_module_create_extern_function(m_jit_module,
+        "jit_last_index_of_char",
+        SPIDIR_TYPE_I32,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_last_index_of_char,
+        avx2 ? jit_last_index_of_char_avx2 : jit_last_index_of_char);
+
+    g_jit_sequence_equal = spidir_module_create_extern_function(m_jit_module,
+        "jit_sequence_equal",
+        SPIDIR_TYPE_I32,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_sequence_equal,
+        avx2 ? jit_sequence_equal_avx2 : jit_sequence_equal);
+
+    g_jit_fill_1 = spidir_module_create_extern_function(m_jit_module,
+        "jit_fill_1",
+        SPIDIR_TYPE_NONE,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I64, SPIDIR_TYPE_I32 }
+    );
+    // memset is already vectorized by the host
+    hmput(m_jit_helper_lookup, g_jit_fill_1, jit_fill_1);
+
+    g_jit_fill_2 = spidir_module_create_extern_function(m_jit_module,
+        "jit_fill_2",
+        SPIDIR_TYPE_NONE,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I64, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_fill_2,
+        avx2 ? jit_fill_2_avx2 : jit_fill_2);
+
+    g_jit_fill_4 = spidir_module_create_extern_function(m_jit_module,
+        "jit_fill_4",
+        SPIDIR_TYPE_NONE,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I64, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_fill_4,
+        avx2 ? jit_fill_4_avx2 : jit_fill_4);
+
+    g_jit_fill_8 = spidir_module_create_extern_function(m_jit_module,
+        "jit_fill_8",
+        SPIDIR_TYPE_NONE,
+        3, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I64, SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_fill_8,
+        avx2 ? jit_fill_8_avx2 : jit_fill_8);
+
+    g_jit_mul_high_u64 = spidir_module_create_extern_function(m_jit_module,
+        "jit_mul_high_u64",
+        SPIDIR_TYPE_I64,
+        2, (spidir_value_type_t[]){ SPIDIR_TYPE_I64, SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_mul_high_u64, jit_mul_high_u64);
+
+    g_jit_mul_high_s64 = spidir_module_create_extern_function(m_jit_module,
+        "jit_mul_high_s64",
+        SPIDIR_TYPE_I64,
+        2, (spidir_value_type_t[]){ SPIDIR_TYPE_I64, SPIDIR_TYPE_I64 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_mul_high_s64, jit_mul_high_s64);
+
+    // the 128bit vectors only need sse2, the 256bit ones are done
+    // in two halves when the cpu does not have avx2
+    g_jit_vector128_add = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector128_add",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector128_add, jit_vector128_add);
+
+    g_jit_vector128_subtract = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector128_subtract",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector128_subtract, jit_vector128_subtract);
+
+    g_jit_vector128_equals = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector128_equals",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector128_equals, jit_vector128_equals);
+
+    g_jit_vector128_extract_most_significant_bits = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector128_extract_most_significant_bits",
+        SPIDIR_TYPE_I32,
+        2, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector128_extract_most_significant_bits,
+        jit_vector128_extract_most_significant_bits);
+
+    g_jit_vector256_add = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector256_add",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector256_add,
+        avx2 ? jit_vector256_add_avx2 : jit_vector256_add);
+
+    g_jit_vector256_subtract = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector256_subtract",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector256_subtract,
+        avx2 ? jit_vector256_subtract_avx2 : jit_vector256_subtract);
+
+    g_jit_vector256_equals = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector256_equals",
+        SPIDIR_TYPE_NONE,
+        4, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector256_equals,
+        avx2 ? jit_vector256_equals_avx2 : jit_vector256_equals);
+
+    g_jit_vector256_extract_most_significant_bits = spidir_module_create_extern_function(m_jit_module,
+        "jit_vector256_extract_most_significant_bits",
+        SPIDIR_TYPE_I32,
+        2, (spidir_value_type_t[]){ SPIDIR_TYPE_PTR, SPIDIR_TYPE_I32 }
+    );
+    hmput(m_jit_helper_lookup, g_jit_vector256_extract_most_significant_bits,
+        avx2 ? jit_vector256_extract_most_significant_bits_avx2 : jit_vector256_extract_most_significant_bits);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -210,6 +498,8 @@ static spidir_value_type_t get_spidir_type(RuntimeTypeInfo info) {
         return SPIDIR_TYPE_I32;
     } else if (info == tInt64 || info == tIntPtr) {
         return SPIDIR_TYPE_I64;
+    } else if (info == tDouble) {
+        return SPIDIR_TYPE_F64;
     } else {
         return SPIDIR_TYPE_PTR;
     }
@@ -231,6 +521,8 @@ spidir_value_type_t jit_get_spidir_ret_type(RuntimeMethodBase method) {
         return SPIDIR_TYPE_I32;
     } else if (type == tInt64 || type == tIntPtr) {
         return SPIDIR_TYPE_I64;
+    } else if (type == tDouble) {
+        return SPIDIR_TYPE_F64;
     } else if (jit_is_struct_like(type)) {
         // things which act like a struct return by using reference
         return SPIDIR_TYPE_NONE;
@@ -267,28 +559,12 @@ spidir_value_type_t* jit_get_spidir_arg_types(RuntimeMethodBase method) {
 }
 
 
-static jit_basic_block_t* get_basic_block(jit_method_t* method, long target_pc, long leave_target) {
+static jit_basic_block_t* get_basic_block(jit_method_t* method, long target_pc) {
     int bi = hmgeti(method->labels, target_pc);
     if (bi < 0) {
         return NULL;
     }
-    jit_basic_block_t* block = method->labels[bi].value;
-
-    // lookup based on the leave target
-    if (leave_target >= 0) {
-        jit_leave_block_key_t key = {
-            .block = block,
-            .leave_target = leave_target
-        };
-
-        int bi = hmgeti(method->leave_blocks, key);
-        if (bi < 0) {
-            return NULL;
-        }
-        block = method->leave_blocks[bi].value;
-    }
-
-    return block;
+    return method->labels[bi].value;
 }
 
 static void jit_queue_block(jit_method_t* method, spidir_builder_handle_t builder, jit_basic_block_t* block) {
@@ -305,7 +581,7 @@ static void jit_queue_block(jit_method_t* method, spidir_builder_handle_t builde
             ASSERT(spidir_builder_cur_block(builder, &current));
             spidir_builder_set_block(builder, block->block);
 
-            for (int i = 0; i < arrlen(block->stack); i++) {
+            for (int i = 0; i < block->stack_count; i++) {
                 block->stack[i].value = spidir_builder_build_phi(
                     builder,
                     get_spidir_type(block->stack[i].type),
@@ -323,24 +599,16 @@ static void jit_queue_block(jit_method_t* method, spidir_builder_handle_t builde
     }
 }
 
-static long get_leave_target(uint32_t* leave_target_stack) {
-    if (leave_target_stack == NULL) {
-        return -1;
-    }
-    return arrlast(leave_target_stack);
-}
-
 static tdn_err_t emit_merge_basic_block(
     jit_method_t* method,
     spidir_builder_handle_t builder,
     uint32_t target_pc,
     jit_stack_value_t* stack,
-    spidir_block_t* block,
-    long leave_target
+    spidir_block_t* block
 ) {
     tdn_err_t err = TDN_NO_ERROR;
 
-    jit_basic_block_t* target = get_basic_block(method, target_pc, leave_target);
+    jit_basic_block_t* target = get_basic_block(method, target_pc);
     CHECK(target != NULL);
 
     // queue the block, will also handle creating the phi if required
@@ -350,7 +618,7 @@ static tdn_err_t emit_merge_basic_block(
     // TODO: in theory we only need to do this on the entries that are at the top
     //       of the stack to the lowest this block goes
     if (target->needs_phi) {
-        CHECK(arrlen(stack) == arrlen(target->stack));
+        CHECK(arrlen(stack) == target->stack_count);
         for (int i = 0; i < arrlen(stack); i++) {
             spidir_builder_add_phi_input(builder,
                 target->stack[i].phi,
@@ -370,6 +638,215 @@ cleanup:
     return err;
 }
 
+typedef struct jit_switch_range {
+    // the first case of the range
+    uint32_t low;
+
+    // the pc all the cases in the range go to
+    uint32_t target;
+} jit_switch_range_t;
+
+/**
+ * Add the next case to the ranges, returns the new amount of ranges
+ */
+static size_t add_switch_case(jit_switch_range_t* ranges, size_t count, uint32_t value, uint32_t target) {
+    if (count == 0 || ranges[count - 1].target != target) {
+        ranges[count++] = (jit_switch_range_t){ .low = value, .target = target };
+    }
+    return count;
+}
+
+/**
+ * Get the block for one side of a switch compare, if the side has a single range
+ * then we can jump to the target directly, otherwise we need a new block for the
+ * rest of the tree
+ */
+static tdn_err_t emit_switch_side(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    jit_stack_value_t* stack,
+    jit_switch_range_t* ranges, size_t count,
+    spidir_block_t* block
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    if (count == 1) {
+        CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, ranges[0].target, stack, block));
+    } else {
+        *block = spidir_builder_create_block(builder);
+    }
+
+cleanup:
+    return err;
+}
+
+/**
+ * Emit a balanced compare tree over the ranges, the value is already known to be
+ * inside of the ranges
+ */
+static tdn_err_t emit_switch_tree(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    jit_stack_value_t* stack,
+    spidir_value_t value, spidir_value_type_t type,
+    jit_switch_range_t* ranges, size_t count
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // split the ranges in half, the lower half is everything
+    // that is below the first case of the upper half
+    size_t half = count / 2;
+    spidir_value_t cond = spidir_builder_build_icmp(builder,
+        SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32,
+        value, spidir_builder_build_iconst(builder, type, ranges[half].low));
+
+    // the order matters, the phi inputs must be added in the same order
+    // as the edges are created
+    spidir_block_t lower, upper;
+    CHECK_AND_RETHROW(emit_switch_side(method, builder, stack, ranges, half, &lower));
+    CHECK_AND_RETHROW(emit_switch_side(method, builder, stack, ranges + half, count - half, &upper));
+    spidir_builder_build_brcond(builder, cond, lower, upper);
+
+    if (half > 1) {
+        spidir_builder_set_block(builder, lower);
+        CHECK_AND_RETHROW(emit_switch_tree(method, builder, stack, value, type, ranges, half));
+    }
+
+    if (count - half > 1) {
+        spidir_builder_set_block(builder, upper);
+        CHECK_AND_RETHROW(emit_switch_tree(method, builder, stack, value, type, ranges + half, count - half));
+    }
+
+cleanup:
+    return err;
+}
+
+static tdn_err_t jit_emit_exception_dispatch(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    uint32_t pc, int first, spidir_value_t exception);
+
+/**
+ * Go to the continuation the selector of the finally points to
+ */
+static tdn_err_t emit_finally_dispatch(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    jit_stack_value_t* stack,
+    RuntimeExceptionHandlingClause clause
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+    int index = jit_get_clause_index(method, clause);
+    CHECK(index >= 0);
+    jit_finally_t* finally = &method->finallies[index];
+    size_t count = arrlen(finally->continuations);
+
+    // the handler is reached by a leave or by an
+    // exception, so it must have somewhere to go to
+    CHECK(count > 0 || finally->unwinds);
+
+    if (finally->unwinds) {
+        // the selector is past the continuations when the handler ran for an
+        // exception, a fault only ever runs for one so there is nothing to check
+        spidir_block_t leave;
+        if (count > 0) {
+            spidir_value_t selector = spidir_builder_build_load(builder,
+                SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I32,
+                finally->selector);
+            spidir_value_t is_unwind = spidir_builder_build_icmp(builder,
+                SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32,
+                selector, spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, count));
+
+            spidir_block_t unwind = spidir_builder_create_block(builder);
+            leave = spidir_builder_create_block(builder);
+            spidir_builder_build_brcond(builder, is_unwind, unwind, leave);
+            spidir_builder_set_block(builder, unwind);
+        }
+
+        // keep unwinding from the try to the clauses around it
+        spidir_value_t exception = spidir_builder_build_load(builder,
+            SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_PTR,
+            method->exception_slots[index]);
+        CHECK_AND_RETHROW(jit_emit_exception_dispatch(method, builder, clause->TryOffset, index + 1, exception));
+
+        if (count == 0) {
+            goto cleanup;
+        }
+
+        // the rest goes to the continuations of the leaves
+        spidir_builder_set_block(builder, leave);
+    }
+
+    jit_switch_range_t* ranges = jit_alloc(sizeof(jit_switch_range_t) * count);
+    CHECK_ERROR(ranges != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    size_t range_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        range_count = add_switch_case(ranges, range_count, i, finally->continuations[i]);
+    }
+
+    if (range_count == 1) {
+        // only one place to go to
+        spidir_block_t target;
+        CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, ranges[0].target, stack, &target));
+        spidir_builder_build_branch(builder, target);
+    } else {
+        // the selector is always in range, no need to check it
+        spidir_value_t selector = spidir_builder_build_load(builder,
+            SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I32,
+            finally->selector);
+        CHECK_AND_RETHROW(emit_switch_tree(method, builder, stack, selector, SPIDIR_TYPE_I32, ranges, range_count));
+    }
+
+cleanup:
+    return err;
+}
+
+/**
+ * Emit the switch instruction, spidir has no indirect branches so we can't have an actual
+ * jump table, instead the consecutive cases that go to the same place are merged and
+ * we emit a balanced compare tree over them, so we pay log(n) compares at most
+ */
+static tdn_err_t emit_switch(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    jit_stack_value_t* stack,
+    jit_stack_value_t* value, tdn_il_inst_t* inst, uint32_t next_pc
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+    uint32_t count = inst->operand.switch_table.count;
+
+    // nothing to switch on, just go to the next instruction
+    if (count == 0) {
+        spidir_block_t next;
+        CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, next_pc, stack, &next));
+        spidir_builder_build_branch(builder, next);
+        goto cleanup;
+    }
+
+    // merge cases into ranges
+    jit_switch_range_t* ranges = jit_alloc(sizeof(jit_switch_range_t) * count);
+    CHECK_ERROR(ranges != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    size_t range_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        range_count = add_switch_case(ranges, range_count, i, tdn_get_switch_target(inst, i));
+    }
+
+    // anything outside of the table (as unsigned) goes to the next instruction
+    spidir_value_type_t type = get_spidir_type(value->type);
+    spidir_value_t in_range = spidir_builder_build_icmp(builder,
+        SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32,
+        value->value, spidir_builder_build_iconst(builder, type, count));
+
+    spidir_block_t table, next;
+    CHECK_AND_RETHROW(emit_switch_side(method, builder, stack, ranges, range_count, &table));
+    CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, next_pc, stack, &next));
+    spidir_builder_build_brcond(builder, in_range, table, next);
+
+    // and now emit the tree itself
+    if (range_count > 1) {
+        spidir_builder_set_block(builder, table);
+        CHECK_AND_RETHROW(emit_switch_tree(method, builder, stack, value->value, type, ranges, range_count));
+    }
+
+cleanup:
+    return err;
+}
+
 #define EVAL_STACK_PUSH(_type, _value, ...) \
     do { \
         CHECK(arrlen(stack) < body->MaxStackSize); \
@@ -428,21 +905,196 @@ static void jit_register_roots(void* ptr, RuntimeTypeInfo type) {
     }
 }
 
-static tdn_err_t jit_init_static_field(RuntimeFieldInfo field) {
+/**
+ * The static block of a type is aligned to a cache line
+ */
+#define JIT_STATIC_BLOCK_ALIGNMENT 64
+
+tdn_err_t jit_init_static_field(RuntimeFieldInfo field) {
     tdn_err_t err = TDN_NO_ERROR;
 
     if (field->JitFieldPtr != NULL) {
         goto cleanup;
     }
 
-    RuntimeTypeInfo type = field->FieldType;
+    // the offsets were given when the type was filled, the references
+    // come first so we only need to figure how many of them there are
+    RuntimeTypeInfo type = field->DeclaringType;
+    size_t block_size = 0;
+    size_t references = 0;
+    for (int i = 0; i < type->DeclaredFields->Length; i++) {
+        RuntimeFieldInfo static_field = type->DeclaredFields->Elements[i];
+        if (!static_field->Attributes.Static || static_field->Attributes.Literal) {
+            continue;
+        }
+
+        block_size = MAX(block_size, static_field->FieldOffset + static_field->FieldType->StackSize);
+        if (tdn_is_static_reference_field(static_field)) {
+            references++;
+        }
+    }
 
-    // allocate it on the heap, that is the easiest way to do it
-    field->JitFieldPtr = tdn_mallocz(type->StackSize);
-    CHECK_ERROR(field->JitFieldPtr != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    // allocate the block of the whole type at once
+    void* block = tdn_host_mallocz(ALIGN_UP(block_size, JIT_STATIC_BLOCK_ALIGNMENT), JIT_STATIC_BLOCK_ALIGNMENT);
+    CHECK_ERROR(block != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+    // the references are registered as a single range, the rest
+    // might be structs that have references inside of them
+    gc_register_root_range(block, references);
+    for (int i = 0; i < type->DeclaredFields->Length; i++) {
+        RuntimeFieldInfo static_field = type->DeclaredFields->Elements[i];
+        if (!static_field->Attributes.Static || static_field->Attributes.Literal) {
+            continue;
+        }
 
-    // register all the roots to the gc
-    jit_register_roots(field->JitFieldPtr, type);
+        static_field->JitFieldPtr = block + static_field->FieldOffset;
+        if (static_field->FieldOffset >= references * sizeof(void*)) {
+            jit_register_roots(static_field->JitFieldPtr, static_field->FieldType);
+        }
+    }
+
+cleanup:
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Lazy type initialization
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The init state of all the types that have a lazy cctor
+ */
+static struct {
+    RuntimeTypeInfo key;
+    jit_type_init_state_t* value;
+}* m_type_init_states = NULL;
+
+tdn_err_t jit_get_type_init_state(RuntimeTypeInfo type, jit_type_init_state_t** out_state) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    jit_type_init_state_t* state = hmget(m_type_init_states, type);
+    if (state == NULL) {
+        state = tdn_mallocz(sizeof(*state));
+        CHECK_ERROR(state != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        state->type = type;
+        hmput(m_type_init_states, type, state);
+    }
+
+    *out_state = state;
+
+cleanup:
+    return err;
+}
+
+/**
+ * Emit the init check against the given state, either a constant or
+ * the state of the exact type taken from the dictionary
+ */
+static void jit_emit_init_state_check(spidir_builder_handle_t builder, spidir_value_t state_ptr) {
+    // the fast path is a single load and compare
+    spidir_value_t initialized = spidir_builder_build_load(builder,
+        SPIDIR_MEM_SIZE_1, SPIDIR_TYPE_I32,
+        spidir_builder_build_ptroff(builder, state_ptr,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, offsetof(jit_type_init_state_t, initialized))));
+    spidir_value_t needs_init = spidir_builder_build_icmp(builder,
+        SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32,
+        initialized, spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, 0));
+
+    spidir_block_t init = spidir_builder_create_block(builder);
+    spidir_block_t done = spidir_builder_create_block(builder);
+    spidir_builder_build_brcond(builder, needs_init, init, done);
+
+    // run the cctor, the helper takes care of
+    // it only running once
+    spidir_builder_set_block(builder, init);
+    spidir_builder_build_call(builder, m_jit_run_type_initializer, 1, (spidir_value_t[]){ state_ptr });
+    spidir_builder_build_branch(builder, done);
+
+    spidir_builder_set_block(builder, done);
+}
+
+static tdn_err_t jit_emit_type_init_check(spidir_builder_handle_t builder, RuntimeTypeInfo type) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    jit_type_init_state_t* state = NULL;
+    CHECK_AND_RETHROW(jit_get_type_init_state(type, &state));
+    jit_emit_init_state_check(builder, spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)state));
+
+cleanup:
+    return err;
+}
+
+/**
+ * Does accessing the static field need an init check, not needed from inside
+ * the methods of the type that already check on entry, or from the cctor itself
+ */
+static bool jit_static_field_needs_init_check(RuntimeMethodBase method, RuntimeFieldInfo field) {
+    RuntimeTypeInfo type = field->DeclaringType;
+    if (!jit_type_needs_lazy_init(type)) {
+        return false;
+    }
+
+    if (method->DeclaringType == type && (jit_method_checks_init_on_entry(method) || method == (RuntimeMethodBase)type->TypeInitializer)) {
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Generic dictionary
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Load the dictionary of the type of this on entry, the vtable of the object has the
+ * dictionaries of all the shared generic types in its hierarchy, by their depth
+ */
+static void jit_emit_load_dictionary(spidir_builder_handle_t builder, jit_method_t* method) {
+    spidir_value_t vtable = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I64,
+        spidir_builder_build_param_ref(builder, 0));
+    vtable = spidir_builder_build_inttoptr(builder, vtable);
+
+    spidir_value_t dictionaries = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_PTR,
+        spidir_builder_build_ptroff(builder, vtable,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, offsetof(ObjectVTable, GenericDictionaries))));
+
+    method->dictionary_ptr = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_PTR,
+        spidir_builder_build_ptroff(builder, dictionaries,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, method->dictionary->depth * sizeof(void*))));
+}
+
+static spidir_value_t jit_emit_dictionary_entry(spidir_builder_handle_t builder, jit_method_t* method, int slot, spidir_value_type_t type) {
+    return spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, type,
+        spidir_builder_build_ptroff(builder, method->dictionary_ptr,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, slot * sizeof(void*))));
+}
+
+/**
+ * Get the address of a static field, checking that the cctor of its type ran if needed, the
+ * shared code takes the field of the exact type from the dictionary
+ */
+static tdn_err_t jit_emit_static_field_address(spidir_builder_handle_t builder, jit_method_t* jmethod, tdn_il_inst_t* inst, spidir_value_t* out_ptr) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeFieldInfo field = inst->operand.field;
+    bool needs_init_check = jit_static_field_needs_init_check(jmethod->method, field);
+
+    int slot = jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_STATIC_FIELD, inst->operand_token);
+    if (slot < 0) {
+        CHECK_AND_RETHROW(jit_init_static_field(field));
+        if (needs_init_check) {
+            CHECK_AND_RETHROW(jit_emit_type_init_check(builder, field->DeclaringType));
+        }
+        *out_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+        goto cleanup;
+    }
+
+    if (needs_init_check) {
+        int init_slot = jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_FIELD_TYPE_INIT, inst->operand_token);
+        CHECK(init_slot >= 0);
+        jit_emit_init_state_check(builder, jit_emit_dictionary_entry(builder, jmethod, init_slot, SPIDIR_TYPE_PTR));
+    }
+
+    *out_ptr = jit_emit_dictionary_entry(builder, jmethod, slot, SPIDIR_TYPE_PTR);
 
 cleanup:
     return err;
@@ -668,13 +1320,339 @@ static bool jit_convert_interface(
             spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, offsetof(Interface, VTable)));
         spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, vtable, dest);
 
-    } else {
-        // nothing was needed to be done
-        // so we did not emit a store at all
-        return false;
-    }
+    } else {
+        // nothing was needed to be done
+        // so we did not emit a store at all
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Float emit helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// spidir only has a 64bit float type, F values are kept as doubles and float32 is converted
+// inline by working on the bits, normal numbers only need a few integer operations while
+// zeros, subnormals, infinities and NaNs take a separate block
+//
+
+static spidir_value_t jit_emit_i64(spidir_builder_handle_t builder, uint64_t value) {
+    return spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, value);
+}
+
+static spidir_value_t jit_emit_f64(spidir_builder_handle_t builder, uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return spidir_builder_build_fconst(builder, value);
+}
+
+/**
+ * Turn the 0/1 result of an icmp into a 0/1 int64
+ */
+static spidir_value_t jit_emit_cond_to_i64(spidir_builder_handle_t builder, spidir_value_t cond) {
+    return spidir_builder_build_and(builder, spidir_builder_build_iext(builder, cond), jit_emit_i64(builder, 1));
+}
+
+/**
+ * Returns a if the 0/1 int64 condition is set, otherwise b, without branching
+ */
+static spidir_value_t jit_emit_select_i64(spidir_builder_handle_t builder, spidir_value_t cond, spidir_value_t a, spidir_value_t b) {
+    spidir_value_t mask = spidir_builder_build_isub(builder, jit_emit_i64(builder, 0), cond);
+    spidir_value_t diff = spidir_builder_build_xor(builder, a, b);
+    return spidir_builder_build_xor(builder, b, spidir_builder_build_and(builder, diff, mask));
+}
+
+/**
+ * Move the bits of a 64bit value between the integer and float types, spidir
+ * has no bitcast so it goes through a stack slot
+ */
+static spidir_value_t jit_emit_bitcast(spidir_builder_handle_t builder, spidir_value_type_t type, spidir_value_t value) {
+    spidir_value_t slot = spidir_builder_build_stackslot(builder, 8, 8);
+    spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, value, slot);
+    return spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, type, slot);
+}
+
+/**
+ * Create the block that joins the paths of a conversion, with a phi for the result
+ */
+static spidir_block_t jit_emit_join_block(spidir_builder_handle_t builder, spidir_value_type_t type, spidir_value_t* value, spidir_phi_t* phi) {
+    spidir_block_t current;
+    ASSERT(spidir_builder_cur_block(builder, &current));
+
+    spidir_block_t join = spidir_builder_create_block(builder);
+    spidir_builder_set_block(builder, join);
+    *value = spidir_builder_build_phi(builder, type, 0, NULL, phi);
+    spidir_builder_set_block(builder, current);
+
+    return join;
+}
+
+/**
+ * float32 bits -> F, always exact
+ */
+static spidir_value_t jit_emit_single_to_double(spidir_builder_handle_t builder, spidir_value_t bits) {
+    spidir_value_t result;
+    spidir_phi_t result_phi;
+    spidir_block_t done = jit_emit_join_block(builder, SPIDIR_TYPE_F64, &result, &result_phi);
+    spidir_block_t normal = spidir_builder_create_block(builder);
+    spidir_block_t special = spidir_builder_create_block(builder);
+
+    spidir_value_t value = spidir_builder_build_and(builder,
+        spidir_builder_build_iext(builder, bits), jit_emit_i64(builder, UINT32_MAX));
+    spidir_value_t sign = spidir_builder_build_shl(builder,
+        spidir_builder_build_lshr(builder, value, jit_emit_i64(builder, 31)), jit_emit_i64(builder, 63));
+    spidir_value_t abs = spidir_builder_build_and(builder, value, jit_emit_i64(builder, 0x7FFFFFFF));
+    spidir_value_t exponent = spidir_builder_build_lshr(builder, abs, jit_emit_i64(builder, 23));
+
+    // exponents 1 to 254 are normal numbers
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32,
+            spidir_builder_build_isub(builder, exponent, jit_emit_i64(builder, 1)),
+            jit_emit_i64(builder, 254)),
+        normal, special);
+
+    // move the mantissa up and rebias the exponent from 127 to 1023
+    spidir_builder_set_block(builder, normal);
+    spidir_value_t normal_bits = spidir_builder_build_iadd(builder,
+        spidir_builder_build_shl(builder, abs, jit_emit_i64(builder, 29)),
+        jit_emit_i64(builder, 896ull << 52));
+    normal_bits = spidir_builder_build_or(builder, normal_bits, sign);
+    spidir_builder_add_phi_input(builder, result_phi, jit_emit_bitcast(builder, SPIDIR_TYPE_F64, normal_bits));
+    spidir_builder_build_branch(builder, done);
+
+    // the rest is mantissa * 2^-149 for zeros and subnormals, and 1 * inf
+    // or 0 * inf for infinities and NaNs, with the sign in the scale
+    spidir_builder_set_block(builder, special);
+    spidir_value_t is_max = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, exponent, jit_emit_i64(builder, 255)));
+    spidir_value_t mantissa = spidir_builder_build_and(builder, abs, jit_emit_i64(builder, 0x7FFFFF));
+    spidir_value_t mantissa_zero = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, mantissa, jit_emit_i64(builder, 0)));
+    spidir_value_t multiplier = jit_emit_select_i64(builder, is_max, mantissa_zero, mantissa);
+    spidir_value_t scale = jit_emit_select_i64(builder, is_max,
+        jit_emit_i64(builder, 2047ull << 52), jit_emit_i64(builder, 874ull << 52));
+    scale = jit_emit_bitcast(builder, SPIDIR_TYPE_F64, spidir_builder_build_or(builder, scale, sign));
+    spidir_builder_add_phi_input(builder, result_phi, spidir_builder_build_fmul(builder,
+        spidir_builder_build_uinttofloat(builder, SPIDIR_TYPE_F64, multiplier), scale));
+    spidir_builder_build_branch(builder, done);
+
+    spidir_builder_set_block(builder, done);
+    return result;
+}
+
+/**
+ * F -> float32 bits, rounded to nearest even
+ */
+static spidir_value_t jit_emit_double_to_single(spidir_builder_handle_t builder, spidir_value_t value) {
+    spidir_value_t result;
+    spidir_phi_t result_phi;
+    spidir_block_t done = jit_emit_join_block(builder, SPIDIR_TYPE_I64, &result, &result_phi);
+    spidir_block_t normal = spidir_builder_create_block(builder);
+    spidir_block_t special = spidir_builder_create_block(builder);
+    spidir_block_t tiny = spidir_builder_create_block(builder);
+    spidir_block_t huge = spidir_builder_create_block(builder);
+
+    spidir_value_t bits = jit_emit_bitcast(builder, SPIDIR_TYPE_I64, value);
+    spidir_value_t sign = spidir_builder_build_shl(builder,
+        spidir_builder_build_lshr(builder, bits, jit_emit_i64(builder, 63)), jit_emit_i64(builder, 31));
+    spidir_value_t abs = spidir_builder_build_and(builder, bits, jit_emit_i64(builder, INT64_MAX));
+
+    // from the smallest normal float32 up to the first value that rounds to infinity
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32,
+            spidir_builder_build_isub(builder, abs, jit_emit_i64(builder, 0x3810000000000000)),
+            jit_emit_i64(builder, 0x47EFFFFFF0000000 - 0x3810000000000000)),
+        normal, special);
+
+    // rebias the exponent and round the mantissa, a carry
+    // out of the mantissa goes into the exponent
+    spidir_builder_set_block(builder, normal);
+    spidir_value_t rebiased = spidir_builder_build_isub(builder, abs, jit_emit_i64(builder, 896ull << 52));
+    spidir_value_t odd = spidir_builder_build_and(builder,
+        spidir_builder_build_lshr(builder, rebiased, jit_emit_i64(builder, 29)), jit_emit_i64(builder, 1));
+    spidir_value_t rounded = spidir_builder_build_iadd(builder, rebiased,
+        spidir_builder_build_iadd(builder, odd, jit_emit_i64(builder, 0x0FFFFFFF)));
+    spidir_builder_add_phi_input(builder, result_phi,
+        spidir_builder_build_lshr(builder, rounded, jit_emit_i64(builder, 29)));
+    spidir_builder_build_branch(builder, done);
+
+    spidir_builder_set_block(builder, special);
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32, abs, jit_emit_i64(builder, 0x3810000000000000)),
+        tiny, huge);
+
+    // zeros and subnormals, scale so the float32 mantissa is the integer part
+    // and let the addition of 2^52 round it to nearest even
+    spidir_builder_set_block(builder, tiny);
+    spidir_value_t scaled = spidir_builder_build_fmul(builder,
+        jit_emit_bitcast(builder, SPIDIR_TYPE_F64, abs), jit_emit_f64(builder, (1023ull + 149) << 52));
+    spidir_value_t two_52 = jit_emit_f64(builder, (1023ull + 52) << 52);
+    scaled = spidir_builder_build_fsub(builder, spidir_builder_build_fadd(builder, scaled, two_52), two_52);
+    spidir_builder_add_phi_input(builder, result_phi,
+        spidir_builder_build_floattosint(builder, SPIDIR_TYPE_I64, scaled));
+    spidir_builder_build_branch(builder, done);
+
+    // infinity or a quiet NaN
+    spidir_builder_set_block(builder, huge);
+    spidir_value_t is_nan = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32, jit_emit_i64(builder, 0x7FF0000000000000), abs));
+    spidir_builder_add_phi_input(builder, result_phi, spidir_builder_build_or(builder,
+        jit_emit_i64(builder, 0x7F800000),
+        spidir_builder_build_shl(builder, is_nan, jit_emit_i64(builder, 22))));
+    spidir_builder_build_branch(builder, done);
+
+    spidir_builder_set_block(builder, done);
+    return spidir_builder_build_itrunc(builder, spidir_builder_build_or(builder, result, sign));
+}
+
+/**
+ * Round F to float32 precision, it stays an F
+ */
+static spidir_value_t jit_emit_round_to_single(spidir_builder_handle_t builder, spidir_value_t value) {
+    return jit_emit_single_to_double(builder, jit_emit_double_to_single(builder, value));
+}
 
-    return true;
+/**
+ * int64 -> float32 precision F in a single rounding, going through a double would round twice
+ */
+static spidir_value_t jit_emit_int64_to_single(spidir_builder_handle_t builder, spidir_value_t value) {
+    spidir_value_t sign = spidir_builder_build_and(builder, value, jit_emit_i64(builder, 1ull << 63));
+    spidir_value_t negative = spidir_builder_build_ashr(builder, value, jit_emit_i64(builder, 63));
+    spidir_value_t abs = spidir_builder_build_isub(builder,
+        spidir_builder_build_xor(builder, value, negative), negative);
+
+    // values that don't fit in a double keep their top 53 bits, with the
+    // bits that are shifted out folded into the lowest one so the final
+    // rounding still sees them
+    spidir_value_t big = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULE, SPIDIR_TYPE_I32, jit_emit_i64(builder, 1ull << 53), abs));
+    spidir_value_t shift = spidir_builder_build_imul(builder, big, jit_emit_i64(builder, 11));
+    spidir_value_t sticky = spidir_builder_build_and(builder, big, jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32,
+            spidir_builder_build_and(builder, abs, jit_emit_i64(builder, 0x7FF)), jit_emit_i64(builder, 0))));
+    spidir_value_t mantissa = spidir_builder_build_or(builder,
+        spidir_builder_build_lshr(builder, abs, shift), sticky);
+
+    // the scale puts back the shift and the sign, this is exact
+    spidir_value_t scale = spidir_builder_build_or(builder, sign,
+        spidir_builder_build_shl(builder,
+            spidir_builder_build_iadd(builder, shift, jit_emit_i64(builder, 1023)),
+            jit_emit_i64(builder, 52)));
+    spidir_value_t exact = spidir_builder_build_fmul(builder,
+        spidir_builder_build_uinttofloat(builder, SPIDIR_TYPE_F64, mantissa),
+        jit_emit_bitcast(builder, SPIDIR_TYPE_F64, scale));
+
+    return jit_emit_round_to_single(builder, exact);
+}
+
+/**
+ * The remainder of F values, truncated like fmod, which is always exact. The mantissas
+ * are reduced as integers, up to 11 bits of the exponent difference at a time
+ */
+static spidir_value_t jit_emit_fmod(spidir_builder_handle_t builder, spidir_value_t a, spidir_value_t b) {
+    spidir_value_t result;
+    spidir_phi_t result_phi;
+    spidir_block_t done = jit_emit_join_block(builder, SPIDIR_TYPE_F64, &result, &result_phi);
+    spidir_block_t invalid_block = spidir_builder_create_block(builder);
+    spidir_block_t check_smaller = spidir_builder_create_block(builder);
+    spidir_block_t reduce = spidir_builder_create_block(builder);
+    spidir_block_t loop = spidir_builder_create_block(builder);
+    spidir_block_t loop_body = spidir_builder_create_block(builder);
+    spidir_block_t finish = spidir_builder_create_block(builder);
+
+    spidir_value_t a_bits = jit_emit_bitcast(builder, SPIDIR_TYPE_I64, a);
+    spidir_value_t b_bits = jit_emit_bitcast(builder, SPIDIR_TYPE_I64, b);
+    spidir_value_t a_abs = spidir_builder_build_and(builder, a_bits, jit_emit_i64(builder, INT64_MAX));
+    spidir_value_t b_abs = spidir_builder_build_and(builder, b_bits, jit_emit_i64(builder, INT64_MAX));
+
+    // a is infinity or NaN, b is zero or NaN, the result
+    // is NaN, which (a * b) / (a * b) gives us
+    spidir_value_t a_not_finite = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULE, SPIDIR_TYPE_I32, jit_emit_i64(builder, 0x7FF0000000000000), a_abs));
+    spidir_value_t b_zero = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_EQ, SPIDIR_TYPE_I32, b_abs, jit_emit_i64(builder, 0)));
+    spidir_value_t b_nan = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32, jit_emit_i64(builder, 0x7FF0000000000000), b_abs));
+    spidir_value_t invalid = spidir_builder_build_or(builder, a_not_finite, spidir_builder_build_or(builder, b_zero, b_nan));
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32, invalid, jit_emit_i64(builder, 0)),
+        invalid_block, check_smaller);
+
+    spidir_builder_set_block(builder, invalid_block);
+    spidir_value_t product = spidir_builder_build_fmul(builder, a, b);
+    spidir_builder_add_phi_input(builder, result_phi, spidir_builder_build_fdiv(builder, product, product));
+    spidir_builder_build_branch(builder, done);
+
+    // when |a| < |b| (including b being infinity) the result is a
+    spidir_builder_set_block(builder, check_smaller);
+    spidir_builder_add_phi_input(builder, result_phi, a);
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32, a_abs, b_abs),
+        done, reduce);
+
+    // split into integer mantissas and exponents, subnormals have
+    // no implicit bit and the same scale as the exponent 1
+    spidir_builder_set_block(builder, reduce);
+    spidir_value_t mantissa_mask = jit_emit_i64(builder, (1ull << 52) - 1);
+    spidir_value_t a_exponent = spidir_builder_build_lshr(builder, a_abs, jit_emit_i64(builder, 52));
+    spidir_value_t b_exponent = spidir_builder_build_lshr(builder, b_abs, jit_emit_i64(builder, 52));
+    spidir_value_t a_normal = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32, a_exponent, jit_emit_i64(builder, 0)));
+    spidir_value_t b_normal = jit_emit_cond_to_i64(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32, b_exponent, jit_emit_i64(builder, 0)));
+    spidir_value_t a_mantissa = spidir_builder_build_or(builder,
+        spidir_builder_build_and(builder, a_abs, mantissa_mask),
+        spidir_builder_build_shl(builder, a_normal, jit_emit_i64(builder, 52)));
+    spidir_value_t b_mantissa = spidir_builder_build_or(builder,
+        spidir_builder_build_and(builder, b_abs, mantissa_mask),
+        spidir_builder_build_shl(builder, b_normal, jit_emit_i64(builder, 52)));
+    a_exponent = jit_emit_select_i64(builder, a_normal, a_exponent, jit_emit_i64(builder, 1));
+    b_exponent = jit_emit_select_i64(builder, b_normal, b_exponent, jit_emit_i64(builder, 1));
+
+    spidir_value_t start_mantissa = spidir_builder_build_urem(builder, a_mantissa, b_mantissa);
+    spidir_builder_build_branch(builder, loop);
+
+    // every step moves the remainder up by at most 11 bits, the remainder
+    // is below b's mantissa so it never goes past 64 bits
+    spidir_builder_set_block(builder, loop);
+    spidir_phi_t mantissa_phi;
+    spidir_phi_t exponent_phi;
+    spidir_value_t mantissa = spidir_builder_build_phi(builder, SPIDIR_TYPE_I64, 1, &start_mantissa, &mantissa_phi);
+    spidir_value_t exponent = spidir_builder_build_phi(builder, SPIDIR_TYPE_I64, 1, &a_exponent, &exponent_phi);
+    spidir_value_t distance = spidir_builder_build_isub(builder, exponent, b_exponent);
+    spidir_builder_build_brcond(builder,
+        spidir_builder_build_icmp(builder, SPIDIR_ICMP_NE, SPIDIR_TYPE_I32, distance, jit_emit_i64(builder, 0)),
+        loop_body, finish);
+
+    spidir_builder_set_block(builder, loop_body);
+    spidir_value_t step = jit_emit_select_i64(builder,
+        jit_emit_cond_to_i64(builder,
+            spidir_builder_build_icmp(builder, SPIDIR_ICMP_ULT, SPIDIR_TYPE_I32, distance, jit_emit_i64(builder, 11))),
+        distance, jit_emit_i64(builder, 11));
+    spidir_value_t next_mantissa = spidir_builder_build_urem(builder,
+        spidir_builder_build_shl(builder, mantissa, step), b_mantissa);
+    spidir_builder_add_phi_input(builder, mantissa_phi, next_mantissa);
+    spidir_builder_add_phi_input(builder, exponent_phi, spidir_builder_build_isub(builder, exponent, step));
+    spidir_builder_build_branch(builder, loop);
+
+    // the remainder is mantissa * 2^(b_exponent - 1075), done in two exact steps since
+    // 2^-52 and 2^(b_exponent - 1023) are both normal, the sign comes from a
+    spidir_builder_set_block(builder, finish);
+    spidir_value_t scale = spidir_builder_build_or(builder,
+        spidir_builder_build_and(builder, a_bits, jit_emit_i64(builder, 1ull << 63)),
+        spidir_builder_build_shl(builder, b_exponent, jit_emit_i64(builder, 52)));
+    spidir_value_t remainder = spidir_builder_build_fmul(builder,
+        spidir_builder_build_uinttofloat(builder, SPIDIR_TYPE_F64, mantissa),
+        jit_emit_f64(builder, (1023ull - 52) << 52));
+    remainder = spidir_builder_build_fmul(builder, remainder, jit_emit_bitcast(builder, SPIDIR_TYPE_F64, scale));
+    spidir_builder_add_phi_input(builder, result_phi, remainder);
+    spidir_builder_build_branch(builder, done);
+
+    spidir_builder_set_block(builder, done);
+    return result;
 }
 
 static void jit_emit_store(spidir_builder_handle_t builder, spidir_value_t dest, spidir_value_t value, RuntimeTypeInfo dest_type, RuntimeTypeInfo src_type) {
@@ -697,6 +1675,10 @@ static void jit_emit_store(spidir_builder_handle_t builder, spidir_value_t dest,
             // interface -> object
             // just need to load the instance field
             value = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_PTR, value);
+
+        } else if (dest_type == tSingle) {
+            // F -> float32
+            value = jit_emit_double_to_single(builder, value);
         }
 
         // store something that is not a struct
@@ -718,6 +1700,11 @@ static spidir_value_t jit_emit_load(spidir_builder_handle_t builder, spidir_valu
         jit_emit_memcpy(builder, new_struct, src, src_type);
         return new_struct;
 
+    } else if (src_type == tSingle) {
+        // float32 -> F
+        spidir_value_t value = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I32, src);
+        return jit_emit_single_to_double(builder, value);
+
     } else {
         // store something that is not a struct
         // zero extend by default
@@ -795,9 +1782,7 @@ static spidir_value_t jit_emit_array_offset(spidir_builder_handle_t builder, spi
     return spidir_builder_build_ptroff(builder, array, offset);
 }
 
-static spidir_value_t jit_emit_type_check(spidir_builder_handle_t builder, spidir_value_t obj, bool obj_is_interface, RuntimeTypeInfo target) {
-    spidir_value_t vtable = SPIDIR_VALUE_INVALID;
-
+static spidir_value_t jit_emit_load_object_vtable(spidir_builder_handle_t builder, spidir_value_t obj, bool obj_is_interface) {
     // if the object is actually an interface then we are going
     // to load the object first
     if (obj_is_interface) {
@@ -805,8 +1790,48 @@ static spidir_value_t jit_emit_type_check(spidir_builder_handle_t builder, spidi
     }
 
     // load the vtable pointer from the object
-    vtable = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I64, obj);
-    vtable = spidir_builder_build_inttoptr(builder, vtable);
+    spidir_value_t vtable = spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I64, obj);
+    return spidir_builder_build_inttoptr(builder, vtable);
+}
+
+/**
+ * Check the type hierarchy of the object against the one of a class, the
+ * values are either constants or come from the dictionary of shared code
+ */
+static spidir_value_t jit_emit_hierarchy_check(spidir_builder_handle_t builder, spidir_value_t vtable, spidir_value_t expected_hierarchy, spidir_value_t type_mask) {
+    // load the type hierarchy
+    spidir_value_t hierarchy = spidir_builder_build_load(
+        builder,
+        SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
+        spidir_builder_build_ptroff(
+            builder,
+            vtable,
+            spidir_builder_build_iconst(
+                builder,
+                SPIDIR_TYPE_I64,
+                offsetof(ObjectVTable, TypeHierarchy)
+            )
+        )
+    );
+
+    // and now check that the bits at the start of the hierarchy are the same
+    // as the target type
+    //  (obj->type_hierarchy & target->type_mask) == target->type_hierarchy
+    return spidir_builder_build_icmp(
+        builder,
+        SPIDIR_ICMP_EQ,
+        SPIDIR_TYPE_I32,
+        spidir_builder_build_and(
+            builder,
+            hierarchy,
+            type_mask
+        ),
+        expected_hierarchy
+    );
+}
+
+static spidir_value_t jit_emit_type_check(spidir_builder_handle_t builder, spidir_value_t obj, bool obj_is_interface, RuntimeTypeInfo target) {
+    spidir_value_t vtable = jit_emit_load_object_vtable(builder, obj, obj_is_interface);
 
     // and now check
     if (jit_is_interface(target)) {
@@ -861,52 +1886,169 @@ static spidir_value_t jit_emit_type_check(spidir_builder_handle_t builder, spidi
         );
 
     } else {
-        // checking against a normal class
+        // checking against a normal class, build the mask based on the target type
+        return jit_emit_hierarchy_check(builder, vtable,
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, target->JitVTable->TypeHierarchy),
+            spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, (1ull << target->TypeMaskLength) - 1ull));
+    }
+}
 
-        // load the type hierarchy
-        spidir_value_t hierarchy = spidir_builder_build_load(
-            builder,
-            SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_I64,
-            spidir_builder_build_ptroff(
-                builder,
-                vtable,
-                spidir_builder_build_iconst(
-                    builder,
-                    SPIDIR_TYPE_I64,
-                    offsetof(ObjectVTable, TypeHierarchy)
-                )
-            )
-        );
+/**
+ * The type check of a castclass or isinst, shared code checks
+ * against the exact class from the dictionary
+ */
+static spidir_value_t jit_emit_inst_type_check(
+    spidir_builder_handle_t builder, jit_method_t* method, tdn_il_inst_t* inst,
+    spidir_value_t obj, bool obj_is_interface
+) {
+    int hierarchy_slot = jit_dictionary_find(method->dictionary, JIT_DICTIONARY_TYPE_HIERARCHY, inst->operand_token);
+    if (hierarchy_slot < 0) {
+        return jit_emit_type_check(builder, obj, obj_is_interface, inst->operand.type);
+    }
 
-        // the expected hierarchy
-        spidir_value_t expected_hierarchy = spidir_builder_build_iconst(
-            builder,
-            SPIDIR_TYPE_I64,
-            target->JitVTable->TypeHierarchy
-        );
+    int mask_slot = jit_dictionary_find(method->dictionary, JIT_DICTIONARY_TYPE_MASK, inst->operand_token);
+    ASSERT(mask_slot >= 0);
 
-        // build the mask based on the target type
-        spidir_value_t type_mask = spidir_builder_build_iconst(
-            builder,
-            SPIDIR_TYPE_I64,
-            (1ull << target->TypeMaskLength) - 1ull
-        );
+    return jit_emit_hierarchy_check(builder,
+        jit_emit_load_object_vtable(builder, obj, obj_is_interface),
+        jit_emit_dictionary_entry(builder, method, hierarchy_slot, SPIDIR_TYPE_I64),
+        jit_emit_dictionary_entry(builder, method, mask_slot, SPIDIR_TYPE_I64));
+}
 
-        // and now check that the bits at the start of the hierarchy are the same
-        // as the target type
-        //  (obj->type_hierarchy & target->type_mask) == target->type_hierarchy
-        return spidir_builder_build_icmp(
-            builder,
-            SPIDIR_ICMP_EQ,
-            SPIDIR_TYPE_I32,
-            spidir_builder_build_and(
-                builder,
-                hierarchy,
-                type_mask
-            ),
-            expected_hierarchy
-        );
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Exception handling
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The finally handlers that continue to more than one place need a selector
+ */
+static bool jit_finally_has_selector(jit_finally_t* finally) {
+    return arrlen(finally->continuations) + finally->unwinds > 1;
+}
+
+/**
+ * Return from a method whose exception is left for the caller, the
+ * caller never looks at the value so it doesn't matter what it is
+ */
+static void jit_emit_exception_return(spidir_builder_handle_t builder, RuntimeMethodBase method) {
+    spidir_value_t value = SPIDIR_VALUE_INVALID;
+    spidir_value_type_t type = jit_get_spidir_ret_type(method);
+    if (type == SPIDIR_TYPE_F64) {
+        value = spidir_builder_build_fconst(builder, 0.0);
+    } else if (type != SPIDIR_TYPE_NONE) {
+        value = spidir_builder_build_iconst(builder, type, 0);
+    }
+    spidir_builder_build_return(builder, value);
+}
+
+/**
+ * Go to the handler that takes the exception raised at the pc, looking at the clauses whose
+ * try has the pc starting from the given one, the clauses are sorted from the inner most
+ * to the outer most. If none of them takes it then it is left pending for the caller
+ */
+static tdn_err_t jit_emit_exception_dispatch(
+    jit_method_t* method, spidir_builder_handle_t builder,
+    uint32_t pc, int first, spidir_value_t exception
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+    jit_stack_value_t* stack = NULL;
+
+    RuntimeExceptionHandlingClause_Array clauses = method->method->MethodBody->ExceptionHandlingClauses;
+    for (int i = first; clauses != NULL && i < clauses->Length; i++) {
+        RuntimeExceptionHandlingClause clause = clauses->Elements[i];
+        if (pc < clause->TryOffset || clause->TryOffset + clause->TryLength <= pc) {
+            continue;
+        }
+
+        spidir_block_t handler;
+        arrsetlen(stack, 0);
+        if (clause->Flags == COR_ILEXCEPTION_CLAUSE_EXCEPTION) {
+            // a catch of object takes everything, otherwise
+            // check the type and try the next clause if it
+            // doesn't match
+            bool catches_all = clause->CatchType == tObject;
+            spidir_block_t next;
+            if (!catches_all) {
+                spidir_block_t matched = spidir_builder_create_block(builder);
+                next = spidir_builder_create_block(builder);
+                spidir_builder_build_brcond(builder,
+                    jit_emit_type_check(builder, exception, false, clause->CatchType),
+                    matched, next);
+                spidir_builder_set_block(builder, matched);
+            }
+
+            // remember it for a rethrow, and enter the handler with it on the stack
+            spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, exception, method->exception_slots[i]);
+            arrpush(stack, ((jit_stack_value_t){ .type = clause->CatchType, .value = exception }));
+            CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, clause->HandlerOffset, stack, &handler));
+            spidir_builder_build_branch(builder, handler);
+
+            if (catches_all) {
+                goto cleanup;
+            }
+            spidir_builder_set_block(builder, next);
+        } else {
+            // finally and fault handlers always run, once done
+            // they keep unwinding with the exception
+            jit_finally_t* finally = &method->finallies[i];
+            spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, exception, method->exception_slots[i]);
+            if (jit_finally_has_selector(finally)) {
+                spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_4,
+                    spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, arrlen(finally->continuations)),
+                    finally->selector);
+            }
+            CHECK_AND_RETHROW(emit_merge_basic_block(method, builder, clause->HandlerOffset, stack, &handler));
+            spidir_builder_build_branch(builder, handler);
+            goto cleanup;
+        }
     }
+
+    // nothing in here takes it, leave it for the caller
+    spidir_builder_build_call(builder, m_jit_set_pending_exception, 1, (spidir_value_t[]){ exception });
+    jit_emit_exception_return(builder, method->method);
+
+cleanup:
+    arrfree(stack);
+
+    return err;
+}
+
+/**
+ * Check if the call that was just emitted left an exception for us, the fast path is a
+ * single load and compare of the amount of exceptions in flight, only when there are any
+ * we take the one of our thread (if it has one) and dispatch it
+ */
+static tdn_err_t jit_emit_exception_check(jit_method_t* method, spidir_builder_handle_t builder, uint32_t pc) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    spidir_value_t pending = spidir_builder_build_load(builder,
+        SPIDIR_MEM_SIZE_4, SPIDIR_TYPE_I32,
+        spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uintptr_t)&g_jit_pending_exceptions));
+    spidir_value_t any_pending = spidir_builder_build_icmp(builder,
+        SPIDIR_ICMP_NE, SPIDIR_TYPE_I32,
+        pending, spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, 0));
+
+    spidir_block_t take = spidir_builder_create_block(builder);
+    spidir_block_t done = spidir_builder_create_block(builder);
+    spidir_builder_build_brcond(builder, any_pending, take, done);
+
+    // it might be the exception of another thread
+    spidir_builder_set_block(builder, take);
+    spidir_value_t exception = spidir_builder_build_call(builder, m_jit_take_pending_exception, 0, NULL);
+    spidir_value_t has_exception = spidir_builder_build_icmp(builder,
+        SPIDIR_ICMP_NE, SPIDIR_TYPE_I32,
+        exception, spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, 0));
+
+    spidir_block_t raised = spidir_builder_create_block(builder);
+    spidir_builder_build_brcond(builder, has_exception, raised, done);
+
+    spidir_builder_set_block(builder, raised);
+    CHECK_AND_RETHROW(jit_emit_exception_dispatch(method, builder, pc, 0, exception));
+
+    spidir_builder_set_block(builder, done);
+
+cleanup:
+    return err;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1005,8 +2147,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
     }
 
     // copy the initial stack
-    arrsetlen(stack, arrlen(block->stack));
-    memcpy(stack, block->stack, arrlen(block->stack) * sizeof(*stack));
+    arrsetlen(stack, block->stack_count);
+    memcpy(stack, block->stack, block->stack_count * sizeof(*stack));
 
     // move to the block we are emitting
     spidir_builder_set_block(builder, block->block);
@@ -1021,10 +2163,11 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
 
     // get the pc
     tdn_il_inst_t inst = { .control_flow = TDN_IL_CF_FIRST };
+    uint32_t inst_index = block->first_inst;
     uint32_t pc = block->start;
     while (pc < block->end) {
-        // get the instruction
-        CHECK_AND_RETHROW(tdn_disasm_inst(method, pc, &inst));
+        // get the instruction, already decoded when the blocks were found
+        inst = jmethod->insts[inst_index++];
 
 #ifdef JIT_VERBOSE_EMIT
         indent = tdn_disasm_print_start(body, pc, inst, indent);
@@ -1076,11 +2219,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     value = new_struct;
 
                 } else if (jmethod->args[index].spill_required) {
-                    // spilled, need to load it
-                    value = spidir_builder_build_load(builder,
-                        get_spidir_mem_size(arg_type),
-                        get_spidir_type(arg_type),
-                        value);
+                    // spilled, need to load it from the slot of the real type
+                    value = jit_emit_load(builder, value, GET_ARG_TYPE(index), arg_type);
 
                 }
 
@@ -1142,8 +2282,7 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     field_ptr = spidir_builder_build_ptroff(builder, obj.value,
                     spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, field->FieldOffset));
                 } else {
-                    CHECK_AND_RETHROW(jit_init_static_field(field));
-                    field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                    CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
                 }
 
                 // and now emit the store
@@ -1154,14 +2293,29 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 RuntimeFieldInfo field = inst.operand.field;
                 jit_stack_value_t obj = EVAL_STACK_POP();
 
+                // reflection might look at a body that was not parsed yet
+                if (jit_is_method_body_field(field)) {
+                    spidir_value_t value = spidir_builder_build_call(builder, m_jit_get_method_body, 1,
+                        (spidir_value_t[]){ obj.value });
+                    EVAL_STACK_PUSH(tdn_get_intermediate_type(field->FieldType), value);
+                    break;
+                }
+
+                // same for the name of a parameter
+                if (jit_is_parameter_name_field(field)) {
+                    spidir_value_t value = spidir_builder_build_call(builder, m_jit_get_parameter_name, 1,
+                        (spidir_value_t[]){ obj.value });
+                    EVAL_STACK_PUSH(tdn_get_intermediate_type(field->FieldType), value);
+                    break;
+                }
+
                 // get the pointer to the field
                 spidir_value_t field_ptr;
                 if (!field->Attributes.Static) {
                     field_ptr = spidir_builder_build_ptroff(builder, obj.value,
                     spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, field->FieldOffset));
                 } else {
-                    CHECK_AND_RETHROW(jit_init_static_field(field));
-                    field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                    CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
                 }
 
                 // now perform the load
@@ -1182,8 +2336,7 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     field_ptr = spidir_builder_build_ptroff(builder, obj.value,
                     spidir_builder_build_iconst(builder, SPIDIR_TYPE_I64, field->FieldOffset));
                 } else {
-                    CHECK_AND_RETHROW(jit_init_static_field(field));
-                    field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                    CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
                 }
 
                 RuntimeTypeInfo type = tdn_get_verification_type(field->FieldType);
@@ -1195,8 +2348,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 jit_stack_value_t value = EVAL_STACK_POP();
 
                 RuntimeFieldInfo field = inst.operand.field;
-                CHECK_AND_RETHROW(jit_init_static_field(field));
-                spidir_value_t field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                spidir_value_t field_ptr;
+                CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
 
                 jit_emit_store(builder, field_ptr, value.value, field->FieldType, value.type);
             } break;
@@ -1204,8 +2357,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
             case CEE_LDSFLD: {
                 // get the pointer to the field
                 RuntimeFieldInfo field = inst.operand.field;
-                CHECK_AND_RETHROW(jit_init_static_field(field));
-                spidir_value_t field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                spidir_value_t field_ptr;
+                CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
 
                 // now perform the load
                 spidir_value_t value = jit_emit_load(builder, field_ptr, field->FieldType, field->FieldType);
@@ -1216,9 +2369,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
 
             case CEE_LDSFLDA: {
                 // get the pointer to the field
-                RuntimeFieldInfo field = inst.operand.field;
-                CHECK_AND_RETHROW(jit_init_static_field(field));
-                spidir_value_t field_ptr = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)field->JitFieldPtr);
+                spidir_value_t field_ptr;
+                CHECK_AND_RETHROW(jit_emit_static_field_address(builder, jmethod, &inst, &field_ptr));
 
                 RuntimeTypeInfo type = tdn_get_verification_type(inst.operand.field->FieldType);
                 CHECK_AND_RETHROW(tdn_get_byref_type(type, &type));
@@ -1239,6 +2391,17 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 EVAL_STACK_PUSH(tInt64, value);
             } break;
 
+            case CEE_LDC_R4: {
+                // widening to F is exact
+                spidir_value_t value = spidir_builder_build_fconst(builder, inst.operand.float32);
+                EVAL_STACK_PUSH(tDouble, value);
+            } break;
+
+            case CEE_LDC_R8: {
+                spidir_value_t value = spidir_builder_build_fconst(builder, inst.operand.float64);
+                EVAL_STACK_PUSH(tDouble, value);
+            } break;
+
             case CEE_LDNULL: {
                 spidir_value_t value = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, 0);
                 EVAL_STACK_PUSH(tObject, value);
@@ -1346,7 +2509,10 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
 
                 RuntimeTypeInfo obj_type = NULL;
                 bool need_explicit_null_check = false;
+                int new_type_slot = -1;
                 if (inst.opcode == CEE_NEWOBJ) {
+                    new_type_slot = jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_NEW_TYPE, inst.operand_token);
+
                     // perform the allocation, in the case of a struct value
                     // just emit a stack slot and zero it
                     spidir_value_t obj;
@@ -1399,13 +2565,19 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                             }
                         );
                     } else {
+                        // shared code allocates the exact type from the dictionary
+                        spidir_value_t new_type = SPIDIR_VALUE_INVALID;
+                        if (new_type_slot >= 0) {
+                            new_type = jit_emit_dictionary_entry(builder, jmethod, new_type_slot, SPIDIR_TYPE_PTR);
+                        } else {
+                            new_type = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)target->DeclaringType);
+                        }
+
                         // call the gc to create the new object
                         obj = spidir_builder_build_call(builder,
                             m_jit_gc_new,
                             1,
-                            (spidir_value_t[]){
-                                spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)target->DeclaringType)
-                            }
+                            (spidir_value_t[]){ new_type }
                         );
                     }
                     arrins(args, 0, obj);
@@ -1473,11 +2645,11 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     if (constrained_type != NULL) {
                         RuntimeAssembly assembly = constrained_type->Module->Assembly;
                         token_t token = {};
-                        for (int i = 0; i < assembly->Metadata->method_impls_count; i++) {
-                            metadata_method_impl_t* impl = &assembly->Metadata->method_impls[i];
-                            if (impl->class.token != constrained_type->MetadataToken) {
-                                continue;
-                            }
+                        uint32_t impls_count = 0;
+                        metadata_method_impl_t* impls = metadata_find_method_impls(assembly->Metadata,
+                            (token_t){ .token = constrained_type->MetadataToken }, &impls_count);
+                        for (int i = 0; i < impls_count; i++) {
+                            metadata_method_impl_t* impl = &impls[i];
 
                             RuntimeMethodBase decl;
                             CHECK_AND_RETHROW(tdn_assembly_lookup_method(
@@ -1513,6 +2685,7 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 // handle the implicit return value, it is going to be
                 // the last parameter
                 spidir_value_t ret_val_ptr = SPIDIR_VALUE_INVALID;
+                spidir_value_t ret_value = SPIDIR_VALUE_INVALID;
                 ParameterInfo ret_info = target->ReturnParameter;
                 RuntimeTypeInfo ret_type = tdn_get_intermediate_type(ret_info->ParameterType);
                 if (ret_type != tVoid && jit_is_struct_like(ret_type)) {
@@ -1520,10 +2693,18 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     arrpush(args, ret_val_ptr);
                 }
 
+                // builtins that have an inline form replace the call
+                bool inlined = false;
+                if (inst.opcode == CEE_CALL) {
+                    CHECK_AND_RETHROW(jit_emit_inline_builtin(builder, target, args, &ret_value, &inlined));
+                }
+
                 // now emit the call, if its a callvirt we need
                 // to perform an indirect call
-                spidir_value_t ret_value;
-                if (inst.opcode == CEE_CALLVIRT) {
+                if (inlined) {
+                    // nothing to do, the value is already in ret_value
+
+                } else if (inst.opcode == CEE_CALLVIRT) {
                     // resolve the call location
                     spidir_value_t func_addr = SPIDIR_VALUE_INVALID;
                     size_t base_offset = sizeof(void*) * target->VTableOffset;
@@ -1610,12 +2791,19 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     );
                 }
 
+                // the callee might leave an exception for us
+                if (!inlined) {
+                    CHECK_AND_RETHROW(jit_emit_exception_check(jmethod, builder, current_pc));
+                }
+
                 // finally we need to handle the return value
                 if (inst.opcode == CEE_NEWOBJ) {
                     // we can remember the known type to be the one we just created, this will
                     // help us eliminate some indirect calls when we know the exact type that
-                    // was created
-                    EVAL_STACK_PUSH(method->DeclaringType, args[0], .attrs = { .known_type = target->DeclaringType });
+                    // was created, shared code does not know it
+                    EVAL_STACK_PUSH(method->DeclaringType, args[0], .attrs = {
+                        .known_type = new_type_slot < 0 ? target->DeclaringType : NULL
+                    });
 
                 } else if (ret_type != tVoid) {
                     // push the pointer we created for this
@@ -1645,13 +2833,22 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 RuntimeTypeInfo array_type;
                 CHECK_AND_RETHROW(tdn_get_array_type(inst.operand.type, &array_type));
 
+                // shared code allocates the exact array type from the dictionary
+                spidir_value_t array_type_value = SPIDIR_VALUE_INVALID;
+                int slot = jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_ARRAY_TYPE, inst.operand_token);
+                if (slot >= 0) {
+                    array_type_value = jit_emit_dictionary_entry(builder, jmethod, slot, SPIDIR_TYPE_PTR);
+                } else {
+                    array_type_value = spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)array_type);
+                }
+
                 // allocate it
                 spidir_value_t array = spidir_builder_build_call(
                     builder,
                     m_jit_gc_newarr,
                     2,
                     (spidir_value_t[]){
-                        spidir_builder_build_iconst(builder, SPIDIR_TYPE_PTR, (uint64_t)array_type),
+                        array_type_value,
                         element_count
                     }
                 );
@@ -1771,6 +2968,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
             case CEE_LDIND_U1:
             case CEE_LDIND_U2:
             case CEE_LDIND_U4:
+            case CEE_LDIND_R4:
+            case CEE_LDIND_R8:
             case CEE_LDIND_I:
             case CEE_LDIND_REF:
             case CEE_LDOBJ: {
@@ -1794,6 +2993,8 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
             case CEE_STIND_I2:
             case CEE_STIND_I4:
             case CEE_STIND_I8:
+            case CEE_STIND_R4:
+            case CEE_STIND_R8:
             case CEE_STIND_I:
             case CEE_STIND_REF:
             case CEE_STOBJ: {
@@ -1873,29 +3074,44 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     CHECK(value2.type == tInt64);
                     result = tInt64;
 
+                } else if (value1.type == tDouble) {
+                    CHECK(value2.type == tDouble);
+                    result = tDouble;
+
                 } else {
                     CHECK_FAIL();
                 }
 
                 spidir_value_t val;
-                switch (inst.opcode) {
-                    case CEE_ADD_OVF:
-                    case CEE_ADD_OVF_UN:
-                    case CEE_ADD: val = spidir_builder_build_iadd(builder, val1, val2); break;
-                    case CEE_SUB_OVF:
-                    case CEE_SUB_OVF_UN:
-                    case CEE_SUB: val = spidir_builder_build_isub(builder, val1, val2); break;
-                    case CEE_MUL_OVF:
-                    case CEE_MUL_OVF_UN:
-                    case CEE_MUL: val = spidir_builder_build_imul(builder, val1, val2); break;
-                    case CEE_DIV: val = spidir_builder_build_sdiv(builder, val1, val2); break;
-                    case CEE_REM: val = spidir_builder_build_srem(builder, val1, val2); break;
-                    case CEE_DIV_UN: val = spidir_builder_build_udiv(builder, val1, val2); break;
-                    case CEE_REM_UN: val = spidir_builder_build_urem(builder, val1, val2); break;
-                    case CEE_AND: val = spidir_builder_build_and(builder, val1, val2); break;
-                    case CEE_XOR: val = spidir_builder_build_xor(builder, val1, val2); break;
-                    case CEE_OR: val = spidir_builder_build_or(builder, val1, val2); break;
-                    default: CHECK_FAIL();
+                if (result == tDouble) {
+                    switch (inst.opcode) {
+                        case CEE_ADD: val = spidir_builder_build_fadd(builder, val1, val2); break;
+                        case CEE_SUB: val = spidir_builder_build_fsub(builder, val1, val2); break;
+                        case CEE_MUL: val = spidir_builder_build_fmul(builder, val1, val2); break;
+                        case CEE_DIV: val = spidir_builder_build_fdiv(builder, val1, val2); break;
+                        case CEE_REM: val = jit_emit_fmod(builder, val1, val2); break;
+                        default: CHECK_FAIL();
+                    }
+                } else {
+                    switch (inst.opcode) {
+                        case CEE_ADD_OVF:
+                        case CEE_ADD_OVF_UN:
+                        case CEE_ADD: val = spidir_builder_build_iadd(builder, val1, val2); break;
+                        case CEE_SUB_OVF:
+                        case CEE_SUB_OVF_UN:
+                        case CEE_SUB: val = spidir_builder_build_isub(builder, val1, val2); break;
+                        case CEE_MUL_OVF:
+                        case CEE_MUL_OVF_UN:
+                        case CEE_MUL: val = spidir_builder_build_imul(builder, val1, val2); break;
+                        case CEE_DIV: val = spidir_builder_build_sdiv(builder, val1, val2); break;
+                        case CEE_REM: val = spidir_builder_build_srem(builder, val1, val2); break;
+                        case CEE_DIV_UN: val = spidir_builder_build_udiv(builder, val1, val2); break;
+                        case CEE_REM_UN: val = spidir_builder_build_urem(builder, val1, val2); break;
+                        case CEE_AND: val = spidir_builder_build_and(builder, val1, val2); break;
+                        case CEE_XOR: val = spidir_builder_build_xor(builder, val1, val2); break;
+                        case CEE_OR: val = spidir_builder_build_or(builder, val1, val2); break;
+                        default: CHECK_FAIL();
+                    }
                 }
 
                 EVAL_STACK_PUSH(result, val);
@@ -1924,7 +3140,12 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 bool is_64bit = value.type == tInt64 || value.type == tIntPtr;
 
                 spidir_value_t result;
-                if (inst.opcode == CEE_NOT) {
+                if (value.type == tDouble) {
+                    // -0.0 - value flips the sign of zeros correctly as well
+                    result = spidir_builder_build_fsub(builder,
+                        spidir_builder_build_fconst(builder, -0.0),
+                        value.value);
+                } else if (inst.opcode == CEE_NOT) {
                     // emulate not by xoring with FFs
                     result = spidir_builder_build_xor(builder, value.value,
                         spidir_builder_build_iconst(builder,
@@ -1977,22 +3198,41 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     }
                 }
 
-                // choose the kind, spidir doesn't have greater than variants
-                // so we are going to swap whenever there is a need for one
-                spidir_icmp_kind_t kind;
-                switch (inst.opcode) {
-                    case CEE_CEQ: kind = SPIDIR_ICMP_EQ; break;
+                spidir_value_t value;
+                if (value1.type == tDouble) {
+                    // the un variants are true for unordered (NaN) operands
+                    spidir_fcmp_kind_t kind;
+                    switch (inst.opcode) {
+                        case CEE_CEQ: kind = SPIDIR_FCMP_OEQ; break;
 
-                    case CEE_CGT: SWAP(val1, val2);
-                    case CEE_CLT: kind = SPIDIR_ICMP_SLT; break;
+                        case CEE_CGT: SWAP(val1, val2);
+                        case CEE_CLT: kind = SPIDIR_FCMP_OLT; break;
 
-                    case CEE_CGT_UN: SWAP(val1, val2);
-                    case CEE_CLT_UN: kind = SPIDIR_ICMP_ULT; break;
+                        case CEE_CGT_UN: SWAP(val1, val2);
+                        case CEE_CLT_UN: kind = SPIDIR_FCMP_ULT; break;
 
-                    default: CHECK_FAIL();
-                }
+                        default: CHECK_FAIL();
+                    }
 
-                spidir_value_t value = spidir_builder_build_icmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                    value = spidir_builder_build_fcmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                } else {
+                    // choose the kind, spidir doesn't have greater than variants
+                    // so we are going to swap whenever there is a need for one
+                    spidir_icmp_kind_t kind;
+                    switch (inst.opcode) {
+                        case CEE_CEQ: kind = SPIDIR_ICMP_EQ; break;
+
+                        case CEE_CGT: SWAP(val1, val2);
+                        case CEE_CLT: kind = SPIDIR_ICMP_SLT; break;
+
+                        case CEE_CGT_UN: SWAP(val1, val2);
+                        case CEE_CLT_UN: kind = SPIDIR_ICMP_ULT; break;
+
+                        default: CHECK_FAIL();
+                    }
+
+                    value = spidir_builder_build_icmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                }
                 EVAL_STACK_PUSH(tInt32, value);
             } break;
 
@@ -2009,6 +3249,12 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     } else {
                         val = spidir_builder_build_sfill(builder, 32, val);
                     }
+                } else if (value.type == tDouble) {
+                    if (inst.opcode == CEE_CONV_U) {
+                        val = spidir_builder_build_floattouint(builder, SPIDIR_TYPE_I64, val);
+                    } else {
+                        val = spidir_builder_build_floattosint(builder, SPIDIR_TYPE_I64, val);
+                    }
                 }
 
                 EVAL_STACK_PUSH(tIntPtr, val);
@@ -2027,6 +3273,12 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     } else {
                         val = spidir_builder_build_sfill(builder, 32, val);
                     }
+                } else if (value.type == tDouble) {
+                    if (inst.opcode == CEE_CONV_U8) {
+                        val = spidir_builder_build_floattouint(builder, SPIDIR_TYPE_I64, val);
+                    } else {
+                        val = spidir_builder_build_floattosint(builder, SPIDIR_TYPE_I64, val);
+                    }
                 }
 
                 EVAL_STACK_PUSH(tInt64, val);
@@ -2041,11 +3293,18 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 jit_stack_value_t value = EVAL_STACK_POP();
 
                 spidir_value_t val = value.value;
-                if (value.type == tInt64 || value.type == tIntPtr) {
+                if (value.type == tDouble) {
+                    // go through a 64bit integer so the full uint32 range
+                    // converts properly, then narrow it like any int64
+                    val = spidir_builder_build_floattosint(builder, SPIDIR_TYPE_I64, val);
+                    val = spidir_builder_build_itrunc(builder, val);
+
+                } else if (value.type == tInt64 || value.type == tIntPtr) {
                     // just need to truncate it
                     val = spidir_builder_build_itrunc(builder, val);
+                }
 
-                } else if (inst.opcode == CEE_CONV_U2) {
+                if (inst.opcode == CEE_CONV_U2) {
                     val = spidir_builder_build_and(builder, val,
                         spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, UINT16_MAX));
 
@@ -2063,6 +3322,36 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 EVAL_STACK_PUSH(tInt32, val);
             } break;
 
+            case CEE_CONV_R4:
+            case CEE_CONV_R8:
+            case CEE_CONV_R_UN: {
+                jit_stack_value_t value = EVAL_STACK_POP();
+
+                spidir_value_t val = value.value;
+                if (inst.opcode == CEE_CONV_R4 && (value.type == tInt64 || value.type == tIntPtr)) {
+                    // not every int64 fits in a double, so converting through
+                    // one would round twice, do it in a single step instead
+                    val = jit_emit_int64_to_single(builder, val);
+                    EVAL_STACK_PUSH(tDouble, val);
+                    break;
+                }
+
+                if (value.type != tDouble) {
+                    if (inst.opcode == CEE_CONV_R_UN) {
+                        val = spidir_builder_build_uinttofloat(builder, SPIDIR_TYPE_F64, val);
+                    } else {
+                        val = spidir_builder_build_sinttofloat(builder, SPIDIR_TYPE_F64, val);
+                    }
+                }
+
+                // the value must lose the extra precision
+                if (inst.opcode == CEE_CONV_R4) {
+                    val = jit_emit_round_to_single(builder, val);
+                }
+
+                EVAL_STACK_PUSH(tDouble, val);
+            } break;
+
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
             // Branching
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2112,44 +3401,68 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     }
                 }
 
-                // choose the kind, spidir doesn't have greater than variants
-                // so we are going to swap whenever there is a need for one
-                spidir_icmp_kind_t kind;
-                switch (inst.opcode) {
-                    case CEE_BEQ: kind = SPIDIR_ICMP_EQ; break;
-                    case CEE_BNE_UN: kind = SPIDIR_ICMP_NE; break;
+                spidir_value_t value;
+                if (value1.type == tDouble) {
+                    // the un variants are true for unordered (NaN) operands
+                    spidir_fcmp_kind_t kind;
+                    switch (inst.opcode) {
+                        case CEE_BEQ: kind = SPIDIR_FCMP_OEQ; break;
+                        case CEE_BNE_UN: kind = SPIDIR_FCMP_UNE; break;
 
-                    case CEE_BGE: SWAP(val1, val2);
-                    case CEE_BLE: kind = SPIDIR_ICMP_SLE; break;
+                        case CEE_BGE: SWAP(val1, val2);
+                        case CEE_BLE: kind = SPIDIR_FCMP_OLE; break;
 
-                    case CEE_BGT: SWAP(val1, val2);
-                    case CEE_BLT: kind = SPIDIR_ICMP_SLT; break;
+                        case CEE_BGT: SWAP(val1, val2);
+                        case CEE_BLT: kind = SPIDIR_FCMP_OLT; break;
 
-                    case CEE_BGE_UN: SWAP(val1, val2);
-                    case CEE_BLE_UN: kind = SPIDIR_ICMP_ULE; break;
+                        case CEE_BGE_UN: SWAP(val1, val2);
+                        case CEE_BLE_UN: kind = SPIDIR_FCMP_ULE; break;
 
-                    case CEE_BGT_UN: SWAP(val1, val2);
-                    case CEE_BLT_UN: kind = SPIDIR_ICMP_ULT; break;
+                        case CEE_BGT_UN: SWAP(val1, val2);
+                        case CEE_BLT_UN: kind = SPIDIR_FCMP_ULT; break;
 
-                    default: CHECK_FAIL();
-                }
+                        default: CHECK_FAIL();
+                    }
+
+                    value = spidir_builder_build_fcmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                } else {
+                    // choose the kind, spidir doesn't have greater than variants
+                    // so we are going to swap whenever there is a need for one
+                    spidir_icmp_kind_t kind;
+                    switch (inst.opcode) {
+                        case CEE_BEQ: kind = SPIDIR_ICMP_EQ; break;
+                        case CEE_BNE_UN: kind = SPIDIR_ICMP_NE; break;
+
+                        case CEE_BGE: SWAP(val1, val2);
+                        case CEE_BLE: kind = SPIDIR_ICMP_SLE; break;
+
+                        case CEE_BGT: SWAP(val1, val2);
+                        case CEE_BLT: kind = SPIDIR_ICMP_SLT; break;
+
+                        case CEE_BGE_UN: SWAP(val1, val2);
+                        case CEE_BLE_UN: kind = SPIDIR_ICMP_ULE; break;
+
+                        case CEE_BGT_UN: SWAP(val1, val2);
+                        case CEE_BLT_UN: kind = SPIDIR_ICMP_ULT; break;
+
+                        default: CHECK_FAIL();
+                    }
 
-                spidir_value_t value = spidir_builder_build_icmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                    value = spidir_builder_build_icmp(builder, kind, SPIDIR_TYPE_I32, val1, val2);
+                }
 
                 // get the blocks of each option
                 spidir_block_t true_block;
                 CHECK_AND_RETHROW(emit_merge_basic_block(
                     jmethod, builder,
                     inst.operand.branch_target,
-                    stack, &true_block,
-                    get_leave_target(block->leave_target_stack)));
+                    stack, &true_block));
 
                 spidir_block_t false_block;
                 CHECK_AND_RETHROW(emit_merge_basic_block(
                     jmethod, builder,
                     pc,
-                    stack, &false_block,
-                    get_leave_target(block->leave_target_stack)));
+                    stack, &false_block));
 
                 // and finally emit the actual brcond
                 spidir_builder_build_brcond(builder, value, true_block, false_block);
@@ -2164,15 +3477,13 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 CHECK_AND_RETHROW(emit_merge_basic_block(
                     jmethod, builder,
                     inst.operand.branch_target,
-                    stack, &true_block,
-                    get_leave_target(block->leave_target_stack)));
+                    stack, &true_block));
 
                 spidir_block_t false_block;
                 CHECK_AND_RETHROW(emit_merge_basic_block(
                     jmethod, builder,
                     pc,
-                    stack, &false_block,
-                    get_leave_target(block->leave_target_stack)));
+                    stack, &false_block));
 
                 spidir_value_t cond = value.value;
 
@@ -2201,13 +3512,19 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 spidir_builder_build_brcond(builder, cond, true_block, false_block);
             } break;
 
+            case CEE_SWITCH: {
+                jit_stack_value_t value = EVAL_STACK_POP();
+                CHECK_AND_RETHROW(emit_switch(
+                    jmethod, builder, stack,
+                    &value, &inst, pc));
+            } break;
+
             case CEE_BR: {
                 spidir_block_t dest;
                 CHECK_AND_RETHROW(emit_merge_basic_block(
                     jmethod, builder,
                     inst.operand.branch_target,
-                    stack, &dest,
-                    get_leave_target(block->leave_target_stack)));
+                    stack, &dest));
 
                 spidir_builder_build_branch(builder, dest);
             } break;
@@ -2277,8 +3594,11 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                     jit_emit_store(builder, value_ptr, value.value, inst.operand.type, value.type);
                 }
 
-                // track it as an object
-                EVAL_STACK_PUSH(tObject, res, .attrs = {.known_type = inst.operand.type});
+                // track it as an object, boxing a reference keeps the object as is
+                // so its exact type might be any type deriving from the operand
+                EVAL_STACK_PUSH(tObject, res, .attrs = {
+                    .known_type = tdn_type_is_valuetype(inst.operand.type) ? inst.operand.type : NULL
+                });
             } break;
 
             case CEE_UNBOX_ANY: {
@@ -2346,10 +3666,9 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 spidir_value_t result = obj.value;
                 if (!def_not_isinst && !def_isinst) {
                     // emit the type check itself
-                    spidir_value_t isinst = jit_emit_type_check(
-                        builder,
-                        obj.value, jit_is_interface(obj.type),
-                        inst.operand.type
+                    spidir_value_t isinst = jit_emit_inst_type_check(
+                        builder, jmethod, &inst,
+                        obj.value, jit_is_interface(obj.type)
                     );
 
                     spidir_block_t perform_isinst = spidir_builder_create_block(builder);
@@ -2447,10 +3766,9 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 spidir_value_t result = SPIDIR_VALUE_INVALID;
                 if (!def_not_isinst && !def_isinst) {
                     // emit the type check itself
-                    spidir_value_t isinst = jit_emit_type_check(
-                        builder,
-                        obj.value, jit_is_interface(obj.type),
-                        inst.operand.type
+                    spidir_value_t isinst = jit_emit_inst_type_check(
+                        builder, jmethod, &inst,
+                        obj.value, jit_is_interface(obj.type)
                     );
 
                     spidir_block_t perform_isinst = spidir_builder_create_block(builder);
@@ -2522,18 +3840,25 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
             case CEE_THROW: {
                 jit_stack_value_t obj = EVAL_STACK_POP();
 
-                // just throw the object
-                spidir_builder_build_call(builder,
-                    m_jit_throw,
-                    2,
-                    (spidir_value_t[]){
-                        obj.value,
-                        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, current_pc)
-                    }
-                );
+                // there is no NullReferenceException to throw
+                // instead, so just fault on a null
+                spidir_builder_build_load(builder, SPIDIR_MEM_SIZE_1, SPIDIR_TYPE_I32, obj.value);
+
+                // go to the handler that takes it
+                CHECK_AND_RETHROW(jit_emit_exception_dispatch(jmethod, builder, current_pc, 0, obj.value));
+
+                // and clear the stack
+                arrsetlen(stack, 0);
+            } break;
 
-                // and we are unreachable after this
-                spidir_builder_build_unreachable(builder);
+            case CEE_RETHROW: {
+                // throw again the exception the catch handler got
+                RuntimeExceptionHandlingClause handler = jit_get_enclosing_handler_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_EXCEPTION);
+                CHECK(handler != NULL);
+                spidir_value_t exception = spidir_builder_build_load(builder,
+                    SPIDIR_MEM_SIZE_8, SPIDIR_TYPE_PTR,
+                    jmethod->exception_slots[jit_get_clause_index(jmethod, handler)]);
+                CHECK_AND_RETHROW(jit_emit_exception_dispatch(jmethod, builder, current_pc, 0, exception));
 
                 // and clear the stack
                 arrsetlen(stack, 0);
@@ -2543,25 +3868,36 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 // empty the stack
                 arrsetlen(stack, 0);
 
-                // check if there is any finally around us
-                spidir_block_t target_block;
-                RuntimeExceptionHandlingClause clause = jit_get_enclosing_try_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_FINALLY, NULL);
-                if (clause != NULL) {
-                    CHECK_AND_RETHROW(emit_merge_basic_block(
-                        jmethod, builder,
-                        clause->HandlerOffset,
-                        stack, &target_block,
-                        inst.operand.branch_target));
-                } else {
-                    CHECK_AND_RETHROW(emit_merge_basic_block(
-                        jmethod, builder,
-                        inst.operand.branch_target,
-                        stack, &target_block,
-                        get_leave_target(block->leave_target_stack)));
+                // tell every finally handler on the way out where to continue,
+                // either to the next handler or to the target of the leave
+                uint32_t target = inst.operand.branch_target;
+                RuntimeExceptionHandlingClause* chain;
+                int chain_count;
+                CHECK_AND_RETHROW(jit_get_leave_finallies(jmethod, current_pc, target, &chain, &chain_count));
+                for (int i = 0; i < chain_count; i++) {
+                    jit_finally_t* finally = jit_get_finally(jmethod, chain[i]);
+                    CHECK(finally != NULL);
+                    if (!jit_finally_has_selector(finally)) {
+                        continue;
+                    }
+
+                    uint32_t next = i + 1 < chain_count ? chain[i + 1]->HandlerOffset : target;
+                    int index = 0;
+                    while (finally->continuations[index] != next) {
+                        index++;
+                        CHECK(index < arrlen(finally->continuations));
+                    }
+                    spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_4,
+                        spidir_builder_build_iconst(builder, SPIDIR_TYPE_I32, index),
+                        finally->selector);
                 }
 
-                // go to the target, will either be the leave destination
-                // or the finally handler before it
+                // go to the first handler, or the target directly if there are none
+                spidir_block_t target_block;
+                CHECK_AND_RETHROW(emit_merge_basic_block(
+                    jmethod, builder,
+                    chain_count > 0 ? chain[0]->HandlerOffset : target,
+                    stack, &target_block));
                 spidir_builder_build_branch(builder, target_block);
             } break;
 
@@ -2569,42 +3905,12 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
                 // empty the stack
                 arrsetlen(stack, 0);
 
-                // TODO: verify the endfinally is actually inside a finally handler
-
-                // check if there is any finally around us
-                RuntimeExceptionHandlingClause clause = jit_get_enclosing_try_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_FINALLY, NULL);
-                spidir_block_t target_block;
-                if (clause != NULL) {
-                    // we do, merge with it, we need to go to the clause
-                    // the leave target will actually stay the same for
-                    // this case
-                    CHECK_AND_RETHROW(emit_merge_basic_block(
-                        jmethod, builder,
-                        clause->HandlerOffset,
-                        stack, &target_block,
-                        get_leave_target(block->leave_target_stack)));
-
-                } else {
-                    // take the previous leave target, or -1 if non
-                    long previous_leave_target = -1;
-                    if (arrlen(block->leave_target_stack) >= 2) {
-                        previous_leave_target = block->leave_target_stack[arrlen(block->leave_target_stack) - 2];
-                    }
-
-                    // we don't have any finally handlers, we can call the
-                    // target directly, we use the same leave target that
-                    // we have right now
-                    CHECK_AND_RETHROW(emit_merge_basic_block(
-                        jmethod, builder,
-                        get_leave_target(block->leave_target_stack),
-                        stack, &target_block,
-                        previous_leave_target));
-                }
-
-                // go to the target, will either be the leave destination
-                // or the finally handler before it
-                spidir_builder_build_branch(builder, target_block);
+                // go to the continuation the selector points to
+                RuntimeExceptionHandlingClause handler = jit_get_enclosing_finally_clause(jmethod, current_pc);
+                CHECK(handler != NULL);
+                CHECK_AND_RETHROW(emit_finally_dispatch(jmethod, builder, stack, handler));
             } break;
+
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
             // Misc
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2632,8 +3938,7 @@ static tdn_err_t jit_emit_basic_block(spidir_builder_handle_t builder, jit_metho
         spidir_block_t new_block;
         CHECK_AND_RETHROW(emit_merge_basic_block(
             jmethod, builder,
-            pc, stack, &new_block,
-            get_leave_target(block->leave_target_stack)));
+            pc, stack, &new_block));
 
         spidir_builder_build_branch(builder, new_block);
     }
@@ -2659,13 +3964,11 @@ static bool jit_prepare_args(spidir_builder_handle_t builder, jit_method_t* meth
 
             // and store the value to it
             spidir_value_t value = spidir_builder_build_param_ref(builder, i);
-            spidir_mem_size_t size;
             if (jit_is_struct_like(arg->type)) {
-                size = SPIDIR_MEM_SIZE_8;
+                spidir_builder_build_store(builder, SPIDIR_MEM_SIZE_8, value, arg->value);
             } else {
-                size = get_spidir_mem_size(arg->type);
+                jit_emit_store(builder, arg->value, value, arg->type, arg->type);
             }
-            spidir_builder_build_store(builder, size, value, arg->value);
 
             modified_block = true;
         } else {
@@ -2687,9 +3990,15 @@ static bool jit_prepare_locals(spidir_builder_handle_t builder, jit_method_t* me
         if (jit_is_struct_like(arg->type)) {
             jit_emit_bzero(builder, arg->value, arg->type);
         } else {
+            // floats are zeroed through their integer bits
+            spidir_value_type_t type = get_spidir_type(arg->type);
+            if (type == SPIDIR_TYPE_F64) {
+                type = arg->type == tSingle ? SPIDIR_TYPE_I32 : SPIDIR_TYPE_I64;
+            }
+
             spidir_builder_build_store(builder,
                 get_spidir_mem_size(arg->type),
-                spidir_builder_build_iconst(builder, get_spidir_type(arg->type), 0),
+                spidir_builder_build_iconst(builder, type, 0),
                 arg->value
             );
         }
@@ -2698,6 +4007,31 @@ static bool jit_prepare_locals(spidir_builder_handle_t builder, jit_method_t* me
     return modified_block;
 }
 
+static tdn_err_t jit_prepare_exception_handlers(spidir_builder_handle_t builder, jit_method_t* method) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    RuntimeExceptionHandlingClause_Array clauses = method->method->MethodBody->ExceptionHandlingClauses;
+    if (clauses == NULL) {
+        goto cleanup;
+    }
+
+    method->exception_slots = jit_alloc(sizeof(spidir_value_t) * clauses->Length);
+    CHECK_ERROR(method->exception_slots != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+    for (int i = 0; i < clauses->Length; i++) {
+        method->exception_slots[i] = spidir_builder_build_stackslot(builder, sizeof(Object), _Alignof(Object));
+
+        // a single continuation needs no selector
+        jit_finally_t* finally = &method->finallies[i];
+        if (jit_finally_has_selector(finally)) {
+            finally->selector = spidir_builder_build_stackslot(builder, sizeof(uint32_t), _Alignof(uint32_t));
+        }
+    }
+
+cleanup:
+    return err;
+}
+
 static void jit_emit_spidir_from_il(spidir_builder_handle_t builder, void* _ctx) {
     tdn_err_t err = TDN_NO_ERROR;
     jit_emit_ctx_t* ctx = _ctx;
@@ -2722,6 +4056,28 @@ static void jit_emit_spidir_from_il(spidir_builder_handle_t builder, void* _ctx)
         modified_block = true;
     }
 
+    // and the state of the exception handlers
+    CHECK_AND_RETHROW(jit_prepare_exception_handlers(builder, jmethod));
+
+    // shared code needs the dictionary of the exact type
+    if (jmethod->dictionary != NULL) {
+        jit_emit_load_dictionary(builder, jmethod);
+        modified_block = true;
+    }
+
+    // methods of types with a lazy cctor that trigger
+    // it make sure it ran on entry
+    RuntimeMethodBase method = jmethod->method;
+    if (jit_method_checks_init_on_entry(method)) {
+        int slot = jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_SELF_TYPE_INIT, 0);
+        if (slot >= 0) {
+            jit_emit_init_state_check(builder, jit_emit_dictionary_entry(builder, jmethod, slot, SPIDIR_TYPE_PTR));
+        } else {
+            CHECK_AND_RETHROW(jit_emit_type_init_check(builder, method->DeclaringType));
+        }
+        modified_block = true;
+    }
+
     // did we modify the block? if so we need to allocate a new block
     // to be used for the main block
     if (modified_block) {
@@ -2991,14 +4347,9 @@ static tdn_err_t jit_map_and_relocate(size_t map_size) {
 
         // check the static constructor
         RuntimeTypeInfo type = method->method->DeclaringType;
-        if (type->TypeInitializer == (RuntimeConstructorInfo)method->method) {
-            if (type->Attributes.BeforeFieldInit) {
-                jit_queue_cctor(method->method->MethodPtr);
-            } else {
-                // TODO: need to generate a hook or something
-                //       to call the initializer
-                CHECK_FAIL();
-            }
+        // the rest are called lazily on first use of the type
+        if (type->TypeInitializer == (RuntimeConstructorInfo)method->method && !jit_type_needs_lazy_init(type)) {
+            jit_queue_cctor(method->method->MethodPtr);
         }
     }
 
@@ -3118,6 +4469,9 @@ tdn_err_t jit_emit(void) {
         CHECK_AND_RETHROW(jit_map_and_relocate(map_size));
     }
 
+    // methods that share code can now get their pointers
+    jit_resolve_shared_methods();
+
     // now fill up all the vtables
     for (int i = 0; i < arrlen(m_types_to_emit); i++) {
         RuntimeTypeInfo type = m_types_to_emit[i];
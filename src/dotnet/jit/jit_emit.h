@@ -2,6 +2,7 @@
 
 #include <tomatodotnet/except.h>
 
+#include "jit_helpers.h"
 #include "jit_internal.h"
 
 /**
@@ -36,3 +37,13 @@ tdn_err_t jit_emit(void);
 
 spidir_value_type_t jit_get_spidir_ret_type(RuntimeMethodBase method);
 spidir_value_type_t* jit_get_spidir_arg_types(RuntimeMethodBase method);
+
+/**
+ * Allocate the static block of the type of the field, if not allocated yet
+ */
+tdn_err_t jit_init_static_field(RuntimeFieldInfo field);
+
+/**
+ * Get the lazy init state of a type, checked by the code before touching the type
+ */
+tdn_err_t jit_get_type_init_state(RuntimeTypeInfo type, jit_type_init_state_t** out_state);
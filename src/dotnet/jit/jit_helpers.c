@@ -1,11 +1,18 @@
 #include "jit_helpers.h"
 
+#include <stdatomic.h>
+#include <cpuid.h>
+#include <immintrin.h>
+
+#include <tomatodotnet/tdn.h>
 #include <dotnet/loader.h>
 #include <dotnet/gc/gc.h>
 #include <util/except.h>
 #include <util/stb_ds.h>
 #include <util/string.h>
 
+#include "jit.h"
+
 void jit_bzero(void* ptr, size_t size) {
     memset(ptr, 0, size);
 }
@@ -66,9 +73,43 @@ void* jit_interface_downcast(Object instance, RuntimeTypeInfo iface) {
     ASSERT(!"Failed to downcast an interface");
 }
 
-void jit_throw(Object exception, uint32_t pc) {
-    ERROR("Exception of type %T thrown (IL PC %d)", object_get_vtable(exception)->Type, pc);
-    ASSERT(!"jit_throw");
+_Atomic(uint32_t) g_jit_pending_exceptions = 0;
+
+/**
+ * The exception that is leaving the managed frames of this thread,
+ * it stays here only until the caller of the frame takes it
+ */
+static _Thread_local Object m_pending_exception = NULL;
+static _Thread_local bool m_pending_exception_rooted = false;
+
+void jit_set_pending_exception(Object exception) {
+    ASSERT(m_pending_exception == NULL);
+
+    // the exception might be the only reference left to the object
+    if (!m_pending_exception_rooted) {
+        gc_register_root(&m_pending_exception);
+        m_pending_exception_rooted = true;
+    }
+
+    m_pending_exception = exception;
+    atomic_fetch_add_explicit(&g_jit_pending_exceptions, 1, memory_order_relaxed);
+}
+
+Object jit_take_pending_exception(void) {
+    Object exception = m_pending_exception;
+    if (exception != NULL) {
+        m_pending_exception = NULL;
+        atomic_fetch_sub_explicit(&g_jit_pending_exceptions, 1, memory_order_relaxed);
+    }
+    return exception;
+}
+
+void jit_check_unhandled_exception(void) {
+    Object exception = jit_take_pending_exception();
+    if (exception != NULL) {
+        ERROR("Unhandled exception of type %T", object_get_vtable(exception)->Type);
+        __builtin_trap();
+    }
 }
 
 void jit_gc_memcpy() { ASSERT(!"jit_gc_memcpy"); }
@@ -81,11 +122,120 @@ void jit_throw_index_out_of_range_exception() { ASSERT(!"jit_throw_index_out_of_
 
 void jit_throw_overflow_exception() { ASSERT(!"jit_throw_overflow_exception"); }
 
+void jit_throw_argument_exception() { ASSERT(!"jit_throw_argument_exception"); }
+
 void jit_throw_null_reference_exception() { ASSERT(!"jit_throw_null_reference_exception"); }
 
-void jit_rethrow() { ASSERT(!"jit_rethrow"); }
 
-void jit_get_exception() { ASSERT(!"jit_get_exception"); }
+/**
+ * The type initialization state of a single thread
+ */
+typedef struct jit_type_init_thread {
+    // the type whose cctor this thread is waiting on
+    _Atomic(jit_type_init_state_t*) waiting_for;
+} jit_type_init_thread_t;
+
+static _Thread_local jit_type_init_thread_t m_type_init_thread;
+
+/**
+ * Follow the chain of threads that wait on each other starting from the owner of
+ * the type, if it leads back to us then waiting would deadlock. A thread can't
+ * exit while it is running a cctor, so the chain only goes through live threads
+ */
+static bool jit_type_init_would_deadlock(jit_type_init_thread_t* self, jit_type_init_thread_t* owner) {
+    while (owner != NULL) {
+        if (owner == self) {
+            return true;
+        }
+
+        jit_type_init_state_t* waiting_for = atomic_load_explicit(&owner->waiting_for, memory_order_acquire);
+        if (waiting_for == NULL) {
+            break;
+        }
+
+        owner = atomic_load_explicit(&waiting_for->owner, memory_order_acquire);
+    }
+
+    return false;
+}
+
+void jit_run_type_initializer(jit_type_init_state_t* state) {
+    jit_type_init_thread_t* self = &m_type_init_thread;
+
+    while (!atomic_load_explicit(&state->initialized, memory_order_acquire)) {
+        jit_type_init_thread_t* owner = NULL;
+        if (atomic_compare_exchange_strong(&state->owner, &owner, self)) {
+            // we won, run the cctor and let everyone else know
+            jit_cctor_t cctor = ((RuntimeMethodBase)state->type->TypeInitializer)->MethodPtr;
+            cctor();
+            jit_check_unhandled_exception();
+            atomic_store_explicit(&state->initialized, 1, memory_order_release);
+            break;
+        }
+
+        // the cctor touched its own type, directly or through other cctors
+        // on this thread or on threads that wait for us, like the spec says
+        // it sees the type as it is right now instead of deadlocking
+        atomic_store_explicit(&self->waiting_for, state, memory_order_release);
+        if (jit_type_init_would_deadlock(self, owner)) {
+            atomic_store_explicit(&self->waiting_for, NULL, memory_order_release);
+            break;
+        }
+
+        // another thread is running it, wait for it
+        CPU_RELAX();
+    }
+
+    atomic_store_explicit(&self->waiting_for, NULL, memory_order_release);
+}
+
+RuntimeMethodBody jit_get_method_body(RuntimeMethodBase method) {
+    // there is no way to report the error to the caller, a
+    // body that can't be parsed is seen as no body at all
+    tdn_err_t err = tdn_method_load_body(method);
+    if (IS_ERROR(err)) {
+        WARN("Failed to parse the body of %T::%U", method->DeclaringType, method->Name);
+    }
+    return method->MethodBody;
+}
+
+String jit_get_parameter_name(ParameterInfo parameter) {
+    // same as with the body, a name that can't be
+    // found is seen as no name at all
+    String name = NULL;
+    tdn_err_t err = tdn_get_parameter_name(parameter, &name);
+    if (IS_ERROR(err)) {
+        WARN("Failed to get the name of parameter %d of %U", parameter->Position, parameter->Member->Name);
+    }
+    return name;
+}
+
+jit_cpu_features_t g_jit_cpu_features = {};
+
+void jit_detect_cpu_features(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    bool os_saves_ymm = false;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        g_jit_cpu_features.popcnt = (ecx & bit_POPCNT) != 0;
+
+        // avx is only usable if the os saves the ymm state
+        if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+            uint32_t xcr0_low, xcr0_high;
+            asm volatile ("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+            os_saves_ymm = (xcr0_low & 0b110) == 0b110;
+        }
+    }
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        g_jit_cpu_features.bmi1 = (ebx & bit_BMI) != 0;
+        g_jit_cpu_features.avx2 = os_saves_ymm && (ebx & bit_AVX2) != 0;
+    }
+
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx)) {
+        g_jit_cpu_features.lzcnt = (ecx & bit_LZCNT) != 0;
+    }
+}
 
 int jit_leading_zero_count_32(uint32_t value) {
     if (value == 0) return 32;
@@ -97,6 +247,459 @@ int jit_leading_zero_count_64(uint64_t value) {
     return __builtin_clzll(value);
 }
 
+int jit_lzcnt_32(uint32_t value) {
+    uint32_t result;
+    asm ("lzcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+int jit_lzcnt_64(uint64_t value) {
+    uint64_t result;
+    asm ("lzcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+int jit_trailing_zero_count_32(uint32_t value) {
+    if (value == 0) return 32;
+    return __builtin_ctz(value);
+}
+
+int jit_trailing_zero_count_64(uint64_t value) {
+    if (value == 0) return 64;
+    return __builtin_ctzll(value);
+}
+
+int jit_tzcnt_32(uint32_t value) {
+    uint32_t result;
+    asm ("tzcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+int jit_tzcnt_64(uint64_t value) {
+    uint64_t result;
+    asm ("tzcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+int jit_pop_count_32(uint32_t value) {
+    // the usual swar reduction, the builtin might turn into a libgcc call
+    value = value - ((value >> 1) & 0x55555555);
+    value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+    value = (value + (value >> 4)) & 0x0F0F0F0F;
+    return (value * 0x01010101) >> 24;
+}
+
+int jit_pop_count_64(uint64_t value) {
+    value = value - ((value >> 1) & 0x5555555555555555);
+    value = (value & 0x3333333333333333) + ((value >> 2) & 0x3333333333333333);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0F;
+    return (value * 0x0101010101010101) >> 56;
+}
+
+int jit_popcnt_32(uint32_t value) {
+    uint32_t result;
+    asm ("popcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+int jit_popcnt_64(uint64_t value) {
+    uint64_t result;
+    asm ("popcnt %1, %0" : "=r"(result) : "rm"(value) : "cc");
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Span helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32_t jit_index_of_any_byte(uint8_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length) {
+    for (int32_t i = 0; i < length; i++) {
+        uint8_t c = ptr[i];
+        if (c == (uint8_t)value0 || c == (uint8_t)value1 || c == (uint8_t)value2) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int32_t jit_index_of_any_char(uint16_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length) {
+    for (int32_t i = 0; i < length; i++) {
+        uint16_t c = ptr[i];
+        if (c == (uint16_t)value0 || c == (uint16_t)value1 || c == (uint16_t)value2) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int32_t jit_last_index_of_byte(uint8_t* ptr, uint32_t value, int32_t length) {
+    for (int32_t i = length - 1; i >= 0; i--) {
+        if (ptr[i] == (uint8_t)value) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int32_t jit_last_index_of_char(uint16_t* ptr, uint32_t value, int32_t length) {
+    for (int32_t i = length - 1; i >= 0; i--) {
+        if (ptr[i] == (uint16_t)value) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int32_t jit_sequence_equal(uint8_t* first, uint8_t* second, size_t length) {
+    return memcmp(first, second, length) == 0;
+}
+
+__attribute__((target("avx2")))
+int32_t jit_index_of_any_byte_avx2(uint8_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length) {
+    __m256i needle0 = _mm256_set1_epi8((char)value0);
+    __m256i needle1 = _mm256_set1_epi8((char)value1);
+    __m256i needle2 = _mm256_set1_epi8((char)value2);
+
+    int32_t i = 0;
+    for (; length - i >= 32; i += 32) {
+        __m256i data = _mm256_loadu_si256((__m256i*)(ptr + i));
+        __m256i match = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(data, needle0), _mm256_cmpeq_epi8(data, needle1)),
+            _mm256_cmpeq_epi8(data, needle2));
+        uint32_t mask = _mm256_movemask_epi8(match);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    int32_t index = jit_index_of_any_byte(ptr + i, value0, value1, value2, length - i);
+    return index < 0 ? -1 : i + index;
+}
+
+__attribute__((target("avx2")))
+int32_t jit_index_of_any_char_avx2(uint16_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length) {
+    __m256i needle0 = _mm256_set1_epi16((short)value0);
+    __m256i needle1 = _mm256_set1_epi16((short)value1);
+    __m256i needle2 = _mm256_set1_epi16((short)value2);
+
+    int32_t i = 0;
+    for (; length - i >= 16; i += 16) {
+        __m256i data = _mm256_loadu_si256((__m256i*)(ptr + i));
+        __m256i match = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi16(data, needle0), _mm256_cmpeq_epi16(data, needle1)),
+            _mm256_cmpeq_epi16(data, needle2));
+
+        // every char sets two bits of the byte mask
+        uint32_t mask = _mm256_movemask_epi8(match);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+
+    int32_t index = jit_index_of_any_char(ptr + i, value0, value1, value2, length - i);
+    return index < 0 ? -1 : i + index;
+}
+
+__attribute__((target("avx2")))
+int32_t jit_last_index_of_byte_avx2(uint8_t* ptr, uint32_t value, int32_t length) {
+    __m256i needle = _mm256_set1_epi8((char)value);
+
+    int32_t i = length;
+    for (; i >= 32; i -= 32) {
+        __m256i data = _mm256_loadu_si256((__m256i*)(ptr + i - 32));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(data, needle));
+        if (mask != 0) {
+            return i - 32 + (31 - __builtin_clz(mask));
+        }
+    }
+
+    return jit_last_index_of_byte(ptr, value, i);
+}
+
+__attribute__((target("avx2")))
+int32_t jit_last_index_of_char_avx2(uint16_t* ptr, uint32_t value, int32_t length) {
+    __m256i needle = _mm256_set1_epi16((short)value);
+
+    int32_t i = length;
+    for (; i >= 16; i -= 16) {
+        __m256i data = _mm256_loadu_si256((__m256i*)(ptr + i - 16));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(data, needle));
+        if (mask != 0) {
+            return i - 16 + (31 - __builtin_clz(mask)) / 2;
+        }
+    }
+
+    return jit_last_index_of_char(ptr, value, i);
+}
+
+__attribute__((target("avx2")))
+int32_t jit_sequence_equal_avx2(uint8_t* first, uint8_t* second, size_t length) {
+    size_t i = 0;
+    for (; length - i >= 32; i += 32) {
+        __m256i a = _mm256_loadu_si256((__m256i*)(first + i));
+        __m256i b = _mm256_loadu_si256((__m256i*)(second + i));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != UINT32_MAX) {
+            return false;
+        }
+    }
+
+    return memcmp(first + i, second + i, length - i) == 0;
+}
+
+void jit_fill_1(uint8_t* ptr, size_t count, uint32_t value) {
+    memset(ptr, (uint8_t)value, count);
+}
+
+void jit_fill_2(uint16_t* ptr, size_t count, uint32_t value) {
+    for (size_t i = 0; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+void jit_fill_4(uint32_t* ptr, size_t count, uint32_t value) {
+    for (size_t i = 0; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+void jit_fill_8(uint64_t* ptr, size_t count, uint64_t value) {
+    for (size_t i = 0; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+__attribute__((target("avx2")))
+void jit_fill_2_avx2(uint16_t* ptr, size_t count, uint32_t value) {
+    __m256i v = _mm256_set1_epi16((int16_t)value);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_si256((__m256i*)(ptr + i), v);
+    }
+    for (; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+__attribute__((target("avx2")))
+void jit_fill_4_avx2(uint32_t* ptr, size_t count, uint32_t value) {
+    __m256i v = _mm256_set1_epi32((int32_t)value);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(ptr + i), v);
+    }
+    for (; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+__attribute__((target("avx2")))
+void jit_fill_8_avx2(uint64_t* ptr, size_t count, uint64_t value) {
+    __m256i v = _mm256_set1_epi64x((int64_t)value);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_si256((__m256i*)(ptr + i), v);
+    }
+    for (; i < count; i++) {
+        ptr[i] = value;
+    }
+}
+
+void jit_memmove(void* dst, void* src, size_t size) {
+    memmove(dst, src, size);
+}
+
+/**
+ * Up to this size copying words inline beats the setup of the host memmove
+ */
+#define JIT_MEMMOVE_INLINE_MAX 64
+
+void jit_memmove_aligned_8(uint64_t* dst, uint64_t* src, size_t size) {
+    if (size > JIT_MEMMOVE_INLINE_MAX) {
+        memmove(dst, src, size);
+        return;
+    }
+
+    size_t count = size / 8;
+    if (dst <= src || dst >= src + count) {
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = src[i];
+        }
+    } else {
+        // overlapping with the destination after the source, go backwards
+        for (size_t i = count; i > 0; i--) {
+            dst[i - 1] = src[i - 1];
+        }
+    }
+}
+
+uint64_t jit_mul_high_u64(uint64_t a, uint64_t b) {
+    return ((unsigned __int128)a * b) >> 64;
+}
+
+int64_t jit_mul_high_s64(int64_t a, int64_t b) {
+    return ((__int128)a * b) >> 64;
+}
+
+void jit_vector128_add(void* result, void* left, void* right, uint32_t lane) {
+    __m128i a = _mm_loadu_si128(left);
+    __m128i b = _mm_loadu_si128(right);
+    __m128i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm_add_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm_add_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm_add_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: r = _mm_add_epi64(a, b); break;
+        case JIT_VECTOR_LANE_F32: r = _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); break;
+        default: r = _mm_castpd_si128(_mm_add_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); break;
+    }
+    _mm_storeu_si128(result, r);
+}
+
+void jit_vector128_subtract(void* result, void* left, void* right, uint32_t lane) {
+    __m128i a = _mm_loadu_si128(left);
+    __m128i b = _mm_loadu_si128(right);
+    __m128i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm_sub_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm_sub_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm_sub_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: r = _mm_sub_epi64(a, b); break;
+        case JIT_VECTOR_LANE_F32: r = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); break;
+        default: r = _mm_castpd_si128(_mm_sub_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); break;
+    }
+    _mm_storeu_si128(result, r);
+}
+
+void jit_vector128_equals(void* result, void* left, void* right, uint32_t lane) {
+    __m128i a = _mm_loadu_si128(left);
+    __m128i b = _mm_loadu_si128(right);
+    __m128i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm_cmpeq_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm_cmpeq_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm_cmpeq_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: {
+            // sse2 has no 64bit compare, both halves must be equal
+            __m128i halves = _mm_cmpeq_epi32(a, b);
+            r = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+        } break;
+        case JIT_VECTOR_LANE_F32: r = _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); break;
+        default: r = _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); break;
+    }
+    _mm_storeu_si128(result, r);
+}
+
+uint32_t jit_vector128_extract_most_significant_bits(void* value, uint32_t lane) {
+    __m128i v = _mm_loadu_si128(value);
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: return _mm_movemask_epi8(v);
+        // the signed saturation keeps the sign of every lane
+        case JIT_VECTOR_LANE_I16: return _mm_movemask_epi8(_mm_packs_epi16(v, _mm_setzero_si128()));
+        case JIT_VECTOR_LANE_I32:
+        case JIT_VECTOR_LANE_F32: return _mm_movemask_ps(_mm_castsi128_ps(v));
+        default: return _mm_movemask_pd(_mm_castsi128_pd(v));
+    }
+}
+
+/**
+ * Without avx2 the 256bit operations are done on the two halves
+ */
+#define JIT_VECTOR256_HIGH(ptr) ((uint8_t*)(ptr) + 16)
+
+void jit_vector256_add(void* result, void* left, void* right, uint32_t lane) {
+    jit_vector128_add(result, left, right, lane);
+    jit_vector128_add(JIT_VECTOR256_HIGH(result), JIT_VECTOR256_HIGH(left), JIT_VECTOR256_HIGH(right), lane);
+}
+
+void jit_vector256_subtract(void* result, void* left, void* right, uint32_t lane) {
+    jit_vector128_subtract(result, left, right, lane);
+    jit_vector128_subtract(JIT_VECTOR256_HIGH(result), JIT_VECTOR256_HIGH(left), JIT_VECTOR256_HIGH(right), lane);
+}
+
+void jit_vector256_equals(void* result, void* left, void* right, uint32_t lane) {
+    jit_vector128_equals(result, left, right, lane);
+    jit_vector128_equals(JIT_VECTOR256_HIGH(result), JIT_VECTOR256_HIGH(left), JIT_VECTOR256_HIGH(right), lane);
+}
+
+uint32_t jit_vector256_extract_most_significant_bits(void* value, uint32_t lane) {
+    static const uint8_t lanes_per_half[] = {
+        [JIT_VECTOR_LANE_I8] = 16,
+        [JIT_VECTOR_LANE_I16] = 8,
+        [JIT_VECTOR_LANE_I32] = 4,
+        [JIT_VECTOR_LANE_I64] = 2,
+        [JIT_VECTOR_LANE_F32] = 4,
+        [JIT_VECTOR_LANE_F64] = 2,
+    };
+    uint32_t low = jit_vector128_extract_most_significant_bits(value, lane);
+    uint32_t high = jit_vector128_extract_most_significant_bits(JIT_VECTOR256_HIGH(value), lane);
+    return low | (high << lanes_per_half[lane]);
+}
+
+__attribute__((target("avx2")))
+void jit_vector256_add_avx2(void* result, void* left, void* right, uint32_t lane) {
+    __m256i a = _mm256_loadu_si256(left);
+    __m256i b = _mm256_loadu_si256(right);
+    __m256i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm256_add_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm256_add_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm256_add_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: r = _mm256_add_epi64(a, b); break;
+        case JIT_VECTOR_LANE_F32: r = _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); break;
+        default: r = _mm256_castpd_si256(_mm256_add_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b))); break;
+    }
+    _mm256_storeu_si256(result, r);
+}
+
+__attribute__((target("avx2")))
+void jit_vector256_subtract_avx2(void* result, void* left, void* right, uint32_t lane) {
+    __m256i a = _mm256_loadu_si256(left);
+    __m256i b = _mm256_loadu_si256(right);
+    __m256i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm256_sub_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm256_sub_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm256_sub_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: r = _mm256_sub_epi64(a, b); break;
+        case JIT_VECTOR_LANE_F32: r = _mm256_castps_si256(_mm256_sub_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); break;
+        default: r = _mm256_castpd_si256(_mm256_sub_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b))); break;
+    }
+    _mm256_storeu_si256(result, r);
+}
+
+__attribute__((target("avx2")))
+void jit_vector256_equals_avx2(void* result, void* left, void* right, uint32_t lane) {
+    __m256i a = _mm256_loadu_si256(left);
+    __m256i b = _mm256_loadu_si256(right);
+    __m256i r;
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: r = _mm256_cmpeq_epi8(a, b); break;
+        case JIT_VECTOR_LANE_I16: r = _mm256_cmpeq_epi16(a, b); break;
+        case JIT_VECTOR_LANE_I32: r = _mm256_cmpeq_epi32(a, b); break;
+        case JIT_VECTOR_LANE_I64: r = _mm256_cmpeq_epi64(a, b); break;
+        case JIT_VECTOR_LANE_F32: r = _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ)); break;
+        default: r = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ)); break;
+    }
+    _mm256_storeu_si256(result, r);
+}
+
+__attribute__((target("avx2")))
+uint32_t jit_vector256_extract_most_significant_bits_avx2(void* value, uint32_t lane) {
+    __m256i v = _mm256_loadu_si256(value);
+    switch (lane) {
+        case JIT_VECTOR_LANE_I8: return _mm256_movemask_epi8(v);
+        case JIT_VECTOR_LANE_I16: {
+            // the pack works within each half, gather the packed
+            // quadwords of both halves into the low half
+            __m256i packed = _mm256_packs_epi16(v, _mm256_setzero_si256());
+            return _mm256_movemask_epi8(_mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+        case JIT_VECTOR_LANE_I32:
+        case JIT_VECTOR_LANE_F32: return _mm256_movemask_ps(_mm256_castsi256_ps(v));
+        default: return _mm256_movemask_pd(_mm256_castsi256_pd(v));
+    }
+}
+
 void jit_print_str(String str) {
     TRACE("%U", str);
 }
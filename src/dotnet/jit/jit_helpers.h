@@ -18,17 +18,157 @@ void jit_gc_bzero();
 
 void* jit_interface_downcast(Object instance, RuntimeTypeInfo interface_type);
 
-void jit_throw(Object exception, uint32_t pc);
+/**
+ * The amount of threads that have an exception in flight, the jitted code
+ * checks it after every call and only then takes the exception of its thread
+ */
+extern _Atomic(uint32_t) g_jit_pending_exceptions;
+
+/**
+ * An exception that no handler of a method catches is left pending on the
+ * thread when the method returns, its caller then takes it and either
+ * handles it or leaves it pending for its own caller
+ */
+void jit_set_pending_exception(Object exception);
+Object jit_take_pending_exception(void);
+
+/**
+ * The runtime calls type initializers directly, so there is no managed
+ * frame to leave an exception they throw to, it is fatal instead
+ */
+void jit_check_unhandled_exception(void);
 
 void jit_throw_invalid_cast_exception();
 void jit_throw_index_out_of_range_exception();
 void jit_throw_overflow_exception();
+void jit_throw_argument_exception();
 void jit_throw_null_reference_exception();
-void jit_rethrow();
-void jit_get_exception();
 
+/**
+ * The lazy initialization state of a type whose cctor must run
+ * right before its first use (types that are not beforefieldinit)
+ */
+typedef struct jit_type_init_state {
+    // set once the cctor is done, checked inline by the jitted code
+    _Atomic(uint8_t) initialized;
+
+    // the thread that is running the cctor
+    _Atomic(struct jit_type_init_thread*) owner;
+
+    RuntimeTypeInfo type;
+} jit_type_init_state_t;
+
+void jit_run_type_initializer(jit_type_init_state_t* state);
+
+/**
+ * Method bodies are parsed on first use, reflection reads
+ * the body of a method through this
+ */
+RuntimeMethodBody jit_get_method_body(RuntimeMethodBase method);
+
+/**
+ * Parameter names are created on first use, reflection
+ * reads the name of a parameter through this
+ */
+String jit_get_parameter_name(ParameterInfo parameter);
+
+/**
+ * The cpu features the bit helpers can take advantage of
+ */
+typedef struct jit_cpu_features {
+    bool lzcnt;
+    bool bmi1;
+    bool popcnt;
+    bool avx2;
+} jit_cpu_features_t;
+
+extern jit_cpu_features_t g_jit_cpu_features;
+
+void jit_detect_cpu_features(void);
+
+/**
+ * The bit helpers, the software versions are used when
+ * the cpu lacks the instruction
+ */
 int jit_leading_zero_count_32(uint32_t value);
 int jit_leading_zero_count_64(uint64_t value);
+int jit_lzcnt_32(uint32_t value);
+int jit_lzcnt_64(uint64_t value);
+
+int jit_trailing_zero_count_32(uint32_t value);
+int jit_trailing_zero_count_64(uint64_t value);
+int jit_tzcnt_32(uint32_t value);
+int jit_tzcnt_64(uint64_t value);
+
+int jit_pop_count_32(uint32_t value);
+int jit_pop_count_64(uint64_t value);
+int jit_popcnt_32(uint32_t value);
+int jit_popcnt_64(uint64_t value);
+
+/**
+ * The span helpers, the avx2 versions are used when the cpu has it
+ */
+int32_t jit_index_of_any_byte(uint8_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length);
+int32_t jit_index_of_any_char(uint16_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length);
+int32_t jit_last_index_of_byte(uint8_t* ptr, uint32_t value, int32_t length);
+int32_t jit_last_index_of_char(uint16_t* ptr, uint32_t value, int32_t length);
+int32_t jit_sequence_equal(uint8_t* first, uint8_t* second, size_t length);
+
+int32_t jit_index_of_any_byte_avx2(uint8_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length);
+int32_t jit_index_of_any_char_avx2(uint16_t* ptr, uint32_t value0, uint32_t value1, uint32_t value2, int32_t length);
+int32_t jit_last_index_of_byte_avx2(uint8_t* ptr, uint32_t value, int32_t length);
+int32_t jit_last_index_of_char_avx2(uint16_t* ptr, uint32_t value, int32_t length);
+int32_t jit_sequence_equal_avx2(uint8_t* first, uint8_t* second, size_t length);
+
+void jit_fill_1(uint8_t* ptr, size_t count, uint32_t value);
+void jit_fill_2(uint16_t* ptr, size_t count, uint32_t value);
+void jit_fill_4(uint32_t* ptr, size_t count, uint32_t value);
+void jit_fill_8(uint64_t* ptr, size_t count, uint64_t value);
+
+void jit_fill_2_avx2(uint16_t* ptr, size_t count, uint32_t value);
+void jit_fill_4_avx2(uint32_t* ptr, size_t count, uint32_t value);
+void jit_fill_8_avx2(uint64_t* ptr, size_t count, uint64_t value);
+
+void jit_memmove(void* dst, void* src, size_t size);
+void jit_memmove_aligned_8(uint64_t* dst, uint64_t* src, size_t size);
+
+/**
+ * The high half of a 64x64->128 multiply, a single mul/imul
+ */
+uint64_t jit_mul_high_u64(uint64_t a, uint64_t b);
+int64_t jit_mul_high_s64(int64_t a, int64_t b);
+
+/**
+ * The lanes of a hardware vector, the lane-wise helpers take it
+ * as their last argument
+ */
+typedef enum jit_vector_lane {
+    JIT_VECTOR_LANE_I8,
+    JIT_VECTOR_LANE_I16,
+    JIT_VECTOR_LANE_I32,
+    JIT_VECTOR_LANE_I64,
+    JIT_VECTOR_LANE_F32,
+    JIT_VECTOR_LANE_F64,
+} jit_vector_lane_t;
+
+/**
+ * The lane-wise vector helpers, vectors are passed by pointer like any
+ * other struct, the avx2 versions are used when the cpu has it
+ */
+void jit_vector128_add(void* result, void* left, void* right, uint32_t lane);
+void jit_vector128_subtract(void* result, void* left, void* right, uint32_t lane);
+void jit_vector128_equals(void* result, void* left, void* right, uint32_t lane);
+uint32_t jit_vector128_extract_most_significant_bits(void* value, uint32_t lane);
+
+void jit_vector256_add(void* result, void* left, void* right, uint32_t lane);
+void jit_vector256_subtract(void* result, void* left, void* right, uint32_t lane);
+void jit_vector256_equals(void* result, void* left, void* right, uint32_t lane);
+uint32_t jit_vector256_extract_most_significant_bits(void* value, uint32_t lane);
+
+void jit_vector256_add_avx2(void* result, void* left, void* right, uint32_t lane);
+void jit_vector256_subtract_avx2(void* result, void* left, void* right, uint32_t lane);
+void jit_vector256_equals_avx2(void* result, void* left, void* right, uint32_t lane);
+uint32_t jit_vector256_extract_most_significant_bits_avx2(void* value, uint32_t lane);
 
 void jit_print_str(String str);
 void jit_print_int(int value);
@@ -43,6 +183,37 @@ extern spidir_function_t g_jit_print_ptr;
 */
 extern spidir_function_t g_jit_bzero;
 extern spidir_function_t g_jit_memcpy;
+extern spidir_function_t g_jit_memmove;
+extern spidir_function_t g_jit_memmove_aligned_8;
 
 extern spidir_function_t g_jit_leading_zero_count_32;
 extern spidir_function_t g_jit_leading_zero_count_64;
+extern spidir_function_t g_jit_trailing_zero_count_32;
+extern spidir_function_t g_jit_trailing_zero_count_64;
+extern spidir_function_t g_jit_pop_count_32;
+extern spidir_function_t g_jit_pop_count_64;
+
+extern spidir_function_t g_jit_index_of_any_byte;
+extern spidir_function_t g_jit_index_of_any_char;
+extern spidir_function_t g_jit_last_index_of_byte;
+extern spidir_function_t g_jit_last_index_of_char;
+extern spidir_function_t g_jit_sequence_equal;
+extern spidir_function_t g_jit_fill_1;
+extern spidir_function_t g_jit_fill_2;
+extern spidir_function_t g_jit_fill_4;
+extern spidir_function_t g_jit_fill_8;
+
+extern spidir_function_t g_jit_mul_high_u64;
+extern spidir_function_t g_jit_mul_high_s64;
+
+extern spidir_function_t g_jit_vector128_add;
+extern spidir_function_t g_jit_vector128_subtract;
+extern spidir_function_t g_jit_vector128_equals;
+extern spidir_function_t g_jit_vector128_extract_most_significant_bits;
+extern spidir_function_t g_jit_vector256_add;
+extern spidir_function_t g_jit_vector256_subtract;
+extern spidir_function_t g_jit_vector256_equals;
+extern spidir_function_t g_jit_vector256_extract_most_significant_bits;
+
+extern spidir_function_t g_jit_throw_overflow_exception;
+extern spidir_function_t g_jit_throw_argument_exception;
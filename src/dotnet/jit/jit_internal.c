@@ -1,11 +1,19 @@
 #include "jit_internal.h"
 
-#include <util/alloc.h>
+#include <util/arena.h>
 #include <util/except.h>
 #include <util/stb_ds.h>
+#include <dotnet/loader.h>
 
 #include "jit_basic_block.h"
 #include "jit_emit.h"
+#include "jit_shared.h"
+
+/**
+ * The memory of the current jit session, holds the jit methods
+ * and the basic blocks with their states
+ */
+static arena_t m_jit_arena = {};
 
 static struct {
     RuntimeMethodBase key;
@@ -17,6 +25,16 @@ static struct {
     jit_method_t* value;
 }* m_jit_functions;
 
+/**
+ * Methods that use the code of another method, their
+ * pointers are set once the shared code is mapped
+ */
+static RuntimeMethodBase* m_shared_methods = NULL;
+
+void* jit_alloc(size_t size) {
+    return arena_alloc(&m_jit_arena, size);
+}
+
 tdn_err_t jit_get_or_create_method(RuntimeMethodBase method, jit_method_t** result) {
     tdn_err_t err = TDN_NO_ERROR;
 
@@ -26,7 +44,20 @@ tdn_err_t jit_get_or_create_method(RuntimeMethodBase method, jit_method_t** resu
         goto cleanup;
     }
 
-    jit_method_t* jmethod = tdn_mallocz(sizeof(*method));
+    // if the code is shared with another method then just use its jit method
+    RuntimeMethodBase shared = NULL;
+    CHECK_AND_RETHROW(jit_get_shared_method(method, &shared));
+    if (shared != method) {
+        CHECK_AND_RETHROW(jit_get_or_create_method(shared, result));
+        hmput(m_jit_methods, method, *result);
+        arrpush(m_shared_methods, method);
+        goto cleanup;
+    }
+
+    // the body is only parsed once the method is needed
+    CHECK_AND_RETHROW(tdn_method_load_body(method));
+
+    jit_method_t* jmethod = jit_alloc(sizeof(*jmethod));
     CHECK_ERROR(jmethod != NULL, TDN_ERROR_OUT_OF_MEMORY);
     hmput(m_jit_methods, method, jmethod);
 
@@ -70,6 +101,17 @@ cleanup:
     return err;
 }
 
+void jit_resolve_shared_methods(void) {
+    for (int i = 0; i < arrlen(m_shared_methods); i++) {
+        RuntimeMethodBase method = m_shared_methods[i];
+        jit_method_t* shared = hmget(m_jit_methods, method);
+        method->MethodPtr = shared->method->MethodPtr;
+        method->MethodSize = shared->method->MethodSize;
+        method->ThunkPtr = shared->method->ThunkPtr;
+        method->ThunkSize = shared->method->ThunkSize;
+    }
+}
+
 void jit_method_register_thunk(jit_method_t* method) {
     hmput(m_jit_functions, method->thunk, method);
 }
@@ -86,7 +128,7 @@ RuntimeExceptionHandlingClause jit_get_enclosing_try_clause(jit_method_t* method
     RuntimeExceptionHandlingClause_Array arr = method->method->MethodBody->ExceptionHandlingClauses;
     RuntimeExceptionHandlingClause matched = NULL;
 
-    for (int i = 0; i < arr->Length; i++) {
+    for (int i = 0; arr != NULL && i < arr->Length; i++) {
         RuntimeExceptionHandlingClause clause = arr->Elements[i];
         if (previous == clause) {
             break;
@@ -112,41 +154,135 @@ RuntimeExceptionHandlingClause jit_get_enclosing_try_clause(jit_method_t* method
     return matched;
 }
 
-static void free_basic_block(jit_basic_block_t* block) {
-    arrfree(block->locals);
-    arrfree(block->stack);
-    arrfree(block->leave_target_stack);
-    tdn_host_free(block);
+RuntimeExceptionHandlingClause jit_get_enclosing_handler_clause(jit_method_t* method, uint32_t pc, int type) {
+    RuntimeExceptionHandlingClause_Array arr = method->method->MethodBody->ExceptionHandlingClauses;
+    RuntimeExceptionHandlingClause matched = NULL;
+
+    for (int i = 0; arr != NULL && i < arr->Length; i++) {
+        RuntimeExceptionHandlingClause clause = arr->Elements[i];
+        if (clause->Flags != type) {
+            continue;
+        }
+
+        if (clause->HandlerOffset <= pc && pc < clause->HandlerOffset + clause->HandlerLength) {
+            if (matched == NULL || matched->HandlerLength > clause->HandlerLength) {
+                matched = clause;
+            }
+        }
+    }
+
+    return matched;
+}
+
+RuntimeExceptionHandlingClause jit_get_enclosing_finally_clause(jit_method_t* method, uint32_t pc) {
+    RuntimeExceptionHandlingClause finally = jit_get_enclosing_handler_clause(method, pc, COR_ILEXCEPTION_CLAUSE_FINALLY);
+    RuntimeExceptionHandlingClause fault = jit_get_enclosing_handler_clause(method, pc, COR_ILEXCEPTION_CLAUSE_FAULT);
+    if (finally == NULL) {
+        return fault;
+    }
+    if (fault == NULL) {
+        return finally;
+    }
+    return fault->HandlerLength < finally->HandlerLength ? fault : finally;
+}
+
+int jit_get_clause_index(jit_method_t* method, RuntimeExceptionHandlingClause clause) {
+    RuntimeExceptionHandlingClause_Array arr = method->method->MethodBody->ExceptionHandlingClauses;
+
+    for (int i = 0; arr != NULL && i < arr->Length; i++) {
+        if (arr->Elements[i] == clause) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+jit_finally_t* jit_get_finally(jit_method_t* method, RuntimeExceptionHandlingClause clause) {
+    int index = jit_get_clause_index(method, clause);
+    if (index < 0) {
+        return NULL;
+    }
+    return &method->finallies[index];
+}
+
+tdn_err_t jit_get_leave_finallies(
+    jit_method_t* method, uint32_t pc, uint32_t target,
+    RuntimeExceptionHandlingClause** out_chain, int* out_count
+) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeExceptionHandlingClause_Array arr = method->method->MethodBody->ExceptionHandlingClauses;
+
+    *out_chain = NULL;
+    *out_count = 0;
+    if (arr == NULL) {
+        goto cleanup;
+    }
+
+    RuntimeExceptionHandlingClause* chain = jit_alloc(sizeof(RuntimeExceptionHandlingClause) * arr->Length);
+    CHECK_ERROR(chain != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+    // every finally we exit, they all contain the pc so they are nested in each
+    // other, sort them by the size of the try to get them from the inner most out
+    int count = 0;
+    for (int i = 0; i < arr->Length; i++) {
+        RuntimeExceptionHandlingClause clause = arr->Elements[i];
+        if (clause->Flags != COR_ILEXCEPTION_CLAUSE_FINALLY) {
+            continue;
+        }
+
+        uint32_t try_end = clause->TryOffset + clause->TryLength;
+        bool has_pc = clause->TryOffset <= pc && pc < try_end;
+        bool has_target = clause->TryOffset <= target && target < try_end;
+        if (!has_pc || has_target) {
+            continue;
+        }
+
+        int j = count++;
+        while (j > 0 && chain[j - 1]->TryLength > clause->TryLength) {
+            chain[j] = chain[j - 1];
+            j--;
+        }
+        chain[j] = clause;
+    }
+
+    *out_chain = chain;
+    *out_count = count;
+
+cleanup:
+    return err;
 }
 
 void jit_clean() {
     for (int i = 0; i < hmlen(m_jit_methods); i++) {
         jit_method_t* method = m_jit_methods[i].value;
-        if (method == NULL) {
+
+        // shared methods use the jit method of the method they share
+        // code with, only clean the real one
+        if (method == NULL || method->method != m_jit_methods[i].key) {
             continue;
         }
 
-        // make sure all the things made while
+        // the stb_ds containers are not part of the arena
         arrfree(method->args);
         arrfree(method->locals);
+        arrfree(method->insts);
         arrfree(method->block_queue);
-
-        // free the labels
-        hmfree(method->labels);
-
-        // free all the basic block structs
-        for (int j = 0; j < arrlen(method->basic_blocks); j++) {
-            free_basic_block(method->basic_blocks[j]);
-        }
         arrfree(method->basic_blocks);
+        hmfree(method->labels);
 
-        // free all the leave paths
-        for (int j = 0; j < hmlen(method->leave_blocks); j++) {
-            free_basic_block(method->leave_blocks[j].value);
+        RuntimeExceptionHandlingClause_Array clauses = method->method->MethodBody != NULL ?
+                method->method->MethodBody->ExceptionHandlingClauses : NULL;
+        for (int j = 0; method->finallies != NULL && j < clauses->Length; j++) {
+            arrfree(method->finallies[j].continuations);
+            arrfree(method->finallies[j].endfinally_blocks);
         }
-        hmfree(method->leave_blocks);
     }
 
     hmfree(m_jit_methods);
-}
+    hmfree(m_jit_functions);
+    arrfree(m_shared_methods);
 
+    // and now release all the methods and blocks
+    arena_reset(&m_jit_arena);
+}
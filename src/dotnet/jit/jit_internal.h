@@ -3,8 +3,11 @@
 #include <dotnet/types.h>
 #include <spidir/module.h>
 #include <tomatodotnet/types/reflection.h>
+#include <tomatodotnet/disasm.h>
 #include <util/defs.h>
 
+#include "jit_shared.h"
+
 // enable printing while verifying
 // #define JIT_VERBOSE_VERIFY
 // #define JIT_DEBUG_VERIFY
@@ -86,14 +89,16 @@ typedef struct jit_basic_block {
     uint32_t start;
     uint32_t end;
 
-    // leave target, larger than zero if any
-    uint32_t* leave_target_stack;
+    // the index of the first instruction of the block
+    uint32_t first_inst;
 
     // the stack at the entry point
     jit_stack_value_t* stack;
+    size_t stack_count;
 
     // the attributes of all the locals at the entry point
     jit_item_attrs_t* locals;
+    size_t locals_count;
 
     // is this block verified
     jit_basic_block_state_t state;
@@ -128,10 +133,24 @@ typedef struct jit_local {
     spidir_value_t value;
 } jit_local_t;
 
-typedef struct jit_leave_block_key {
-    jit_basic_block_t* block;
-    uint64_t leave_target;
-} jit_leave_block_key_t;
+typedef struct jit_finally {
+    // the places to go to once the handler is done, either the handler of the
+    // next finally in the chain of a leave or the target of the leave itself
+    uint32_t* continuations;
+
+    // the blocks that end the handler, verified again
+    // whenever a new continuation is found
+    jit_basic_block_t** endfinally_blocks;
+
+    // stack slot that holds the index of the continuation to take,
+    // only needed if there is more than one continuation
+    spidir_value_t selector;
+
+    // the handler also runs when an exception leaves the try, once done it
+    // continues to unwind, the selector has the index after the continuations
+    // for it, fault handlers only ever run like this
+    bool unwinds;
+} jit_finally_t;
 
 typedef struct jit_method {
     // the C# method we are handling right now
@@ -149,6 +168,10 @@ typedef struct jit_method {
     // the args of the method
     jit_arg_t* args;
 
+    // the decoded instructions of the method, the method is only decoded
+    // once and both verification and emitting use the same instructions
+    tdn_il_inst_t* insts;
+
     // list of labels, from pc -> basic block index
     // this is used to find jump targets
     struct {
@@ -156,14 +179,14 @@ typedef struct jit_method {
         jit_basic_block_t* value;
     }* labels;
 
-    // blocks duplicated as part of being in a leave path
-    // they are initialized to a default value but are
-    // associated with a leave target
-    // the hashmap owns the basic blocks in it
-    struct {
-        jit_leave_block_key_t key;
-        jit_basic_block_t* value;
-    }* leave_blocks;
+    // the state of the finally handlers, the handler of each finally is only
+    // emitted once and the leaves tell it where to continue with a selector,
+    // indexed like the exception handling clauses
+    jit_finally_t* finallies;
+
+    // the stack slot of every clause that holds the exception its handler
+    // runs for, indexed like the exception handling clauses
+    spidir_value_t* exception_slots;
 
     // the spidir function for this method
     spidir_function_t function;
@@ -171,6 +194,13 @@ typedef struct jit_method {
     // the static stub of the method
     spidir_function_t thunk;
 
+    // the dictionary layout, only set when this is the shared code
+    // of a generic type that needs the exact type arguments
+    jit_dictionary_t* dictionary;
+
+    // the dictionary of the type of this, loaded on entry
+    spidir_value_t dictionary_ptr;
+
     // the method's state
     bool verifying;
 
@@ -194,6 +224,7 @@ static inline bool jit_is_struct(RuntimeTypeInfo type) {
             type != tInt32 &&
             type != tInt64 &&
             type != tIntPtr &&
+            type != tDouble &&
             !type->IsByRef;
 }
 
@@ -201,10 +232,57 @@ static inline bool jit_is_struct_like(RuntimeTypeInfo type) {
     return jit_is_interface(type) || jit_is_struct(type) || jit_is_delegate(type);
 }
 
+/**
+ * The MethodBody field of the reflection objects, bodies are parsed
+ * on first use so the field is read through jit_get_method_body
+ */
+static inline bool jit_is_method_body_field(RuntimeFieldInfo field) {
+    return !field->Attributes.Static &&
+        field->FieldType == tRuntimeMethodBody &&
+        field->FieldOffset == offsetof(struct RuntimeMethodBase, MethodBody) &&
+        (field->DeclaringType == tRuntimeMethodInfo || field->DeclaringType == tRuntimeConstructorInfo);
+}
+
+/**
+ * The Name field of parameters, names are created on first
+ * use so the field is read through jit_get_parameter_name
+ */
+static inline bool jit_is_parameter_name_field(RuntimeFieldInfo field) {
+    return !field->Attributes.Static &&
+        field->FieldType == tString &&
+        field->FieldOffset == offsetof(struct ParameterInfo, Name) &&
+        field->DeclaringType == tParameterInfo;
+}
+
 static inline size_t jit_get_boxed_value_offset(RuntimeTypeInfo type) {
     return ALIGN_UP(sizeof(struct Object), type->StackAlignment);
 }
 
+/**
+ * Types that are not beforefieldinit must run their cctor exactly
+ * before the first access to a static or a method
+ */
+static inline bool jit_type_needs_lazy_init(RuntimeTypeInfo type) {
+    return type->TypeInitializer != NULL && !type->Attributes.BeforeFieldInit;
+}
+
+/**
+ * The methods that trigger the cctor of their type: static methods, ctors and,
+ * since a value type can exist without running any ctor, its instance methods
+ */
+static inline bool jit_method_checks_init_on_entry(RuntimeMethodBase method) {
+    RuntimeTypeInfo type = method->DeclaringType;
+    return jit_type_needs_lazy_init(type) &&
+        method != (RuntimeMethodBase)type->TypeInitializer &&
+        (method->Attributes.Static || method->Attributes.RTSpecialName || tdn_type_is_valuetype(type));
+}
+
+/**
+ * Allocate zeroed memory for the current jit session, everything
+ * allocated is released at once by jit_clean
+ */
+void* jit_alloc(size_t size);
+
 /*
  * Create or get the jit method for the given method
  *
@@ -213,6 +291,12 @@ static inline size_t jit_get_boxed_value_offset(RuntimeTypeInfo type) {
  */
 tdn_err_t jit_get_or_create_method(RuntimeMethodBase method, jit_method_t** jit_method);
 
+/**
+ * Give the methods that share code with another method the pointers
+ * of the shared code, must be called after the code is mapped
+ */
+void jit_resolve_shared_methods(void);
+
 /**
  * Register the thunk of the given method
  */
@@ -234,6 +318,36 @@ jit_method_t* jit_get_method_from_function(spidir_function_t function);
  */
 RuntimeExceptionHandlingClause jit_get_enclosing_try_clause(jit_method_t* method, uint32_t pc, int type, RuntimeExceptionHandlingClause previous);
 
+/**
+ * Find the inner most clause of the given type whose handler contains the pc
+ */
+RuntimeExceptionHandlingClause jit_get_enclosing_handler_clause(jit_method_t* method, uint32_t pc, int type);
+
+/**
+ * Find the inner most finally or fault clause whose handler contains the pc,
+ * this is the handler that an endfinally (or endfault) ends
+ */
+RuntimeExceptionHandlingClause jit_get_enclosing_finally_clause(jit_method_t* method, uint32_t pc);
+
+/**
+ * Get the index of the clause in the exception handling clauses of the method
+ */
+int jit_get_clause_index(jit_method_t* method, RuntimeExceptionHandlingClause clause);
+
+/**
+ * Get the state of the given finally clause
+ */
+jit_finally_t* jit_get_finally(jit_method_t* method, RuntimeExceptionHandlingClause clause);
+
+/**
+ * Get the finally clauses a leave from the pc to the target runs, from the inner most
+ * to the outer most, these are the finallies whose try has the pc but not the target
+ */
+tdn_err_t jit_get_leave_finallies(
+    jit_method_t* method, uint32_t pc, uint32_t target,
+    RuntimeExceptionHandlingClause** out_chain, int* out_count
+);
+
 /**
  * clear the created jit methods, done as part of cleaning up the codegen
  */
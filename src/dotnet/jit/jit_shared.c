@@ -0,0 +1,469 @@
+#include "jit_shared.h"
+
+#include <dotnet/loader.h>
+#include <dotnet/types.h>
+#include <dotnet/gc/gc.h>
+#include <tomatodotnet/disasm.h>
+#include <util/alloc.h>
+#include <util/except.h>
+#include <util/stb_ds.h>
+
+#include "jit_internal.h"
+
+typedef enum jit_share_state {
+    JIT_SHARE_UNKNOWN,
+    JIT_SHARE_CHECKING,
+    JIT_SHARE_NO,
+    JIT_SHARE_YES,
+} jit_share_state_t;
+
+/**
+ * Cache of which generic definition methods can share their code
+ */
+static struct {
+    RuntimeMethodBase key;
+    jit_share_state_t value;
+}* m_share_states = NULL;
+
+/**
+ * The dictionary layouts of the generic type definitions
+ */
+static struct {
+    RuntimeTypeInfo key;
+    jit_dictionary_t* value;
+}* m_dictionaries = NULL;
+
+static bool is_generic_instance(RuntimeTypeInfo type) {
+    return type->GenericTypeDefinition != NULL && !tdn_is_generic_type_definition(type);
+}
+
+static RuntimeMethodBase find_method_by_token(RuntimeTypeInfo type, int token) {
+    for (int i = 0; i < type->DeclaredMethods->Length; i++) {
+        if (type->DeclaredMethods->Elements[i]->MetadataToken == token) {
+            return (RuntimeMethodBase)type->DeclaredMethods->Elements[i];
+        }
+    }
+
+    for (int i = 0; i < type->DeclaredConstructors->Length; i++) {
+        if (type->DeclaredConstructors->Elements[i]->MetadataToken == token) {
+            return (RuntimeMethodBase)type->DeclaredConstructors->Elements[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Is the type a class in all of the instantiations that share code, the
+ * parameters themselves are only ever plain reference types in there
+ */
+static bool is_shared_class(RuntimeTypeInfo type) {
+    if (type->IsGenericParameter) {
+        return true;
+    }
+
+    // interfaces and delegates are fat references, so
+    // they don't have the same layout as object
+    return tdn_type_is_referencetype(type) && !jit_is_struct_like(type);
+}
+
+/**
+ * The instance can share code as long as no argument carries any constraint that object
+ * wouldn't satisfy, when checking a body the arguments might be our own parameters
+ */
+static bool can_share_type(RuntimeTypeInfo type) {
+    RuntimeTypeInfo definition = type->GenericTypeDefinition;
+
+    for (int i = 0; i < type->GenericArguments->Length; i++) {
+        RuntimeTypeInfo arg = type->GenericArguments->Elements[i];
+        if (!is_shared_class(arg)) {
+            return false;
+        }
+
+        RuntimeTypeInfo param = definition->GenericArguments->Elements[i];
+        if (param->GenericParameterConstraints != NULL && param->GenericParameterConstraints->Length != 0) {
+            return false;
+        }
+
+        if ((param->GenericParameterAttributes.SpecialConstraint & ~TDN_GENERIC_PARAM_CONSTRAINT_REFERENCE_TYPE) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static jit_dictionary_t* get_dictionary(RuntimeTypeInfo definition) {
+    jit_dictionary_t* dictionary = hmget(m_dictionaries, definition);
+    if (dictionary != NULL) {
+        return dictionary;
+    }
+
+    dictionary = tdn_mallocz(sizeof(*dictionary));
+    if (dictionary == NULL) {
+        return NULL;
+    }
+    dictionary->definition = definition;
+
+    // the base types of all the instances are at the same depth
+    for (RuntimeTypeInfo base = definition->BaseType; base != NULL; base = base->BaseType) {
+        dictionary->depth++;
+    }
+
+    hmput(m_dictionaries, definition, dictionary);
+    return dictionary;
+}
+
+int jit_dictionary_find(jit_dictionary_t* dictionary, jit_dictionary_kind_t kind, int token) {
+    if (dictionary == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < arrlen(dictionary->entries); i++) {
+        if (dictionary->entries[i].kind == kind && dictionary->entries[i].token == token) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void add_entry(jit_dictionary_entry_t** entries, jit_dictionary_kind_t kind, int token) {
+    for (int i = 0; i < arrlen(*entries); i++) {
+        if ((*entries)[i].kind == kind && (*entries)[i].token == token) {
+            return;
+        }
+    }
+
+    arrpush(*entries, ((jit_dictionary_entry_t){ .kind = kind, .token = token }));
+}
+
+static tdn_err_t check_method_shareable(RuntimeMethodBase definition, bool* out_shareable);
+
+/**
+ * Check a single instruction of the body against the rules of sharing, anything that
+ * depends on the exact type arguments either takes them from the dictionary or is
+ * not shared, the entries the instruction needs are added to the given list
+ */
+static tdn_err_t check_inst_shareable(tdn_il_inst_t* inst, jit_dictionary_entry_t** entries, bool* out_shareable) {
+    tdn_err_t err = TDN_NO_ERROR;
+    bool shareable = true;
+
+    switch (inst->operand_type) {
+        case TDN_IL_TYPE: {
+            RuntimeTypeInfo type = inst->operand.type;
+            if (!tdn_has_generic_parameters(type)) {
+                break;
+            }
+
+            switch (inst->opcode) {
+                // the layout is the same in all of the reference type instantiations
+                case CEE_LDELEM:
+                case CEE_STELEM:
+                case CEE_LDELEMA:
+                case CEE_LDOBJ:
+                case CEE_STOBJ:
+                case CEE_INITOBJ:
+                case CEE_SIZEOF:
+                    break;
+
+                // boxing a reference does nothing
+                case CEE_BOX: {
+                    shareable = is_shared_class(type);
+                } break;
+
+                case CEE_NEWARR: {
+                    add_entry(entries, JIT_DICTIONARY_ARRAY_TYPE, inst->operand_token);
+                } break;
+
+                // checking against a class only needs its hierarchy, anything
+                // else needs the exact type while emitting
+                case CEE_CASTCLASS:
+                case CEE_ISINST: {
+                    shareable = is_shared_class(type);
+                    if (shareable) {
+                        add_entry(entries, JIT_DICTIONARY_TYPE_HIERARCHY, inst->operand_token);
+                        add_entry(entries, JIT_DICTIONARY_TYPE_MASK, inst->operand_token);
+                    }
+                } break;
+
+                default: {
+                    shareable = false;
+                } break;
+            }
+        } break;
+
+        // instance fields have the same offset in all of the reference type
+        // instantiations, static fields are per instantiation
+        case TDN_IL_FIELD: {
+            RuntimeFieldInfo field = inst->operand.field;
+            if (!field->Attributes.Static || !tdn_has_generic_parameters(field->DeclaringType)) {
+                break;
+            }
+
+            add_entry(entries, JIT_DICTIONARY_STATIC_FIELD, inst->operand_token);
+            if (jit_type_needs_lazy_init(field->DeclaringType->GenericTypeDefinition)) {
+                add_entry(entries, JIT_DICTIONARY_FIELD_TYPE_INIT, inst->operand_token);
+            }
+        } break;
+
+        case TDN_IL_METHOD: {
+            RuntimeMethodBase target = inst->operand.method;
+
+            // the target itself is generic over our parameters
+            if (target->GenericArguments != NULL) {
+                for (int i = 0; i < target->GenericArguments->Length; i++) {
+                    if (tdn_has_generic_parameters(target->GenericArguments->Elements[i])) {
+                        shareable = false;
+                        break;
+                    }
+                }
+            }
+
+            RuntimeTypeInfo target_type = target->DeclaringType;
+            if (!shareable || !tdn_has_generic_parameters(target_type)) {
+                break;
+            }
+
+            // taking the address of the method needs the exact method
+            if (inst->opcode == CEE_LDFTN || inst->opcode == CEE_LDVIRTFTN) {
+                shareable = false;
+                break;
+            }
+
+            // the target must share its code in all of our instantiations
+            if (target_type->GenericTypeDefinition == NULL || !is_shared_class(target_type) || !can_share_type(target_type)) {
+                shareable = false;
+                break;
+            }
+
+            // allocating takes the exact type from the dictionary, the ctor
+            // gets the exact object so it finds its own dictionary
+            if (inst->opcode == CEE_NEWOBJ) {
+                add_entry(entries, JIT_DICTIONARY_NEW_TYPE, inst->operand_token);
+            }
+
+            // we call into the shared code of the target, so it must be shareable
+            // as well, it takes anything it needs from the dictionary of this
+            RuntimeMethodBase target_definition = find_method_by_token(target_type->GenericTypeDefinition, target->MetadataToken);
+            CHECK(target_definition != NULL);
+            CHECK_AND_RETHROW(check_method_shareable(target_definition, &shareable));
+        } break;
+
+        default:
+            break;
+    }
+
+    *out_shareable = shareable;
+
+cleanup:
+    return err;
+}
+
+static tdn_err_t check_method_shareable(RuntimeMethodBase definition, bool* out_shareable) {
+    tdn_err_t err = TDN_NO_ERROR;
+    jit_dictionary_entry_t* entries = NULL;
+    jit_share_state_t state = hmget(m_share_states, definition);
+
+    // for recursive calls we assume it can't be shared, this
+    // is more conservative but is always correct
+    if (state != JIT_SHARE_UNKNOWN) {
+        *out_shareable = state == JIT_SHARE_YES;
+        goto cleanup;
+    }
+
+    hmput(m_share_states, definition, JIT_SHARE_CHECKING);
+    state = JIT_SHARE_NO;
+
+    // only normal IL methods can be shared, the type initializer
+    // runs once per instantiation so it is never shared
+    RuntimeTypeInfo type = definition->DeclaringType;
+    if (definition == (RuntimeMethodBase)type->TypeInitializer) {
+        goto done;
+    }
+
+    CHECK_AND_RETHROW(tdn_method_load_body(definition));
+    RuntimeMethodBody body = definition->MethodBody;
+    if (body == NULL || definition->GenericArguments != NULL) {
+        goto done;
+    }
+
+    // catching by one of the type arguments needs the exact type
+    if (body->ExceptionHandlingClauses != NULL) {
+        for (int i = 0; i < body->ExceptionHandlingClauses->Length; i++) {
+            RuntimeExceptionHandlingClause clause = body->ExceptionHandlingClauses->Elements[i];
+            if (clause->CatchType != NULL && tdn_has_generic_parameters(clause->CatchType)) {
+                goto done;
+            }
+        }
+    }
+
+    // go over the body and check every instruction
+    uint32_t pc = 0;
+    while (pc < body->ILSize) {
+        tdn_il_inst_t inst;
+        CHECK_AND_RETHROW(tdn_disasm_inst(definition, pc, &inst));
+
+        bool shareable = false;
+        CHECK_AND_RETHROW(check_inst_shareable(&inst, &entries, &shareable));
+        if (!shareable) {
+            goto done;
+        }
+
+        pc += inst.length;
+    }
+
+    // methods that run the lazy cctor on entry must run the one of the exact type
+    if (jit_method_checks_init_on_entry(definition)) {
+        add_entry(&entries, JIT_DICTIONARY_SELF_TYPE_INIT, 0);
+    }
+
+    // the dictionary is found through the vtable of this, so only
+    // the instance methods of classes can have one
+    if (arrlen(entries) != 0) {
+        if (definition->Attributes.Static || tdn_type_is_valuetype(type) || jit_is_interface(type)) {
+            goto done;
+        }
+
+        // add the entries to the layout of our type, once all the methods are
+        // checked the layout is complete, so we must never get here after
+        jit_dictionary_t* dictionary = get_dictionary(type);
+        CHECK_ERROR(dictionary != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        CHECK(!dictionary->complete);
+        for (int i = 0; i < arrlen(entries); i++) {
+            add_entry(&dictionary->entries, entries[i].kind, entries[i].token);
+        }
+    }
+
+    state = JIT_SHARE_YES;
+
+done:
+    hmput(m_share_states, definition, state);
+    *out_shareable = state == JIT_SHARE_YES;
+
+cleanup:
+    if (IS_ERROR(err)) {
+        hmput(m_share_states, definition, JIT_SHARE_NO);
+    }
+    arrfree(entries);
+
+    return err;
+}
+
+/**
+ * Check all the methods of the definition, so the layout has the entries of
+ * every method that might run as shared code before any dictionary is filled
+ */
+static tdn_err_t complete_dictionary(jit_dictionary_t* dictionary) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeTypeInfo definition = dictionary->definition;
+
+    if (dictionary->complete) {
+        goto cleanup;
+    }
+
+    bool shareable = false;
+    for (int i = 0; i < definition->DeclaredMethods->Length; i++) {
+        CHECK_AND_RETHROW(check_method_shareable((RuntimeMethodBase)definition->DeclaredMethods->Elements[i], &shareable));
+    }
+
+    for (int i = 0; i < definition->DeclaredConstructors->Length; i++) {
+        CHECK_AND_RETHROW(check_method_shareable((RuntimeMethodBase)definition->DeclaredConstructors->Elements[i], &shareable));
+    }
+
+    dictionary->complete = true;
+
+cleanup:
+    return err;
+}
+
+tdn_err_t jit_get_type_dictionary(RuntimeTypeInfo type, jit_dictionary_t** out_dictionary) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    *out_dictionary = NULL;
+
+    if (!is_generic_instance(type) || tdn_type_is_valuetype(type) || jit_is_interface(type) || !can_share_type(type)) {
+        goto cleanup;
+    }
+
+    jit_dictionary_t* dictionary = get_dictionary(type->GenericTypeDefinition);
+    CHECK_ERROR(dictionary != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    CHECK_AND_RETHROW(complete_dictionary(dictionary));
+
+    if (arrlen(dictionary->entries) != 0) {
+        *out_dictionary = dictionary;
+    }
+
+cleanup:
+    return err;
+}
+
+tdn_err_t jit_get_method_dictionary(RuntimeMethodBase method, jit_dictionary_t** out_dictionary) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeTypeInfo type = method->DeclaringType;
+
+    *out_dictionary = NULL;
+
+    if (method->Attributes.Static || method->GenericArguments != NULL || !is_generic_instance(type)) {
+        goto cleanup;
+    }
+
+    // only the canonical instantiation is compiled as the shared code
+    for (int i = 0; i < type->GenericArguments->Length; i++) {
+        if (type->GenericArguments->Elements[i] != tObject) {
+            goto cleanup;
+        }
+    }
+
+    RuntimeMethodBase definition_method = find_method_by_token(type->GenericTypeDefinition, method->MetadataToken);
+    CHECK(definition_method != NULL);
+
+    bool shareable = false;
+    CHECK_AND_RETHROW(check_method_shareable(definition_method, &shareable));
+    if (!shareable) {
+        goto cleanup;
+    }
+
+    CHECK_AND_RETHROW(jit_get_type_dictionary(type, out_dictionary));
+
+cleanup:
+    return err;
+}
+
+tdn_err_t jit_get_shared_method(RuntimeMethodBase method, RuntimeMethodBase* out_shared) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeTypeInfo type = method->DeclaringType;
+
+    *out_shared = method;
+
+    // only methods of generic instances that are not generic themselves
+    if (!is_generic_instance(type) || method->GenericArguments != NULL || !can_share_type(type)) {
+        goto cleanup;
+    }
+
+    RuntimeTypeInfo definition = type->GenericTypeDefinition;
+    RuntimeMethodBase definition_method = find_method_by_token(definition, method->MetadataToken);
+    CHECK(definition_method != NULL);
+
+    bool shareable = false;
+    CHECK_AND_RETHROW(check_method_shareable(definition_method, &shareable));
+    if (!shareable) {
+        goto cleanup;
+    }
+
+    // get the canonical instantiation
+    RuntimeTypeInfo_Array args = GC_NEW_ARRAY(RuntimeTypeInfo, type->GenericArguments->Length);
+    for (int i = 0; i < args->Length; i++) {
+        args->Elements[i] = tObject;
+    }
+
+    RuntimeTypeInfo canonical = NULL;
+    CHECK_AND_RETHROW(tdn_type_make_generic(definition, args, &canonical));
+
+    RuntimeMethodBase shared = find_method_by_token(canonical, method->MetadataToken);
+    CHECK(shared != NULL);
+    *out_shared = shared;
+
+cleanup:
+    return err;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <tomatodotnet/except.h>
+#include <tomatodotnet/types/reflection.h>
+
+typedef enum jit_dictionary_kind {
+    // the exact type allocated by a newobj, the token is of the ctor
+    JIT_DICTIONARY_NEW_TYPE,
+
+    // the exact array type allocated by a newarr
+    JIT_DICTIONARY_ARRAY_TYPE,
+
+    // the type hierarchy and mask of the exact
+    // type, for castclass and isinst
+    JIT_DICTIONARY_TYPE_HIERARCHY,
+    JIT_DICTIONARY_TYPE_MASK,
+
+    // the address of a static field of the exact type
+    JIT_DICTIONARY_STATIC_FIELD,
+
+    // the init state of the type of a static field, for types with a lazy cctor
+    JIT_DICTIONARY_FIELD_TYPE_INIT,
+
+    // the init state of the exact type itself, for the ctors of
+    // types with a lazy cctor, the token is always zero
+    JIT_DICTIONARY_SELF_TYPE_INIT,
+} jit_dictionary_kind_t;
+
+typedef struct jit_dictionary_entry {
+    jit_dictionary_kind_t kind;
+    int token;
+} jit_dictionary_entry_t;
+
+/**
+ * The layout of the dictionary of a generic type definition, every instance that
+ * shares code has its own dictionary with the entries resolved for its arguments
+ */
+typedef struct jit_dictionary {
+    // the generic type definition
+    RuntimeTypeInfo definition;
+
+    // the depth of the type in its hierarchy, the vtable of every
+    // object has the dictionaries of its bases by their depth
+    int depth;
+
+    // the entries needed by all the shared methods of
+    // the type, the index of an entry is its slot
+    struct jit_dictionary_entry* entries;
+
+    // all the methods of the type were checked, so
+    // no entries are going to be added anymore
+    bool complete;
+} jit_dictionary_t;
+
+/**
+ * Get the method whose code should be used for the given method. Methods of generic
+ * types instantiated only over reference types share the code of the canonical
+ * instantiation (all the arguments are object), anything in the body that needs the
+ * exact type arguments takes them from the dictionary of the type of this. Methods
+ * that would need the dictionary without having a this are not shared
+ */
+tdn_err_t jit_get_shared_method(RuntimeMethodBase method, RuntimeMethodBase* out_shared);
+
+/**
+ * Get the dictionary that the given method uses, only the canonical instantiation is
+ * compiled as the shared code, for everything else there is no dictionary (NULL)
+ */
+tdn_err_t jit_get_method_dictionary(RuntimeMethodBase method, jit_dictionary_t** out_dictionary);
+
+/**
+ * Get the dictionary layout of a type instance whose methods might run as shared code,
+ * NULL if the code of the type never needs one
+ */
+tdn_err_t jit_get_type_dictionary(RuntimeTypeInfo type, jit_dictionary_t** out_dictionary);
+
+/**
+ * Find the slot of an entry in the dictionary, -1 if there is
+ * no such entry, in which case the exact type is not needed
+ */
+int jit_dictionary_find(jit_dictionary_t* dictionary, jit_dictionary_kind_t kind, int token);
@@ -1,5 +1,6 @@
 #include "jit_verify.h"
 
+#include <dotnet/loader.h>
 #include <dotnet/types.h>
 #include <tomatodotnet/disasm.h>
 #include <util/alloc.h>
@@ -37,6 +38,139 @@ cleanup:
     return err;
 }
 
+static tdn_err_t jit_queue_type(RuntimeTypeInfo type);
+
+/**
+ * The filled dictionaries of the generic instances, shared by all
+ * the types that have the instance in their hierarchy
+ */
+static struct {
+    RuntimeTypeInfo key;
+    void** value;
+}* m_filled_dictionaries = NULL;
+
+/**
+ * Resolve all the entries of the dictionary for the exact instance, everything the
+ * shared code might touch is queued, just like the verifier does for normal code
+ */
+static tdn_err_t jit_fill_dictionary(RuntimeTypeInfo type, jit_dictionary_t* dictionary, void*** out_slots) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    void** slots = hmget(m_filled_dictionaries, type);
+    if (slots != NULL) {
+        *out_slots = slots;
+        goto cleanup;
+    }
+
+    // publish it before resolving, the entries might lead back to this type
+    slots = tdn_mallocz(sizeof(void*) * arrlen(dictionary->entries));
+    CHECK_ERROR(slots != NULL, TDN_ERROR_OUT_OF_MEMORY);
+    hmput(m_filled_dictionaries, type, slots);
+
+    RuntimeAssembly assembly = type->Module->Assembly;
+    RuntimeTypeInfo_Array args = type->GenericArguments;
+    for (int i = 0; i < arrlen(dictionary->entries); i++) {
+        jit_dictionary_entry_t* entry = &dictionary->entries[i];
+        switch (entry->kind) {
+            case JIT_DICTIONARY_NEW_TYPE: {
+                RuntimeMethodBase ctor = NULL;
+                CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, entry->token, args, NULL, &ctor));
+                CHECK_AND_RETHROW(jit_queue_type(ctor->DeclaringType));
+                CHECK_AND_RETHROW(jit_queue_cctor(ctor->DeclaringType));
+                slots[i] = ctor->DeclaringType;
+            } break;
+
+            case JIT_DICTIONARY_ARRAY_TYPE: {
+                RuntimeTypeInfo element_type = NULL;
+                CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, entry->token, args, NULL, &element_type));
+                CHECK_AND_RETHROW(tdn_type_init(element_type));
+
+                RuntimeTypeInfo array_type = NULL;
+                CHECK_AND_RETHROW(tdn_get_array_type(element_type, &array_type));
+                slots[i] = array_type;
+            } break;
+
+            case JIT_DICTIONARY_TYPE_HIERARCHY:
+            case JIT_DICTIONARY_TYPE_MASK: {
+                RuntimeTypeInfo target = NULL;
+                CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, entry->token, args, NULL, &target));
+                CHECK_AND_RETHROW(tdn_type_init(target));
+
+                if (entry->kind == JIT_DICTIONARY_TYPE_HIERARCHY) {
+                    slots[i] = (void*)target->JitVTable->TypeHierarchy;
+                } else {
+                    slots[i] = (void*)((1ull << target->TypeMaskLength) - 1ull);
+                }
+            } break;
+
+            case JIT_DICTIONARY_STATIC_FIELD: {
+                RuntimeFieldInfo field = NULL;
+                CHECK_AND_RETHROW(tdn_assembly_lookup_field(assembly, entry->token, args, NULL, &field));
+                CHECK_AND_RETHROW(tdn_type_init(field->DeclaringType));
+                CHECK_AND_RETHROW(jit_init_static_field(field));
+                CHECK_AND_RETHROW(jit_queue_cctor(field->DeclaringType));
+                slots[i] = field->JitFieldPtr;
+            } break;
+
+            case JIT_DICTIONARY_FIELD_TYPE_INIT: {
+                RuntimeFieldInfo field = NULL;
+                CHECK_AND_RETHROW(tdn_assembly_lookup_field(assembly, entry->token, args, NULL, &field));
+                CHECK_AND_RETHROW(jit_get_type_init_state(field->DeclaringType, (jit_type_init_state_t**)&slots[i]));
+            } break;
+
+            case JIT_DICTIONARY_SELF_TYPE_INIT: {
+                CHECK_AND_RETHROW(jit_queue_cctor(type));
+                CHECK_AND_RETHROW(jit_get_type_init_state(type, (jit_type_init_state_t**)&slots[i]));
+            } break;
+
+            default:
+                CHECK_FAIL();
+        }
+    }
+
+    *out_slots = slots;
+
+cleanup:
+    return err;
+}
+
+/**
+ * Give the vtable of the type the dictionaries of all the generic instances in
+ * its hierarchy, the shared code finds its own one by the depth of its type
+ */
+static tdn_err_t jit_queue_dictionaries(RuntimeTypeInfo type) {
+    tdn_err_t err = TDN_NO_ERROR;
+    void*** dictionaries = NULL;
+
+    int depth = 0;
+    for (RuntimeTypeInfo base = type->BaseType; base != NULL; base = base->BaseType) {
+        depth++;
+    }
+
+    for (RuntimeTypeInfo base = type; base != NULL; base = base->BaseType, depth--) {
+        jit_dictionary_t* dictionary = NULL;
+        CHECK_AND_RETHROW(jit_get_type_dictionary(base, &dictionary));
+        if (dictionary == NULL) {
+            continue;
+        }
+        CHECK(dictionary->depth == depth);
+
+        if (dictionaries == NULL) {
+            dictionaries = tdn_mallocz(sizeof(void**) * (depth + 1));
+            CHECK_ERROR(dictionaries != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        }
+
+        CHECK_AND_RETHROW(jit_fill_dictionary(base, dictionary, &dictionaries[depth]));
+    }
+
+    if (dictionaries != NULL) {
+        type->JitVTable->GenericDictionaries = dictionaries;
+    }
+
+cleanup:
+    return err;
+}
+
 static tdn_err_t jit_queue_type(RuntimeTypeInfo type) {
     tdn_err_t err = TDN_NO_ERROR;
 
@@ -46,6 +180,14 @@ static tdn_err_t jit_queue_type(RuntimeTypeInfo type) {
     }
     type->JitStartedInstance = true;
 
+    // the type might not have been used yet
+    CHECK_AND_RETHROW(tdn_type_init(type));
+
+    // objects of the type might run shared code
+    if (!tdn_type_is_valuetype(type)) {
+        CHECK_AND_RETHROW(jit_queue_dictionaries(type));
+    }
+
     // if not we are going to queue all the methods
     for (int i = 0; i < type->VTable->Length; i++) {
         jit_method_t* jit_method;
@@ -99,6 +241,11 @@ static bool verifier_is_binary_comparable(RuntimeTypeInfo src, RuntimeTypeInfo d
         return dst == tInt32 || dst == tIntPtr;
     }
 
+    // can only compare F to F
+    if (src == tDouble) {
+        return dst == tDouble;
+    }
+
     // anything else is not comparable
     return false;
 }
@@ -139,58 +286,12 @@ static bool jit_merge_attrs(jit_item_attrs_t* wanted, jit_item_attrs_t* actual)
     return modified;
 }
 
-static uint32_t* copy_leave_targets(uint32_t* targets) {
-    if (targets == NULL) {
-        return NULL;
-    }
-
-    uint32_t* new = NULL;
-    arrsetlen(new, arrlen(targets));
-    memcpy(new, targets, sizeof(uint32_t) * arrlen(targets));
-    return new;
-}
-
-static jit_basic_block_t* get_basic_block(
-    jit_method_t* method,
-    long target_pc,
-    uint32_t* leave_target_stack
-) {
+static jit_basic_block_t* get_basic_block(jit_method_t* method, long target_pc) {
     int bi = hmgeti(method->labels, target_pc);
     if (bi < 0) {
         return NULL;
     }
-    jit_basic_block_t* block = method->labels[bi].value;
-
-    // lookup based on the leave target
-    if (leave_target_stack != NULL) {
-        jit_leave_block_key_t key = {
-            .block = block,
-            .leave_target = arrlast(leave_target_stack)
-        };
-
-        int bi = hmgeti(method->leave_blocks, key);
-        if (bi >= 0) {
-            block = method->leave_blocks[bi].value;
-        } else {
-            jit_basic_block_t* new_block = tdn_mallocz(sizeof(jit_basic_block_t));
-            if (new_block == NULL) {
-                return NULL;
-            }
-
-            new_block->start = block->start;
-            new_block->end = block->end;
-            new_block->leave_target_stack = leave_target_stack;
-
-            // save the new block
-            hmput(method->leave_blocks, key, new_block);
-
-            // and return the new block instead
-            // of the original block
-            block = new_block;
-        }
-    }
-
-    return block;
+    return method->labels[bi].value;
 }
 
 static void verify_queue_basic_block(jit_method_t* ctx, jit_basic_block_t* block) {
@@ -200,25 +301,46 @@ static void verify_queue_basic_block(jit_method_t* ctx, jit_basic_block_t* block
     }
 }
 
+/**
+ * Take the pending block that comes first in the IL. Without backward branches all the
+ * predecessors of a block come before it, so a block is only verified once its entry
+ * state is final, instead of being verified again whenever a later merge changes it
+ */
+static jit_basic_block_t* verify_next_basic_block(jit_method_t* ctx) {
+    int first = 0;
+    for (int i = 1; i < arrlen(ctx->block_queue); i++) {
+        if (ctx->block_queue[i]->start < ctx->block_queue[first]->start) {
+            first = i;
+        }
+    }
+
+    jit_basic_block_t* block = ctx->block_queue[first];
+    arrdelswap(ctx->block_queue, first);
+    return block;
+}
+
 static tdn_err_t verify_merge_basic_block(
     jit_method_t* method,
     uint32_t target_pc,
-    jit_stack_value_t* stack, jit_item_attrs_t* locals,
-    uint32_t* leave_target_stack) {
+    jit_stack_value_t* stack, jit_item_attrs_t* locals) {
     tdn_err_t err = TDN_NO_ERROR;
 
-    jit_basic_block_t* target = get_basic_block(method, target_pc, leave_target_stack);
+    jit_basic_block_t* target = get_basic_block(method, target_pc);
     CHECK(target != NULL);
 
     // if not initialized yet then initialize it now
     if (!target->initialized) {
         // copy locals state
-        arrsetlen(target->locals, arrlen(locals));
-        memcpy(target->locals, locals, sizeof(*locals) * arrlen(locals));
+        target->locals_count = arrlen(locals);
+        target->locals = jit_alloc(sizeof(*locals) * target->locals_count);
+        CHECK_ERROR(target->locals != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        memcpy(target->locals, locals, sizeof(*locals) * target->locals_count);
 
         // copy stack state
-        arrsetlen(target->stack, arrlen(stack));
-        memcpy(target->stack, stack, arrlen(stack) * sizeof(*target->stack));
+        target->stack_count = arrlen(stack);
+        target->stack = jit_alloc(sizeof(*stack) * target->stack_count);
+        CHECK_ERROR(target->stack != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        memcpy(target->stack, stack, sizeof(*stack) * target->stack_count);
 
         // queue it
         verify_queue_basic_block(method, target);
@@ -227,8 +349,8 @@ static tdn_err_t verify_merge_basic_block(
     } else {
 
         // make sure both have the same stack length
-        CHECK(arrlen(stack) == arrlen(target->stack),
-            "incoming %d, wanted %d", arrlen(stack), arrlen(target->stack));
+        CHECK(arrlen(stack) == target->stack_count,
+            "incoming %d, wanted %d", arrlen(stack), target->stack_count);
 
         // already initialized, make sure the state is consistent, if not
         // mark the target for another pass
@@ -266,6 +388,73 @@ cleanup:
     return err;
 }
 
+static tdn_err_t verify_add_continuation(jit_method_t* method, RuntimeExceptionHandlingClause clause, uint32_t target) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    jit_finally_t* finally = jit_get_finally(method, clause);
+    CHECK(finally != NULL);
+
+    // already known
+    for (int i = 0; i < arrlen(finally->continuations); i++) {
+        if (finally->continuations[i] == target) {
+            goto cleanup;
+        }
+    }
+
+    // new one, the blocks that end the handler need to go to it as well
+    arrpush(finally->continuations, target);
+    for (int i = 0; i < arrlen(finally->endfinally_blocks); i++) {
+        verify_queue_basic_block(method, finally->endfinally_blocks[i]);
+    }
+
+cleanup:
+    return err;
+}
+
+/**
+ * An exception raised at the pc goes to the handlers of the clauses whose try has the pc,
+ * from the inner most out. A catch only takes the exceptions of its type so the clauses
+ * around it are reached as well, a finally or fault always runs and continues to unwind
+ * from its own try once it is done
+ */
+static tdn_err_t verify_merge_exception_handlers(jit_method_t* method, uint32_t pc, int first, jit_item_attrs_t* locals) {
+    tdn_err_t err = TDN_NO_ERROR;
+    jit_stack_value_t* stack = NULL;
+
+    RuntimeExceptionHandlingClause_Array clauses = method->method->MethodBody->ExceptionHandlingClauses;
+    for (int i = first; clauses != NULL && i < clauses->Length; i++) {
+        RuntimeExceptionHandlingClause clause = clauses->Elements[i];
+        if (pc < clause->TryOffset || clause->TryOffset + clause->TryLength <= pc) {
+            continue;
+        }
+
+        if (clause->Flags == COR_ILEXCEPTION_CLAUSE_EXCEPTION) {
+            // the handler starts with the exception on the stack
+            arrsetlen(stack, 0);
+            arrpush(stack, (jit_stack_value_t){ .type = clause->CatchType });
+            CHECK_AND_RETHROW(verify_merge_basic_block(method, clause->HandlerOffset, stack, locals));
+        } else {
+            // the blocks that end the handler need to unwind as well
+            jit_finally_t* finally = &method->finallies[i];
+            if (!finally->unwinds) {
+                finally->unwinds = true;
+                for (int j = 0; j < arrlen(finally->endfinally_blocks); j++) {
+                    verify_queue_basic_block(method, finally->endfinally_blocks[j]);
+                }
+            }
+
+            arrsetlen(stack, 0);
+            CHECK_AND_RETHROW(verify_merge_basic_block(method, clause->HandlerOffset, stack, locals));
+            break;
+        }
+    }
+
+cleanup:
+    arrfree(stack);
+
+    return err;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Perform verification on a single basic block
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -371,8 +560,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
 
     if (block->initialized) {
         // copy the initial stack
-        arrsetlen(stack, arrlen(block->stack));
-        memcpy(stack, block->stack, arrlen(block->stack) * sizeof(*block->stack));
+        arrsetlen(stack, block->stack_count);
+        memcpy(stack, block->stack, block->stack_count * sizeof(*block->stack));
 
     } else {
         //
@@ -382,8 +571,10 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
 
         // set initial local state
         if (body->LocalVariables != NULL) {
-            arrsetlen(block->locals, body->LocalVariables->Length);
-            for (int i = 0; i < arrlen(block->locals); i++) {
+            block->locals_count = body->LocalVariables->Length;
+            block->locals = jit_alloc(sizeof(*block->locals) * block->locals_count);
+            CHECK_ERROR(block->locals != NULL, TDN_ERROR_OUT_OF_MEMORY);
+            for (int i = 0; i < block->locals_count; i++) {
                 RuntimeTypeInfo type = jmethod->locals[i].type;
 
                 // we need to initialize locals to be non-local since they start with
@@ -398,8 +589,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
     block->initialized = true;
 
     // copy the locals state
-    arrsetlen(locals, arrlen(block->locals));
-    memcpy(locals, block->locals, sizeof(*locals) * arrlen(locals));
+    arrsetlen(locals, block->locals_count);
+    memcpy(locals, block->locals, sizeof(*locals) * block->locals_count);
 
 #ifdef JIT_VERBOSE_VERIFY
     int indent = 0;
@@ -412,6 +603,7 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
 
     // get the pc
     tdn_il_inst_t inst = { .control_flow = TDN_IL_CF_FIRST };
+    uint32_t inst_index = block->first_inst;
     uint32_t pc = block->start;
     while (pc < block->end) {
         // can only parse more instructions if we had no block
@@ -427,7 +619,7 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
         last_opcode = inst.opcode;
 
         // get the instruction
-        CHECK_AND_RETHROW(tdn_disasm_inst(method, pc, &inst));
+        inst = jmethod->insts[inst_index++];
 
 #ifdef JIT_VERBOSE_VERIFY
         indent = tdn_disasm_print_start(body, pc, inst, indent);
@@ -790,6 +982,11 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 EVAL_STACK_PUSH(tInt64);
             } break;
 
+            case CEE_LDC_R4:
+            case CEE_LDC_R8: {
+                EVAL_STACK_PUSH(tDouble);
+            } break;
+
             case CEE_LDNULL: {
                 EVAL_STACK_PUSH(NULL);
             } break;
@@ -935,9 +1132,11 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                     // push the target this type
                     // NOTE: for value types we don't actually push a byref so
                     //       take the declaring type directly
-                    jit_item_attrs_t attrs = {
-                        .known_type = target->DeclaringType,
-                    };
+                    // shared code doesn't know the exact type it created
+                    jit_item_attrs_t attrs = {};
+                    if (jit_dictionary_find(jmethod->dictionary, JIT_DICTIONARY_NEW_TYPE, inst.operand_token) < 0) {
+                        attrs.known_type = target->DeclaringType;
+                    }
 
                     // the rules for newobj is very similar, if we are creating
                     // a by-ref struct with a local reference we won't mark
@@ -984,6 +1183,9 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                         EVAL_STACK_PUSH(ret_type, attrs);
                     }
                 }
+
+                // the callee might leave an exception for us
+                CHECK_AND_RETHROW(verify_merge_exception_handlers(jmethod, current_pc, 0, locals));
             } break;
 
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1101,6 +1303,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
             case CEE_LDIND_U1:
             case CEE_LDIND_U2:
             case CEE_LDIND_U4:
+            case CEE_LDIND_R4:
+            case CEE_LDIND_R8:
             case CEE_LDIND_I:
             case CEE_LDIND_REF:
             case CEE_LDOBJ: {
@@ -1126,6 +1330,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
             case CEE_STIND_I2:
             case CEE_STIND_I4:
             case CEE_STIND_I8:
+            case CEE_STIND_R4:
+            case CEE_STIND_R8:
             case CEE_STIND_I:
             case CEE_STIND_REF:
             case CEE_STOBJ: {
@@ -1196,6 +1402,18 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                     CHECK(value2.type == tInt64);
                     result = tInt64;
 
+                } else if (value1.type == tDouble) {
+                    // only the plain arithmetic is valid on F
+                    CHECK(value2.type == tDouble);
+                    CHECK(
+                        inst.opcode == CEE_ADD ||
+                        inst.opcode == CEE_SUB ||
+                        inst.opcode == CEE_MUL ||
+                        inst.opcode == CEE_DIV ||
+                        inst.opcode == CEE_REM
+                    );
+                    result = tDouble;
+
                 } else {
                     CHECK_FAIL();
                 }
@@ -1229,7 +1447,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK(
                     value.type == tInt32 ||
                     value.type == tInt64 ||
-                    value.type == tIntPtr
+                    value.type == tIntPtr ||
+                    (value.type == tDouble && inst.opcode == CEE_NEG)
                 );
                 EVAL_STACK_PUSH(value.type);
             } break;
@@ -1251,7 +1470,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK(
                     value.type == tInt32 ||
                     value.type == tInt64 ||
-                    value.type == tIntPtr
+                    value.type == tIntPtr ||
+                    value.type == tDouble
                 );
                 EVAL_STACK_PUSH(tIntPtr);
             } break;
@@ -1262,7 +1482,8 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK(
                     value.type == tInt32 ||
                     value.type == tInt64 ||
-                    value.type == tIntPtr
+                    value.type == tIntPtr ||
+                    value.type == tDouble
                 );
                 EVAL_STACK_PUSH(tInt64);
             } break;
@@ -1277,11 +1498,34 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK(
                     value.type == tInt32 ||
                     value.type == tInt64 ||
-                    value.type == tIntPtr
+                    value.type == tIntPtr ||
+                    value.type == tDouble
                 );
                 EVAL_STACK_PUSH(tInt32);
             } break;
 
+            case CEE_CONV_R4:
+            case CEE_CONV_R8: {
+                jit_stack_value_t value = EVAL_STACK_POP();
+                CHECK(
+                    value.type == tInt32 ||
+                    value.type == tInt64 ||
+                    value.type == tIntPtr ||
+                    value.type == tDouble
+                );
+                EVAL_STACK_PUSH(tDouble);
+            } break;
+
+            case CEE_CONV_R_UN: {
+                jit_stack_value_t value = EVAL_STACK_POP();
+                CHECK(
+                    value.type == tInt32 ||
+                    value.type == tInt64 ||
+                    value.type == tIntPtr
+                );
+                EVAL_STACK_PUSH(tDouble);
+            } break;
+
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
             // Branching
             ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1303,14 +1547,12 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK_AND_RETHROW(verify_merge_basic_block(
                     jmethod,
                     inst.operand.branch_target,
-                    stack, locals,
-                    copy_leave_targets(block->leave_target_stack)));
+                    stack, locals));
 
                 CHECK_AND_RETHROW(verify_merge_basic_block(
                     jmethod,
                     pc,
-                    stack, locals,
-                    copy_leave_targets(block->leave_target_stack)));
+                    stack, locals));
             } break;
 
             case CEE_BRTRUE:
@@ -1326,22 +1568,39 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 CHECK_AND_RETHROW(verify_merge_basic_block(
                     jmethod,
                     inst.operand.branch_target,
-                    stack, locals,
-                    copy_leave_targets(block->leave_target_stack)));
+                    stack, locals));
+
+                CHECK_AND_RETHROW(verify_merge_basic_block(
+                    jmethod,
+                    pc,
+                    stack, locals));
+            } break;
+
+            case CEE_SWITCH: {
+                jit_stack_value_t value = EVAL_STACK_POP();
+                CHECK(
+                    value.type == tInt32 ||
+                    value.type == tIntPtr
+                );
+
+                for (uint32_t i = 0; i < inst.operand.switch_table.count; i++) {
+                    CHECK_AND_RETHROW(verify_merge_basic_block(
+                        jmethod,
+                        tdn_get_switch_target(&inst, i),
+                        stack, locals));
+                }
 
                 CHECK_AND_RETHROW(verify_merge_basic_block(
                     jmethod,
                     pc,
-                    stack, locals,
-                    copy_leave_targets(block->leave_target_stack)));
+                    stack, locals));
             } break;
 
             case CEE_BR: {
                 CHECK_AND_RETHROW(verify_merge_basic_block(
                     jmethod,
                     inst.operand.branch_target,
-                    stack, locals,
-                    copy_leave_targets(block->leave_target_stack)));
+                    stack, locals));
             } break;
 
             case CEE_RET: {
@@ -1397,8 +1656,11 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
 
                 CHECK_AND_RETHROW(jit_queue_type(inst.operand.type));
 
-                // track it as an object
-                EVAL_STACK_PUSH(tObject, { .known_type = inst.operand.type });
+                // track it as an object, a boxed reference can be
+                // of any type deriving from the operand
+                EVAL_STACK_PUSH(tObject, {
+                    .known_type = tdn_type_is_valuetype(inst.operand.type) ? inst.operand.type : NULL
+                });
             } break;
 
             case CEE_UNBOX_ANY: {
@@ -1435,6 +1697,20 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 // TODO: check instanceof System.Exception
                 CHECK(tdn_type_is_referencetype(obj.type));
 
+                // go to the handlers that might catch it
+                CHECK_AND_RETHROW(verify_merge_exception_handlers(jmethod, current_pc, 0, locals));
+
+                // and clear the stack
+                arrsetlen(stack, 0);
+            } break;
+
+            case CEE_RETHROW: {
+                // must be inside of a catch handler
+                CHECK(jit_get_enclosing_handler_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_EXCEPTION) != NULL);
+
+                // go to the handlers that might catch it
+                CHECK_AND_RETHROW(verify_merge_exception_handlers(jmethod, current_pc, 0, locals));
+
                 // and clear the stack
                 arrsetlen(stack, 0);
             } break;
@@ -1447,67 +1723,61 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
                 //       weird stuff, I don't think this matters from memory safety
                 //       point so its not that important
 
-                uint32_t* target_stack = copy_leave_targets(block->leave_target_stack);
-
-                // check if there is any finally around us
-                RuntimeExceptionHandlingClause clause = jit_get_enclosing_try_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_FINALLY, NULL);
-                if (clause != NULL) {
-                    // we do, merge with it, we need to go to the clause
-                    // and have it's leave target be our branch target
-                    arrpush(target_stack, inst.operand.branch_target);
-                    CHECK_AND_RETHROW(verify_merge_basic_block(
-                        jmethod,
-                        clause->HandlerOffset,
-                        stack, locals,
-                        target_stack));
-                } else {
-                    // we don't have any finally handlers, we can call the
-                    // target directly, we use the same leave targets that
-                    // we have right now
-                    CHECK_AND_RETHROW(verify_merge_basic_block(
-                        jmethod,
-                        inst.operand.branch_target,
-                        stack, locals,
-                        target_stack));
+                // get all the finally handlers we need to run on the way out, each
+                // one continues to the next one and the last one to our target
+                uint32_t target = inst.operand.branch_target;
+                RuntimeExceptionHandlingClause* chain;
+                int chain_count;
+                CHECK_AND_RETHROW(jit_get_leave_finallies(jmethod, current_pc, target, &chain, &chain_count));
+                for (int i = 0; i < chain_count; i++) {
+                    uint32_t next = i + 1 < chain_count ? chain[i + 1]->HandlerOffset : target;
+                    CHECK_AND_RETHROW(verify_add_continuation(jmethod, chain[i], next));
                 }
+
+                // and go to the first handler, or the target directly if there are none
+                CHECK_AND_RETHROW(verify_merge_basic_block(
+                    jmethod,
+                    chain_count > 0 ? chain[0]->HandlerOffset : target,
+                    stack, locals));
             } break;
 
             case CEE_ENDFINALLY: {
                 // empty the stack
                 arrsetlen(stack, 0);
 
-                // TODO: verify the endfinally is actually inside a finally handler
+                // must be inside of a finally or fault handler
+                RuntimeExceptionHandlingClause handler = jit_get_enclosing_finally_clause(jmethod, current_pc);
+                CHECK(handler != NULL);
 
-                // we need a target to exit to
-                CHECK(block->leave_target_stack != NULL);
+                // we can go to all the places the handler can continue to, remember
+                // the block so it will be verified again if we find more continuations
+                jit_finally_t* finally = jit_get_finally(jmethod, handler);
+                CHECK(finally != NULL);
 
-                uint32_t* leave_targets = copy_leave_targets(block->leave_target_stack);
+                bool found = false;
+                for (int i = 0; i < arrlen(finally->endfinally_blocks); i++) {
+                    if (finally->endfinally_blocks[i] == block) {
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    arrpush(finally->endfinally_blocks, block);
+                }
 
-                // check if there is any finally around us
-                RuntimeExceptionHandlingClause clause = jit_get_enclosing_try_clause(jmethod, current_pc, COR_ILEXCEPTION_CLAUSE_FINALLY, NULL);
-                if (clause != NULL) {
-                    // we do, merge with it, we need to go to the clause
-                    // the leave target will actually stay the same for
-                    // this case
+                for (int i = 0; i < arrlen(finally->continuations); i++) {
                     CHECK_AND_RETHROW(verify_merge_basic_block(
                         jmethod,
-                        clause->HandlerOffset,
-                        stack, locals,
-                        leave_targets));
-
-                } else {
-                    // we don't have any finally handlers, we can call the
-                    // target directly, we remove the current leave target
-                    // from the stack and use the rest
-
-                    uint32_t leave_target = arrpop(leave_targets);
-                    if (arrlen(leave_targets) == 0) arrfree(leave_targets);
+                        finally->continuations[i],
+                        stack, locals));
+                }
 
-                    CHECK_AND_RETHROW(verify_merge_basic_block(
-                        jmethod,
-                        leave_target,
-                        stack, locals,
-                        leave_targets));
+                // if the handler ran for an exception then keep unwinding
+                // from its try, to the clauses around it
+                if (finally->unwinds) {
+                    CHECK_AND_RETHROW(verify_merge_exception_handlers(jmethod,
+                        handler->TryOffset, jit_get_clause_index(jmethod, handler) + 1,
+                        locals));
                 }
             } break;
 
@@ -1544,8 +1814,7 @@ static tdn_err_t verify_basic_block(jit_method_t* jmethod, jit_basic_block_t* bl
         CHECK_AND_RETHROW(verify_merge_basic_block(
             jmethod,
             pc,
-            stack, locals,
-            copy_leave_targets(block->leave_target_stack)));
+            stack, locals));
     }
 
     // last must be a valid instruction
@@ -1569,6 +1838,34 @@ static tdn_err_t prepare_method(jit_method_t* jmethod) {
     // start by finding all the basic blocks so we can verify the method
     CHECK_AND_RETHROW(jit_find_basic_blocks(jmethod));
 
+    // the state of the finally handlers
+    if (body->ExceptionHandlingClauses != NULL) {
+        jmethod->finallies = jit_alloc(sizeof(jit_finally_t) * body->ExceptionHandlingClauses->Length);
+        CHECK_ERROR(jmethod->finallies != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+        // the catches check the type of the exception against theirs
+        for (int i = 0; i < body->ExceptionHandlingClauses->Length; i++) {
+            RuntimeExceptionHandlingClause clause = body->ExceptionHandlingClauses->Elements[i];
+            if (clause->CatchType != NULL) {
+                CHECK_AND_RETHROW(tdn_type_init(clause->CatchType));
+            }
+        }
+    }
+
+    // types are only filled on first use, so make sure
+    // everything the method touches is ready
+    CHECK_AND_RETHROW(tdn_type_init(method->DeclaringType));
+
+    // the method might be the first thing of its type to run, no matter how it
+    // is reached (a call, ldftn, a base ctor or the host), so have the cctor ready,
+    // beforefieldinit types are queued by their static accesses instead
+    if (jit_method_checks_init_on_entry(method)) {
+        CHECK_AND_RETHROW(jit_queue_cctor(method->DeclaringType));
+    }
+
+    // shared code takes the exact type arguments from the dictionary
+    CHECK_AND_RETHROW(jit_get_method_dictionary(method, &jmethod->dictionary));
+
     // if we have a this add it to the local
     if (!method->Attributes.Static) {
         RuntimeTypeInfo this_type = method->DeclaringType;
@@ -1578,9 +1875,13 @@ static tdn_err_t prepare_method(jit_method_t* jmethod) {
         arrpush(jmethod->args, (jit_arg_t){ .type = this_type });
     }
 
+    // the return type as well, the caller and return path need its layout
+    CHECK_AND_RETHROW(tdn_type_init(method->ReturnParameter->ParameterType));
+
     // now prepare the rest of the arguments
     for (int i = 0; i < method->Parameters->Length; i++) {
         ParameterInfo info = method->Parameters->Elements[i];
+        CHECK_AND_RETHROW(tdn_type_init(info->ParameterType));
         arrpush(jmethod->args, (jit_arg_t){ .type = info->ParameterType });
     }
 
@@ -1588,6 +1889,7 @@ static tdn_err_t prepare_method(jit_method_t* jmethod) {
     if (body->LocalVariables != NULL) {
         for (int i = 0; i < body->LocalVariables->Length; i++) {
             RuntimeLocalVariableInfo info = body->LocalVariables->Elements[i];
+            CHECK_AND_RETHROW(tdn_type_init(info->LocalType));
             arrpush(jmethod->locals, (jit_local_t){ .type = info->LocalType });
         }
     }
@@ -1609,7 +1911,7 @@ static tdn_err_t verify_method(jit_method_t* method) {
     verify_queue_basic_block(method, method->basic_blocks[0]);
 
     while (arrlen(method->block_queue) > 0) {
-        jit_basic_block_t* block = arrpop(method->block_queue);
+        jit_basic_block_t* block = verify_next_basic_block(method);
 
 #ifdef JIT_VERBOSE_VERIFY
         TRACE("\tBlock (IL_%04x)", block->start);
@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <stdatomic.h>
 #include "loader.h"
 
 #include <tomatodotnet/tdn.h>
@@ -16,8 +17,10 @@
 #include <tomatodotnet/types/type.h>
 #include <util/alloc.h>
 #include <util/prime.h>
+#include <util/parallel.h>
 
 #include "jit/jit.h"
+#include "atom.h"
 
 typedef struct memory_file_handle {
      void* buffer;
@@ -60,6 +63,9 @@ typedef struct load_type {
     const char* name;
     RuntimeTypeInfo* dest;
     size_t vtable_size;
+
+    // the corelib is allowed to not have this type
+    bool optional;
 } load_type_t;
 
 #define INIT_VALUE_TYPE(namespace, name, is_unmanaged) \
@@ -104,6 +110,8 @@ static init_type_t m_init_types[] = {
     INIT_VALUE_TYPE(System, UInt32, true),
     INIT_VALUE_TYPE(System, UInt64, true),
     INIT_VALUE_TYPE(System, UIntPtr, true),
+    INIT_VALUE_TYPE(System, Single, true),
+    INIT_VALUE_TYPE(System, Double, true),
     INIT_VALUE_TYPE(System, Void, true),
 };
 static int m_inited_types = 0;
@@ -156,8 +164,13 @@ static load_type_t m_load_types[] = {
     LOAD_TYPE(System.Diagnostics, Debug),
     LOAD_TYPE(System.Numerics, BitOperations),
     { "System", "Nullable`1", &tNullable, 4 },
+    { "System", "SpanHelpers", &tSpanHelpers, 4, true },
+    { "System", "Math", &tMath, 4, true },
+    { "System.Runtime.Intrinsics", "Vector128", &tVector128, 4, true },
+    { "System.Runtime.Intrinsics", "Vector256", &tVector256, 4, true },
+    { "System.Runtime.Intrinsics", "Vector128`1", &tVector128Generic, 4, true },
+    { "System.Runtime.Intrinsics", "Vector256`1", &tVector256Generic, 4, true },
 };
-static int m_loaded_types = 0;
 
 /**
  * Contains the Core assembly, where the most basic types are stored
@@ -230,7 +243,6 @@ static tdn_err_t corelib_create_type(metadata_type_def_t* type_def, RuntimeTypeI
             type->QueuedTypeInit = 1;
             *load_type->dest = type;
             *out_type = type;
-            m_loaded_types++;
             goto cleanup;
         }
     }
@@ -319,6 +331,21 @@ cleanup:
     return err;
 }
 
+/**
+ * Returns the size of the register the type represents, or zero
+ * if this is not a hardware vector type
+ */
+static size_t get_hardware_vector_size(RuntimeTypeInfo type) {
+    RuntimeTypeInfo definition = type->GenericTypeDefinition;
+    if (definition == NULL) {
+        return 0;
+    }
+
+    if (definition == tVector128Generic) return 16;
+    if (definition == tVector256Generic) return 32;
+    return 0;
+}
+
 /**
  * Fills the heap size of the object, should be called when creating the type
  * or this is a base type of another heap size calculation
@@ -469,6 +496,15 @@ static tdn_err_t fill_heap_size(RuntimeTypeInfo type) {
         // have the alignment that we want it to have
         current_size = ALIGN_UP(current_size, alignment);
 
+        // the hardware vectors have the exact size of their register, we align
+        // them to 16 bytes since that is the most the heap guarantees
+        size_t vector_size = get_hardware_vector_size(type);
+        if (vector_size != 0) {
+            CHECK(current_size <= vector_size);
+            current_size = vector_size;
+            alignment = 16;
+        }
+
         // there are size limits, valuetype must be less
         // than 1mb (per spec) and other types must be
         // less than 2GB (GC limit)
@@ -514,8 +550,8 @@ static RuntimeMethodInfo find_overriden_method(RuntimeTypeInfo type, RuntimeMeth
             if (!info->Attributes.Virtual)
                 continue;
 
-            // match the name
-            if (!tdn_compare_string(info->Name, method->Name))
+            // match the name, both are atoms so comparing the pointers is enough
+            if (info->Name != method->Name)
                 continue;
 
             // check the return type
@@ -550,6 +586,8 @@ static RuntimeMethodInfo find_overriden_method(RuntimeTypeInfo type, RuntimeMeth
     return NULL;
 }
 
+static tdn_err_t fill_interface_type_id(RuntimeTypeInfo info);
+
 static tdn_err_t fill_virtual_methods(RuntimeTypeInfo info) {
     tdn_err_t err = TDN_NO_ERROR;
 
@@ -574,13 +612,13 @@ static tdn_err_t fill_virtual_methods(RuntimeTypeInfo info) {
     // the current offset of the vtable
     int vtable_offset = info->BaseType ? (info->BaseType->VTable ? info->BaseType->VTable->Length : 0) : 0;
 
-    // ignore anything not of this type
+    // only go over the impls of this type
     uint64_t interface_product = 1;
-    for (int i = 0; i < metadata->interface_impls_count; i++) {
-        metadata_interface_impl_t* impl = &metadata->interface_impls[i];
-        if (impl->class.token != info->MetadataToken) {
-            continue;
-        }
+    uint32_t impls_count = 0;
+    metadata_interface_impl_t* impls = metadata_find_interface_impls(metadata,
+        (token_t){ .token = info->MetadataToken }, &impls_count);
+    for (int i = 0; i < impls_count; i++) {
+        metadata_interface_impl_t* impl = &impls[i];
 
         // get the interface type
         RuntimeTypeInfo interface;
@@ -608,7 +646,9 @@ static tdn_err_t fill_virtual_methods(RuntimeTypeInfo info) {
         // and now insert it
         hmput(info->InterfaceImpls, interface, parent_offset);
 
-        // calculate the product and make sure it doesn't overflow
+        // calculate the product and make sure it doesn't overflow, the
+        // interface might not have been filled yet so give it its id now
+        CHECK_AND_RETHROW(fill_interface_type_id(interface));
         CHECK(!__builtin_mul_overflow(interface_product, interface->InterfacePrime, &interface_product));
     }
 
@@ -797,6 +837,7 @@ typedef struct coril_exception_clause_fat {
 
 static tdn_err_t tdn_parse_method_exception_handling_clauses(
     RuntimeMethodBase method_base,
+    RuntimeMethodBody body,
     bool fat, void* data, size_t size,
     size_t code_size
 ) {
@@ -806,7 +847,7 @@ static tdn_err_t tdn_parse_method_exception_handling_clauses(
     size_t count = size / (fat ? sizeof(coril_exception_clause_fat_t) : sizeof(coril_exception_clause_small_t));
 
     RuntimeExceptionHandlingClause_Array clauses = GC_NEW_ARRAY(RuntimeExceptionHandlingClause, count);
-    method_base->MethodBody->ExceptionHandlingClauses = clauses;
+    body->ExceptionHandlingClauses = clauses;
 
     // iterate all the clauses
     size_t i = 0;
@@ -893,13 +934,14 @@ tdn_err_t tdn_parser_method_body(
 ) {
     tdn_err_t err = TDN_NO_ERROR;
 
+    // the body is only published once it is complete, reflection
+    // might look at it from another thread at the same time
     RuntimeMethodBody body = GC_NEW(RuntimeMethodBody);
-    methodBase->MethodBody = body;
 
     // get the tiny header for the start
-    uint8_t* start = pe_image_address(&assembly->Metadata->file, method_def->rva);
-    uint8_t* end = pe_image_address(&assembly->Metadata->file, method_def->rva + 1);
-    CHECK(start != NULL && end != NULL);
+    pe_file_t* file = &assembly->Metadata->file;
+    uint8_t* start = pe_image_range(file, method_def->rva, 1);
+    CHECK(start != NULL);
 
     // parse the header
     size_t code_size = 0;
@@ -914,9 +956,8 @@ tdn_err_t tdn_parser_method_body(
         body->InitLocals = true;
 
     } else if (flags == CorILMethod_FatFormat) {
-        // this is a big header, recalculate the end
-        end = pe_image_address(&assembly->Metadata->file, method_def->rva + sizeof(coril_method_fat_t));
-        CHECK(end != NULL);
+        // this is a big header, make sure all of it is there
+        CHECK(pe_image_range(file, method_def->rva, sizeof(coril_method_fat_t)) != NULL);
 
         // take the new header size and check it
         coril_method_fat_t* fat = (coril_method_fat_t*)start;
@@ -935,8 +976,8 @@ tdn_err_t tdn_parser_method_body(
         if (fat->local_var_sig_tok != 0) {
             token_t token = { .token = body->LocalSignatureMetadataToken };
             CHECK(token.table == METADATA_STAND_ALONE_SIG);
-            CHECK(token.index != 0 && token.index <= assembly->Metadata->stand_alone_sigs_count);
-            metadata_stand_alone_sig_t* sig = &assembly->Metadata->stand_alone_sigs[token.index - 1];
+            metadata_stand_alone_sig_t* sig;
+            CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_STAND_ALONE_SIG, token.index, (void**)&sig));
             CHECK_AND_RETHROW(sig_parse_local_var_sig(
                     sig->signature,
                     assembly,
@@ -950,9 +991,8 @@ tdn_err_t tdn_parser_method_body(
     }
 
     // now we have the code itself
-    uint8_t* code_start = end;
-    uint8_t* code_end = pe_image_address(&assembly->Metadata->file, method_def->rva + header_size + code_size);
-    CHECK(code_end != NULL);
+    uint8_t* code_start = pe_image_range(file, method_def->rva + header_size, code_size);
+    CHECK(code_start != NULL);
     CHECK(code_size <= INT32_MAX);
 
     // set the code
@@ -963,9 +1003,8 @@ tdn_err_t tdn_parser_method_body(
     if (flags & CorILMethod_MoreSects) {
         // make sure we can access the header
         uint32_t data_offset = method_def->rva + header_size + ALIGN_UP(code_size, sizeof(uint32_t));
-        uint8_t* sect_start = pe_image_address(&assembly->Metadata->file, data_offset);
+        uint8_t* sect_start = pe_image_range(file, data_offset, sizeof(uint32_t));
         CHECK(sect_start != NULL);
-        CHECK(pe_image_address(&assembly->Metadata->file, data_offset + sizeof(uint32_t)) != NULL);
 
         // take one byte, we are going to make sure this is exception handling table
         // and that there are no more sections after it
@@ -984,15 +1023,110 @@ tdn_err_t tdn_parser_method_body(
         }
 
         // check the size beyond the header
-        CHECK(pe_image_address(&assembly->Metadata->file, data_offset + size) != NULL);
-        end += sizeof(uint32_t);
+        CHECK(size >= sizeof(uint32_t));
+        CHECK(pe_image_range(file, data_offset, size) != NULL);
 
         // handle the extra data correctly
         CHECK_AND_RETHROW(tdn_parse_method_exception_handling_clauses(
-                methodBase, kind & CorILMethod_Sect_FatFormat,
+                methodBase, body, kind & CorILMethod_Sect_FatFormat,
                 sect_start + sizeof(uint32_t), size - sizeof(uint32_t), code_size));
     }
 
+    // someone might have parsed it in the meanwhile, in
+    // which case we let the GC clean ours and use theirs
+    RuntimeMethodBody result = NULL;
+    atomic_compare_exchange_strong(&methodBase->MethodBody, &result, body);
+
+cleanup:
+    return err;
+}
+
+tdn_err_t tdn_method_load_body(RuntimeMethodBase method) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // already parsed
+    if (method->MethodBody != NULL) {
+        goto cleanup;
+    }
+
+    // only method defs can have a body, this is also true for
+    // generic instances which keep the token of their definition
+    token_t token = { .token = method->MetadataToken };
+    if (token.table != METADATA_METHOD_DEF) {
+        goto cleanup;
+    }
+
+    RuntimeAssembly assembly = method->Module->Assembly;
+    CHECK(token.index != 0 && token.index <= assembly->Metadata->method_defs_count);
+    metadata_method_def_t* method_def = &assembly->Metadata->method_defs[token.index - 1];
+    if (method_def->rva == 0) {
+        goto cleanup;
+    }
+
+    CHECK_AND_RETHROW(tdn_parser_method_body(assembly, method_def, method));
+
+cleanup:
+    return err;
+}
+
+tdn_err_t tdn_get_method_body(RuntimeMethodBase method, RuntimeMethodBody* body) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK_AND_RETHROW(tdn_method_load_body(method));
+    *body = method->MethodBody;
+
+cleanup:
+    return err;
+}
+
+tdn_err_t tdn_get_parameter_name(ParameterInfo parameter, String* out_name) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // already created, or a parameter that is not of a method definition
+    String name = atomic_load_explicit(&parameter->Name, memory_order_acquire);
+    if (name != NULL || parameter->Member == NULL) {
+        *out_name = name;
+        goto cleanup;
+    }
+
+    RuntimeMethodBase method = (RuntimeMethodBase)parameter->Member;
+    dotnet_file_t* metadata = method->Module->Assembly->Metadata;
+    token_t token = { .token = method->MetadataToken };
+    CHECK(token.table == METADATA_METHOD_DEF);
+    CHECK(token.index != 0 && token.index <= metadata->method_defs_count);
+
+    // the params of the method are all the rows up to the params of the next one,
+    // the sequence is the position of the parameter, with 0 being the return value
+    metadata_method_def_t* method_def = &metadata->method_defs[token.index - 1];
+    uint32_t end = token.index == metadata->method_defs_count ?
+                        metadata->params_count + 1 :
+                        method_def[1].param_list.index;
+    const char* cstr = NULL;
+    for (uint32_t index = method_def->param_list.index; index != 0 && index < end; index++) {
+        metadata_param_t* param;
+        CHECK_AND_RETHROW(metadata_get_row_ref(metadata, METADATA_PARAM, index, (void**)&param));
+        if (param->sequence == parameter->Position + 1) {
+            cstr = param->name;
+            break;
+        }
+    }
+
+    // parameters without a row or with an empty name have no name
+    if (cstr == NULL || cstr[0] == '\0') {
+        *out_name = NULL;
+        goto cleanup;
+    }
+
+    // someone else might have created it in the meanwhile, in which
+    // case use theirs, the one we created is collected by the gc
+    CHECK_AND_RETHROW(tdn_create_string_from_cstr(cstr, &name));
+    String expected = NULL;
+    if (!atomic_compare_exchange_strong(&parameter->Name, &expected, name)) {
+        name = expected;
+    }
+
+    *out_name = name;
+
 cleanup:
     return err;
 }
@@ -1048,7 +1182,9 @@ cleanup:
 static tdn_err_t fill_interface_type_id(RuntimeTypeInfo info) {
     tdn_err_t err = TDN_NO_ERROR;
 
-    if (info->Attributes.Interface) {
+    // the interface is given its id once, either when it is filled
+    // or when a type that implements it is filled first
+    if (info->Attributes.Interface && info->InterfacePrime == 0) {
         // interface uses prime multipliers to check for inclusion
         info->InterfacePrime = prime_generate(&m_interface_prime_generator);
         info->InterfaceId = m_interface_id++;
@@ -1099,12 +1235,55 @@ cleanup:
     return err;
 }
 
+/**
+ * Give all the static fields of the type an offset inside of the static block
+ * of the type, the block itself is only allocated once a static is first used
+ */
+static tdn_err_t fill_static_layout(RuntimeTypeInfo type) {
+    tdn_err_t err = TDN_NO_ERROR;
+    size_t current_size = 0;
+
+    // first all the plain references
+    for (int i = 0; i < type->DeclaredFields->Length; i++) {
+        RuntimeFieldInfo field = type->DeclaredFields->Elements[i];
+        if (!field->Attributes.Static || field->Attributes.Literal) {
+            continue;
+        }
+
+        // static fields may never have a by-ref or ref-structs
+        CHECK(!field->FieldType->IsByRef);
+        CHECK(!field->FieldType->IsByRefStruct);
+
+        CHECK_AND_RETHROW(fill_stack_size(field->FieldType));
+        if (tdn_is_static_reference_field(field)) {
+            field->FieldOffset = current_size;
+            current_size += sizeof(void*);
+        }
+    }
+
+    // and now everything else
+    for (int i = 0; i < type->DeclaredFields->Length; i++) {
+        RuntimeFieldInfo field = type->DeclaredFields->Elements[i];
+        if (!field->Attributes.Static || field->Attributes.Literal || tdn_is_static_reference_field(field)) {
+            continue;
+        }
+
+        current_size = ALIGN_UP(current_size, field->FieldType->StackAlignment);
+        field->FieldOffset = current_size;
+        current_size += field->FieldType->StackSize;
+    }
+
+cleanup:
+    return err;
+}
+
 static tdn_err_t fill_type(RuntimeTypeInfo type) {
     tdn_err_t err = TDN_NO_ERROR;
 
     CHECK_AND_RETHROW(check_generic_constraints(type));
     CHECK_AND_RETHROW(fill_stack_size(type));
     CHECK_AND_RETHROW(fill_heap_size(type));
+    CHECK_AND_RETHROW(fill_static_layout(type));
     CHECK_AND_RETHROW(fill_interface_type_id(type));
     CHECK_AND_RETHROW(fill_virtual_methods(type));
     CHECK_AND_RETHROW(fill_object_type_id(type));
@@ -1113,44 +1292,46 @@ cleanup:
     return err;
 }
 
-tdn_err_t tdn_type_init(RuntimeTypeInfo type) {
-    tdn_err_t err = TDN_NO_ERROR;
-
-    if (type->TypeInitStarted) {
-        goto cleanup;
-    }
-
-    if (arrlen(m_type_queues) == 0) {
-        fill_type(type);
-    } else {
-        arrpush(arrlast(m_type_queues).types, type);
+/**
+ * Forget the types that are still queued, they were never
+ * touched so they can be filled again on their next use
+ */
+static void discard_type_queue(type_queue_t* queue) {
+    for (int i = 0; i < arrlen(queue->types); i++) {
+        queue->types[i]->TypeInitStarted = false;
     }
-
-    // it is considered
-    type->TypeInitStarted = true;
-
-cleanup:
-    return err;
+    arrfree(queue->types);
 }
 
+/**
+ * Fill all the types of the top queue, types that are reached while
+ * filling are added to the same queue instead of being filled right away,
+ * so nobody sees a type in the middle of being filled
+ */
 static tdn_err_t drain_type_queue() {
     tdn_err_t err = TDN_NO_ERROR;
     type_queue_t queue = {0};
 
     CHECK(arrlen(m_type_queues) > 0);
-    queue = arrpop(m_type_queues);
 
-    // and init them all
-    while (arrlen(queue.types) != 0) {
-        RuntimeTypeInfo type = arrpop(queue.types);
-        fill_type(type);
+    while (arrlen(arrlast(m_type_queues).types) != 0) {
+        RuntimeTypeInfo type = arrpop(arrlast(m_type_queues).types);
+        err = fill_type(type);
+        if (IS_ERROR(err)) {
+            // a partially filled type can't be filled again
+            type->TypeInitFailed = true;
+            CHECK_AND_RETHROW(err);
+        }
     }
 
 cleanup:
-    arrfree(queue.types);
+    if (arrlen(m_type_queues) > 0) {
+        queue = arrpop(m_type_queues);
+        discard_type_queue(&queue);
 
-    if (arrlen(m_type_queues) == 0) {
-        arrfree(m_type_queues);
+        if (arrlen(m_type_queues) == 0) {
+            arrfree(m_type_queues);
+        }
     }
 
     return err;
@@ -1159,7 +1340,7 @@ cleanup:
 static void pop_type_queue() {
     if (arrlen(m_type_queues) > 0) {
         type_queue_t queue = arrpop(m_type_queues);
-        arrfree(queue.types);
+        discard_type_queue(&queue);
 
         if (arrlen(m_type_queues) == 0) {
             arrfree(m_type_queues);
@@ -1169,6 +1350,46 @@ static void pop_type_queue() {
     }
 }
 
+tdn_err_t tdn_type_init(RuntimeTypeInfo type) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    if (type->TypeInitStarted) {
+        CHECK(!type->TypeInitFailed);
+        goto cleanup;
+    }
+
+    // arrays, byrefs and pointers are setup when they are
+    // created, but the element type might not be yet
+    if (type->IsArray || type->IsByRef || type->IsPointer) {
+        CHECK_AND_RETHROW(tdn_type_init(type->ElementType));
+        goto cleanup;
+    }
+
+    // generic definitions and parameters are never filled
+    if (type->IsGenericParameter || tdn_has_generic_parameters(type)) {
+        goto cleanup;
+    }
+
+    // mark it before filling, filling can reach the type again
+    // (class A : IEquatable<A>) and must not fill it twice
+    type->TypeInitStarted = true;
+
+    if (arrlen(m_type_queues) != 0) {
+        // someone up the stack is filling types already,
+        // it will get to this one once it is done
+        arrpush(arrlast(m_type_queues).types, type);
+    } else {
+        // fill it from a queue of its own, so everything
+        // reached while filling it waits for it to finish
+        push_type_queue();
+        arrpush(arrlast(m_type_queues).types, type);
+        CHECK_AND_RETHROW(drain_type_queue());
+    }
+
+cleanup:
+    return err;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Bootstrap of the type system
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1178,6 +1399,47 @@ static struct {
     RuntimeAssembly value;
 }* m_loaded_assemblies = NULL;
 
+/**
+ * Assemblies that were already decoded by tdn_load_assemblies
+ * but are not part of the type system yet
+ */
+static struct {
+    const char* key;
+    dotnet_file_t* value;
+}* m_pending_assemblies = NULL;
+
+typedef struct type_index_key {
+    Object scope;
+    String namespace;
+    String name;
+} type_index_key_t;
+
+/**
+ * Index of all the loaded types by their name, names are atoms so
+ * we can hash them by pointer
+ */
+static struct {
+    type_index_key_t key;
+    RuntimeTypeInfo value;
+}* m_type_index = NULL;
+
+RuntimeTypeInfo tdn_type_index_lookup(Object scope, String namespace, String name) {
+    type_index_key_t key = { .scope = scope, .namespace = namespace, .name = name };
+    int idx = hmgeti(m_type_index, key);
+    return idx >= 0 ? m_type_index[idx].value : NULL;
+}
+
+static tdn_err_t type_index_add(Object scope, RuntimeTypeInfo type) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    type_index_key_t key = { .scope = scope, .namespace = type->Namespace, .name = type->Name };
+    CHECK(hmgeti(m_type_index, key) < 0, "Duplicate type %T", type);
+    hmput(m_type_index, key, type);
+
+cleanup:
+    return err;
+}
+
 static tdn_err_t corelib_bootstrap() {
     tdn_err_t err = TDN_NO_ERROR;
 
@@ -1202,8 +1464,8 @@ static tdn_err_t corelib_bootstrap() {
     CHECK_AND_RETHROW(create_vtable(tRuntimeModule, 4));
 
     // setup the basic type so GC_NEW_ARRAY can work
-    CHECK_AND_RETHROW(tdn_create_string_from_cstr("RuntimeTypeInfo", &tRuntimeTypeInfo->Name));
-    CHECK_AND_RETHROW(tdn_create_string_from_cstr("System.Reflection", &tRuntimeTypeInfo->Namespace));
+    CHECK_AND_RETHROW(atom_intern("RuntimeTypeInfo", &tRuntimeTypeInfo->Name));
+    CHECK_AND_RETHROW(atom_intern("System.Reflection", &tRuntimeTypeInfo->Namespace));
 
 cleanup:
     return err;
@@ -1229,15 +1491,14 @@ static tdn_err_t corelib_bootstrap_types(RuntimeAssembly assembly) {
 
     // make sure we loaded all the required types
     bool loaded_everything = true;
-    if (m_loaded_types != ARRAY_LENGTH(m_load_types)) {
-        ERROR("Failed to load some types:");
+    for (int i = 0; i < ARRAY_LENGTH(m_load_types); i++) {
+        if (*m_load_types[i].dest == NULL && !m_load_types[i].optional) {
+            if (loaded_everything)
+                ERROR("Failed to load some types:");
 
-        for (int i = 0; i < ARRAY_LENGTH(m_load_types); i++) {
-            if (*m_load_types[i].dest == NULL) {
-                ERROR("\t- %s.%s", m_load_types[i].namespace, m_load_types[i].name);
-            }
+            ERROR("\t- %s.%s", m_load_types[i].namespace, m_load_types[i].name);
+            loaded_everything = false;
         }
-        loaded_everything = false;
     }
 
     if (m_inited_types != ARRAY_LENGTH(m_init_types)) {
@@ -1285,7 +1546,77 @@ cleanup:
     return err;
 }
 
+static tdn_err_t corelib_init_types(void) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    for (int i = 0; i < ARRAY_LENGTH(m_init_types); i++) {
+        CHECK_AND_RETHROW(tdn_type_init(*m_init_types[i].dest));
+    }
+
+    for (int i = 0; i < ARRAY_LENGTH(m_load_types); i++) {
+        if (*m_load_types[i].dest == NULL) {
+            continue;
+        }
+        CHECK_AND_RETHROW(tdn_type_init(*m_load_types[i].dest));
+    }
+
+cleanup:
+    return err;
+}
+
 static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembly);
+static tdn_err_t load_assembly_from_file(tdn_file_t file, RuntimeAssembly* out_assembly);
+
+static tdn_err_t decode_assembly(dotnet_file_t* file) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // load up the PE and dotnet metadata, this does not touch
+    // the type system so it can be done from any thread
+    CHECK_AND_RETHROW(pe_load_image(&file->file));
+    CHECK_AND_RETHROW(dotnet_load_file(file));
+
+cleanup:
+    return err;
+}
+
+static const char* assembly_ref_name(metadata_assembly_ref_t* assembly_ref) {
+    // TODO: how to handle this correctly
+    if (strcmp(assembly_ref->name, "System.Runtime") == 0) {
+        return "System.Private.CoreLib";
+    }
+    return assembly_ref->name;
+}
+
+static tdn_err_t load_pending_assembly(const char* name, RuntimeAssembly* out_assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    dotnet_file_t* dotnet = NULL;
+
+    // might have been pulled in as a reference already
+    int idx = shgeti(m_loaded_assemblies, name);
+    if (idx >= 0) {
+        CHECK(m_loaded_assemblies[idx].value != NULL, "Failed to get assembly `%s` - recursive dependency", name);
+        if (out_assembly != NULL) {
+            *out_assembly = m_loaded_assemblies[idx].value;
+        }
+        goto cleanup;
+    }
+
+    idx = shgeti(m_pending_assemblies, name);
+    CHECK(idx >= 0, "Failed to get assembly `%s` - not found", name);
+    dotnet = m_pending_assemblies[idx].value;
+    (void)shdel(m_pending_assemblies, name);
+
+    CHECK_AND_RETHROW(load_assembly(dotnet, out_assembly));
+    dotnet = NULL;
+
+cleanup:
+    if (dotnet != NULL) {
+        dotnet_free_file(dotnet);
+        tdn_host_free(dotnet);
+    }
+
+    return err;
+}
 
 static tdn_err_t assembly_load_assembly_refs(RuntimeAssembly assembly) {
     tdn_err_t err = TDN_NO_ERROR;
@@ -1295,13 +1626,7 @@ static tdn_err_t assembly_load_assembly_refs(RuntimeAssembly assembly) {
     assembly->AssemblyRefs = (RuntimeAssembly_Array)GC_NEW_ARRAY(RuntimeAssembly, assembly->Metadata->assembly_refs_count);
     for (int i = 0; i < assembly->Metadata->assembly_refs_count; i++) {
         metadata_assembly_ref_t* assembly_ref = &assembly->Metadata->assembly_refs[i];
-
-        const char* name = assembly_ref->name;
-
-        // TODO: how to handle this correctly
-        if (strcmp(name, "System.Runtime") == 0) {
-            name = "System.Private.CoreLib";
-        }
+        const char* name = assembly_ref_name(assembly_ref);
 
         // get from the hashmap of known assemblies
         // TODO: if not found call a callback to find and load the assembly
@@ -1309,15 +1634,19 @@ static tdn_err_t assembly_load_assembly_refs(RuntimeAssembly assembly) {
         int idx = shgeti(m_loaded_assemblies, name);
         if (idx >= 0) {
             // TODO: maybe this should have an array of major versions we know about
-            new_assembly = m_loaded_assemblies[i].value;
+            new_assembly = m_loaded_assemblies[idx].value;
             CHECK(new_assembly != NULL, "Failed to get assembly `%s` - recursive dependency", name);
 
+        } else if (shgeti(m_pending_assemblies, name) >= 0) {
+            // already decoded by tdn_load_assemblies, only need to commit it
+            CHECK_AND_RETHROW(load_pending_assembly(name, &new_assembly));
+
         } else {
             // attempt to resolve an assembly
             CHECK(tdn_host_resolve_assembly(name, assembly_ref->major_version, &current_file), "Failed to get assembly `%s` - not found", name);
 
             // now actually load the assembly so it can be used
-            CHECK_AND_RETHROW(tdn_load_assembly_from_file(current_file, &new_assembly));
+            CHECK_AND_RETHROW(load_assembly_from_file(current_file, &new_assembly));
 
             // add to the loaded assembly list
             shput(m_loaded_assemblies, name, new_assembly);
@@ -1344,6 +1673,13 @@ static tdn_err_t assembly_load_type_refs(RuntimeAssembly assembly) {
         metadata_type_ref_t* type_ref = &assembly->Metadata->type_refs[i];
         RuntimeTypeInfo wanted_type = NULL;
 
+        // the names of all loaded types are atoms, so get the atoms
+        // of the wanted names and compare them by pointer
+        String namespace = NULL;
+        String name = NULL;
+        bool has_name = atom_lookup(type_ref->type_namespace, &namespace) &&
+                        atom_lookup(type_ref->type_name, &name);
+
         // search for the type wherever needed
         token_t resolution_scope = type_ref->resolution_scope;
         switch (resolution_scope.table) {
@@ -1353,19 +1689,10 @@ static tdn_err_t assembly_load_type_refs(RuntimeAssembly assembly) {
                 CHECK(resolution_scope.index != 0 && resolution_scope.index <= assembly->AssemblyRefs->Length);
                 RuntimeAssembly scope = assembly->AssemblyRefs->Elements[resolution_scope.index - 1];
 
-                for (int j = 0; j < scope->TypeDefs->Length; j++) {
-                    RuntimeTypeInfo type = scope->TypeDefs->Elements[j];
-                    if (
-                        (
-                            (type->Namespace == NULL && type_ref->type_namespace[0] == '\0') ||
-                            tdn_compare_string_to_cstr(type->Namespace, type_ref->type_namespace)
-                        ) &&
-                        tdn_compare_string_to_cstr(type->Name, type_ref->type_name)
-                    ) {
-                        wanted_type = type;
-                        break;
-                    }
-                }
+                // if there is no such name then there is no such type
+                if (!has_name) break;
+
+                wanted_type = tdn_type_index_lookup((Object)scope, namespace, name);
             } break;
 
             // find type from another type
@@ -1374,21 +1701,11 @@ static tdn_err_t assembly_load_type_refs(RuntimeAssembly assembly) {
                 CHECK(resolution_scope.index <= i);
                 RuntimeTypeInfo type = assembly->TypeRefs->Elements[resolution_scope.index - 1];
 
-                // try to search under it
-                RuntimeTypeInfo nested = type->DeclaredNestedTypes;
-                while (nested != NULL) {
-                    if (
-                        (
-                            (nested->Namespace == NULL && type_ref->type_namespace[0] == '\0') ||
-                            tdn_compare_string_to_cstr(nested->Namespace, type_ref->type_namespace)
-                        ) &&
-                        tdn_compare_string_to_cstr(nested->Name, type_ref->type_name)
-                    ) {
-                        wanted_type = nested;
-                        break;
-                    }
-                    nested = nested->NextNestedType;
-                }
+                // if there is no such name then there is no such type
+                if (!has_name) break;
+
+                // nested types are indexed under their declaring type
+                wanted_type = tdn_type_index_lookup((Object)type, namespace, name);
             } break;
 
             default:
@@ -1403,19 +1720,19 @@ cleanup:
     return err;
 }
 
-static tdn_err_t assembly_load_methods(RuntimeAssembly assembly) {
+/**
+ * The amount of rows that is worth validating on a thread of its own
+ */
+#define VALIDATE_BATCH_SIZE 16384
+
+static tdn_err_t validate_method_defs(void* ctx, size_t start, size_t end) {
     tdn_err_t err = TDN_NO_ERROR;
-    RuntimeModule module = assembly->Module;
+    dotnet_file_t* file = ctx;
 
-    assembly->MethodDefs = (RuntimeMethodBase_Array)GC_NEW_ARRAY(MethodBase, assembly->Metadata->method_defs_count);
-    for (int i = 0; i < assembly->Metadata->method_defs_count; i++) {
-        metadata_method_def_t* method_def = &assembly->Metadata->method_defs[i];
+    for (size_t i = start; i < end; i++) {
+        metadata_method_def_t* method_def = &file->method_defs[i];
         MethodAttributes attributes = { .Attributes = method_def->flags };
         MethodImplAttributes impl_attributes = { .Attributes = method_def->impl_flags };
-        bool is_ctor = false;
-
-        // TODO: maybe parse the signature in here anyways, we would need to push a queue frame
-        //       before hand so we won't try to init stuff out of order
 
         // make sure the entire entry is valid, not including checks
         // that will be done at a later stage
@@ -1433,7 +1750,6 @@ static tdn_err_t assembly_load_methods(RuntimeAssembly assembly) {
         if (attributes.PinvokeImpl) CHECK(method_def->rva == 0);
         if (attributes.RTSpecialName) {
             CHECK(strcmp(method_def->name, ".ctor") == 0 || strcmp(method_def->name, ".cctor") == 0);
-            is_ctor = true;
         } else {
             CHECK(strcmp(method_def->name, ".ctor") != 0 && strcmp(method_def->name, ".cctor") != 0);
         }
@@ -1446,10 +1762,33 @@ static tdn_err_t assembly_load_methods(RuntimeAssembly assembly) {
             CHECK(!attributes.Virtual);
             CHECK(!attributes.Abstract);
         }
+    }
+
+cleanup:
+    return err;
+}
+
+static tdn_err_t assembly_load_methods(RuntimeAssembly assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeModule module = assembly->Module;
+
+    // the validation only looks at the metadata so spread it across
+    // threads, creating the objects must be done on this thread, a row is
+    // only a few compares so only big assemblies are worth the threads
+    CHECK_AND_RETHROW(parallel_for(assembly->Metadata->method_defs_count, VALIDATE_BATCH_SIZE, validate_method_defs, assembly->Metadata));
+
+    assembly->MethodDefs = (RuntimeMethodBase_Array)GC_NEW_ARRAY(MethodBase, assembly->Metadata->method_defs_count);
+    for (int i = 0; i < assembly->Metadata->method_defs_count; i++) {
+        metadata_method_def_t* method_def = &assembly->Metadata->method_defs[i];
+        MethodAttributes attributes = { .Attributes = method_def->flags };
+        MethodImplAttributes impl_attributes = { .Attributes = method_def->impl_flags };
+
+        // TODO: maybe parse the signature in here anyways, we would need to push a queue frame
+        //       before hand so we won't try to init stuff out of order
 
         // now that we are sure this looks correct, continue and setup the
         RuntimeMethodBase base = NULL;
-        if (is_ctor) {
+        if (attributes.RTSpecialName) {
             base = (RuntimeMethodBase)GC_NEW(RuntimeConstructorInfo);
         } else {
             base = (RuntimeMethodBase)GC_NEW(RuntimeMethodInfo);
@@ -1459,7 +1798,7 @@ static tdn_err_t assembly_load_methods(RuntimeAssembly assembly) {
         base->MethodImplFlags = impl_attributes;
         base->Module = module;
         base->VTableOffset = VTABLE_INVALID;
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(method_def->name, &base->Name));
+        CHECK_AND_RETHROW(atom_intern(method_def->name, &base->Name));
         CHECK(base->Name != NULL);
 
         // save it
@@ -1470,23 +1809,38 @@ cleanup:
     return err;
 }
 
-static tdn_err_t assembly_load_fields(RuntimeAssembly assembly) {
+static tdn_err_t validate_fields(void* ctx, size_t start, size_t end) {
     tdn_err_t err = TDN_NO_ERROR;
-    RuntimeModule module = assembly->Module;
+    dotnet_file_t* file = ctx;
 
-    assembly->Fields = GC_NEW_ARRAY(RuntimeFieldInfo, assembly->Metadata->fields_count);
-    for (int i = 0; i < assembly->Metadata->fields_count; i++) {
-        metadata_field_t* field = &assembly->Metadata->fields[i];
+    for (size_t i = start; i < end; i++) {
+        metadata_field_t* field = &file->fields[i];
         FieldAttributes attributes = { .Attributes = field->flags };
 
         // top level validations
         CHECK(attributes.Literal + attributes.InitOnly <= 1);
         if (attributes.Literal) CHECK(attributes.Static);
         if (attributes.RTSpecialName) CHECK(attributes.SpecialName);
+    }
+
+cleanup:
+    return err;
+}
+
+static tdn_err_t assembly_load_fields(RuntimeAssembly assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeModule module = assembly->Module;
+
+    CHECK_AND_RETHROW(parallel_for(assembly->Metadata->fields_count, VALIDATE_BATCH_SIZE, validate_fields, assembly->Metadata));
+
+    assembly->Fields = GC_NEW_ARRAY(RuntimeFieldInfo, assembly->Metadata->fields_count);
+    for (int i = 0; i < assembly->Metadata->fields_count; i++) {
+        metadata_field_t* field = &assembly->Metadata->fields[i];
+        FieldAttributes attributes = { .Attributes = field->flags };
 
         // create and save the type
         RuntimeFieldInfo field_info = GC_NEW(RuntimeFieldInfo);
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(field->name, &field_info->Name));
+        CHECK_AND_RETHROW(atom_intern(field->name, &field_info->Name));
         CHECK(field_info->Name != NULL);
         field_info->Attributes = attributes;
         field_info->Module = module;
@@ -1713,11 +2067,6 @@ static tdn_err_t connect_members_to_type(RuntimeTypeInfo type) {
             }
         }
 
-        // parse the body
-        if (method_def->rva != 0) {
-            CHECK_AND_RETHROW(tdn_parser_method_body(assembly, method_def, base));
-        }
-
         // and finally get the signature
         method_signature_t signature = {};
         CHECK_AND_RETHROW(sig_parse_method_def(
@@ -1727,6 +2076,7 @@ static tdn_err_t connect_members_to_type(RuntimeTypeInfo type) {
                 &signature));
         base->Parameters = signature.parameters;
         base->ReturnParameter = signature.return_parameter;
+        tdn_set_parameters_member(base);
 
         // get parameter information from the params table
         size_t params_count = (idx == assembly->Metadata->method_defs_count ?
@@ -1738,11 +2088,12 @@ static tdn_err_t connect_members_to_type(RuntimeTypeInfo type) {
         }
         CHECK(params_count <= base->Parameters->Length + 1); // TODO: shouldn't this be equals??
         for (int pi = 0; pi < params_count; pi++) {
-            metadata_param_t* param = &assembly->Metadata->params[method_def->param_list.index - 1 + pi];
+            metadata_param_t* param;
+            CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_PARAM,
+                method_def->param_list.index + pi, (void**)&param));
             CHECK(param->sequence < base->Parameters->Length + 1);
             ParameterInfo info = param->sequence == 0 ? base->ReturnParameter : base->Parameters->Elements[param->sequence - 1];
             info->Attributes = (ParameterAttributes){ .Attributes = param->flags };
-            CHECK_AND_RETHROW(tdn_create_string_from_cstr(param->name, &info->Name));
 
             // also store in the global array
             assembly->Params->Elements[method_def->param_list.index - 1 + pi] = info;
@@ -1885,7 +2236,7 @@ static tdn_err_t assembly_load_generics(RuntimeAssembly assembly) {
         } else {
             param->BaseType = tObject;
         }
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(generic_param->name, &param->Name));
+        CHECK_AND_RETHROW(atom_intern(generic_param->name, &param->Name));
 
         // store it
         assembly->GenericParams->Elements[i] = param;
@@ -1983,37 +2334,75 @@ cleanup:
     return err;
 }
 
-static tdn_err_t assembly_connect_read_only_attribute(RuntimeAssembly assembly, bool parameter) {
+/**
+ * Resolve the attribute type of every custom attribute in the assembly, the constructor
+ * is only resolved once per unique token since most attributes share a few constructors
+ */
+static tdn_err_t assembly_resolve_custom_attribute_types(RuntimeAssembly assembly, RuntimeTypeInfo** out_types) {
     tdn_err_t err = TDN_NO_ERROR;
+    RuntimeTypeInfo* types = NULL;
+    struct {
+        int key;
+        RuntimeTypeInfo value;
+    }* ctor_types = NULL;
 
-    // connect jit related custom attributes
+    arrsetlen(types, assembly->Metadata->custom_attribute_count);
     for (int i = 0; i < assembly->Metadata->custom_attribute_count; i++) {
-        metadata_custom_attribute_t* attr = &assembly->Metadata->custom_attributes[i];
+        metadata_custom_attribute_t attr;
+        CHECK_AND_RETHROW(metadata_get_row(assembly->Metadata, METADATA_CUSTOM_ATTRIBUTE, i + 1, &attr));
+
+        // check if we already resolved this ctor
+        int idx = hmgeti(ctor_types, attr.type.token);
+        if (idx >= 0) {
+            types[i] = ctor_types[idx].value;
+            continue;
+        }
+
         RuntimeMethodBase method;
-        CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, attr->type.token, NULL, NULL, &method));
+        CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, attr.type.token, NULL, NULL, &method));
         CHECK(object_get_vtable(&method->Object)->Type == tRuntimeConstructorInfo);
-        RuntimeTypeInfo type = method->DeclaringType;
+        types[i] = method->DeclaringType;
+        hmput(ctor_types, attr.type.token, method->DeclaringType);
+    }
+
+    *out_types = types;
+    types = NULL;
 
-        if (type == tIsReadOnlyAttribute) {
-            switch (attr->parent.table) {
+cleanup:
+    arrfree(types);
+    hmfree(ctor_types);
+
+    return err;
+}
+
+static tdn_err_t assembly_connect_read_only_attribute(RuntimeAssembly assembly, RuntimeTypeInfo* attribute_types, bool parameter) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    // connect jit related custom attributes
+    for (int i = 0; i < assembly->Metadata->custom_attribute_count; i++) {
+        if (attribute_types[i] == tIsReadOnlyAttribute) {
+            metadata_custom_attribute_t attr;
+            CHECK_AND_RETHROW(metadata_get_row(assembly->Metadata, METADATA_CUSTOM_ATTRIBUTE, i + 1, &attr));
+
+            switch (attr.parent.table) {
                 case METADATA_TYPE_DEF: {
                     if (parameter) break;
                     RuntimeTypeInfo parent_type;
-                    CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, attr->parent.token, NULL, NULL, &parent_type));
+                    CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, attr.parent.token, NULL, NULL, &parent_type));
                     parent_type->IsReadOnly = true;
                 } break;
 
                 case METADATA_METHOD_DEF: {
                     if (parameter) break;
                     RuntimeMethodBase parent_type;
-                    CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, attr->parent.token, NULL, NULL, &parent_type));
+                    CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, attr.parent.token, NULL, NULL, &parent_type));
                     parent_type->IsReadOnly = true;
                 } break;
 
                 case METADATA_PARAM: {
                     if (!parameter) break;
-                    CHECK(attr->parent.index != 0 && attr->parent.index <= assembly->Params->Length);
-                    ParameterInfo parent_type = assembly->Params->Elements[attr->parent.index - 1];
+                    CHECK(attr.parent.index != 0 && attr.parent.index <= assembly->Params->Length);
+                    ParameterInfo parent_type = assembly->Params->Elements[attr.parent.index - 1];
                     parent_type->IsReadOnly = true;
                 } break;
 
@@ -2022,7 +2411,7 @@ static tdn_err_t assembly_connect_read_only_attribute(RuntimeAssembly assembly,
                 } break;
 
                 default:
-                    WARN("Found IsReadOnlyAttribute on unknown token %02x", attr->parent.table);
+                    WARN("Found IsReadOnlyAttribute on unknown token %02x", attr.parent.table);
             }
         }
     }
@@ -2031,27 +2420,24 @@ cleanup:
     return err;
 }
 
-static tdn_err_t assembly_connect_by_ref_like_attribute(RuntimeAssembly assembly) {
+static tdn_err_t assembly_connect_by_ref_like_attribute(RuntimeAssembly assembly, RuntimeTypeInfo* attribute_types) {
     tdn_err_t err = TDN_NO_ERROR;
 
     // connect jit related custom attributes
     for (int i = 0; i < assembly->Metadata->custom_attribute_count; i++) {
-        metadata_custom_attribute_t* attr = &assembly->Metadata->custom_attributes[i];
-        RuntimeMethodBase method;
-        CHECK_AND_RETHROW(tdn_assembly_lookup_method(assembly, attr->type.token, NULL, NULL, &method));
-        CHECK(object_get_vtable(&method->Object)->Type == tRuntimeConstructorInfo);
-        RuntimeTypeInfo type = method->DeclaringType;
+        if (attribute_types[i] == tIsByRefLikeAttribute) {
+            metadata_custom_attribute_t attr;
+            CHECK_AND_RETHROW(metadata_get_row(assembly->Metadata, METADATA_CUSTOM_ATTRIBUTE, i + 1, &attr));
 
-        if (type == tIsByRefLikeAttribute) {
-            switch (attr->parent.table) {
+            switch (attr.parent.table) {
                 case METADATA_TYPE_DEF: {
                     RuntimeTypeInfo parent_type;
-                    CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, attr->parent.token, NULL, NULL, &parent_type));
+                    CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, attr.parent.token, NULL, NULL, &parent_type));
                     parent_type->IsByRefStruct = true;
                 } break;
 
                 default:
-                    WARN("Found IsByRefLikeAttribute on unknown token %02x", attr->parent.table);
+                    WARN("Found IsByRefLikeAttribute on unknown token %02x", attr.parent.table);
             }
         }
     }
@@ -2066,9 +2452,10 @@ static tdn_err_t assembly_connect_nested(RuntimeAssembly assembly) {
     // connect nested classes
     for (int i = 0; i < assembly->Metadata->nested_classes_count; i++) {
         metadata_nested_class_t* nest = &assembly->Metadata->nested_classes[i];
-        RuntimeTypeInfo nested, enclosing;
-        CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, nest->enclosing_class.token, NULL, NULL, &enclosing));
-        CHECK_AND_RETHROW(tdn_assembly_lookup_type(assembly, nest->nested_class.token, NULL, NULL, &nested));
+        CHECK(nest->enclosing_class.index != 0 && nest->enclosing_class.index <= assembly->TypeDefs->Length);
+        CHECK(nest->nested_class.index != 0 && nest->nested_class.index <= assembly->TypeDefs->Length);
+        RuntimeTypeInfo enclosing = assembly->TypeDefs->Elements[nest->enclosing_class.index - 1];
+        RuntimeTypeInfo nested = assembly->TypeDefs->Elements[nest->nested_class.index - 1];
         nested->DeclaringType = enclosing;
 
         // append to the singly linked list of nested types
@@ -2110,14 +2497,82 @@ cleanup:
     return err;
 }
 
+static tdn_err_t assembly_index_types(RuntimeAssembly assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    RuntimeTypeInfo* exported = NULL;
+
+    // top level types are indexed under the assembly, nested
+    // types under the type that declares them
+    for (int i = 0; i < assembly->TypeDefs->Length; i++) {
+        RuntimeTypeInfo type = assembly->TypeDefs->Elements[i];
+        Object scope = type->DeclaringType != NULL ? (Object)type->DeclaringType : (Object)assembly;
+        CHECK_AND_RETHROW(type_index_add(scope, type));
+    }
+
+    // exported types are forwarded to the assembly that defines
+    // them, index them as if they were our own
+    arrsetlen(exported, assembly->Metadata->exported_types_count);
+    for (int i = 0; i < assembly->Metadata->exported_types_count; i++) {
+        metadata_exported_type_t exported_type;
+        CHECK_AND_RETHROW(metadata_get_row(assembly->Metadata, METADATA_EXPORTED_TYPE, i + 1, &exported_type));
+        exported[i] = NULL;
+
+        String namespace = NULL;
+        String name = NULL;
+        bool has_name = atom_lookup(exported_type.type_namespace, &namespace) &&
+                        atom_lookup(exported_type.type_name, &name);
+
+        Object scope = NULL;
+        token_t implementation = exported_type.implementation;
+        switch (implementation.table) {
+            case METADATA_ASSEMBLY_REF: {
+                CHECK(implementation.index != 0 && implementation.index <= assembly->AssemblyRefs->Length);
+                scope = (Object)assembly->AssemblyRefs->Elements[implementation.index - 1];
+            } break;
+
+            case METADATA_EXPORTED_TYPE: {
+                // nested exported types always come after the type that encloses them
+                CHECK(implementation.index != 0 && implementation.index <= i);
+                scope = (Object)exported[implementation.index - 1];
+            } break;
+
+            // we only support a single module per assembly
+            case METADATA_FILE:
+                continue;
+
+            default:
+                CHECK_FAIL("%02x (%s.%s)", implementation.table, exported_type.type_namespace, exported_type.type_name);
+        }
+
+        RuntimeTypeInfo type = NULL;
+        if (scope != NULL && has_name) {
+            type = tdn_type_index_lookup(scope, namespace, name);
+        }
+
+        if (type == NULL) {
+            WARN("Couldn't resolve exported type %s.%s", exported_type.type_namespace, exported_type.type_name);
+            continue;
+        }
+
+        exported[i] = type;
+
+        // nested types are found from the real declaring type
+        if (implementation.table == METADATA_ASSEMBLY_REF) {
+            CHECK_AND_RETHROW(type_index_add((Object)assembly, type));
+        }
+    }
+
+cleanup:
+    arrfree(exported);
+
+    return err;
+}
+
 static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembly) {
     tdn_err_t err = TDN_NO_ERROR;
     bool pushed_type_queue = false;
     RuntimeAssembly assembly = NULL;
-
-    // now we can actually load up the PE and dotnet metadata
-    CHECK_AND_RETHROW(pe_load_image(&file->file));
-    CHECK_AND_RETHROW(dotnet_load_file(file));
+    RuntimeTypeInfo* attribute_types = NULL;
 
     // add the assembly to the lookup now
     if (file->assemblies_count != 0) {
@@ -2131,12 +2586,19 @@ static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembl
         shput(m_loaded_assemblies, file->assemblies[0].name, NULL);
     }
 
+    // names are interned in place from the heap
+    atom_register_heap(file->strings, file->strings_size);
 
     // if we are loading the main assembly then bootstrap now
     if (mCoreAssembly == NULL) {
         CHECK_AND_RETHROW(corelib_bootstrap());
     }
 
+    // any type that is used while we are loading is only filled once
+    // the assembly is fully connected
+    push_type_queue();
+    pushed_type_queue = true;
+
     // now we need to create the assembly, if we are at boostrap we need
     // to do something a bit more special
     assembly = GC_NEW(RuntimeAssembly);
@@ -2180,8 +2642,8 @@ static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembl
 
         type->MetadataToken = ((token_t){ .table = METADATA_TYPE_DEF, .index = i + 1 }).token;
         type->Module = module;
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(type_def->type_name, &type->Name));
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(type_def->type_namespace, &type->Namespace));
+        CHECK_AND_RETHROW(atom_intern(type_def->type_name, &type->Name));
+        CHECK_AND_RETHROW(atom_intern(type_def->type_namespace, &type->Namespace));
         CHECK(type->Name != NULL);
         type->Attributes.Value = (int)type_def->flags;
     }
@@ -2210,11 +2672,9 @@ static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembl
     // must be done before we do anything like create generic type instances otherwise
     // it won't pass the properties properly, we don't include parameters since they
     // are not initialized yet in this context
-    CHECK_AND_RETHROW(assembly_connect_by_ref_like_attribute(assembly));
-    CHECK_AND_RETHROW(assembly_connect_read_only_attribute(assembly, false));
-
-    push_type_queue();
-    pushed_type_queue = true;
+    CHECK_AND_RETHROW(assembly_resolve_custom_attribute_types(assembly, &attribute_types));
+    CHECK_AND_RETHROW(assembly_connect_by_ref_like_attribute(assembly, attribute_types));
+    CHECK_AND_RETHROW(assembly_connect_read_only_attribute(assembly, attribute_types, false));
 
     // and now connect the types with the members
     for (int i = 0; i < assembly->TypeDefs->Length; i++) {
@@ -2225,24 +2685,25 @@ static tdn_err_t load_assembly(dotnet_file_t* file, RuntimeAssembly* out_assembl
     // connect the read-only attribute on parameters, this must be done after
     // connecting the member to types since otherwise the parameters are not
     // initialized
-    CHECK_AND_RETHROW(assembly_connect_read_only_attribute(assembly, true));
+    CHECK_AND_RETHROW(assembly_connect_read_only_attribute(assembly, attribute_types, true));
 
+    // fill all the types that were used while loading, the rest of the
+    // types are only going to be filled once they are first used
     pushed_type_queue = false;
     CHECK_AND_RETHROW(drain_type_queue());
 
-    // calculate the size of all the basic types
-    for (int i = 0; i < assembly->TypeDefs->Length; i++) {
-        RuntimeTypeInfo type = assembly->TypeDefs->Elements[i];
-        if (!tdn_has_generic_parameters(type)) {
-            CHECK_AND_RETHROW(tdn_type_init(type));
-        }
-    }
-
     // connect all the misc classes
     CHECK_AND_RETHROW(assembly_connect_nested(assembly));
 
+    // now that we know which types are nested we can index them
+    CHECK_AND_RETHROW(assembly_index_types(assembly));
+
     // finish up with bootstrapping if this is the corelib
     if (mCoreAssembly == NULL) {
+        // the runtime depends on the well known types
+        // being filled from the start
+        CHECK_AND_RETHROW(corelib_init_types());
+
         // jit all the types required
         // for the runtime to work
         CHECK_AND_RETHROW(corelib_jit_types(assembly));
@@ -2270,6 +2731,8 @@ cleanup:
         pop_type_queue();
     }
 
+    arrfree(attribute_types);
+
     if (IS_ERROR(err) && assembly != NULL) {
         // we don't own the metadata in
         // the case we failed so remove it
@@ -2304,6 +2767,7 @@ tdn_err_t tdn_load_assembly_from_memory(const void* buffer, size_t buffer_size,
     dotnet->file.close_handle = memory_file_close;
 
     // call common code
+    CHECK_AND_RETHROW(decode_assembly(dotnet));
     CHECK_AND_RETHROW(load_assembly(dotnet, out_assembly));
 
 cleanup:
@@ -2319,7 +2783,7 @@ cleanup:
     return err;
 }
 
-tdn_err_t tdn_load_assembly_from_file(tdn_file_t file, RuntimeAssembly* out_assembly) {
+static tdn_err_t open_assembly_file(tdn_file_t file, dotnet_file_t** out_dotnet) {
     tdn_err_t err = TDN_NO_ERROR;
     dotnet_file_t* dotnet = NULL;
 
@@ -2330,16 +2794,207 @@ tdn_err_t tdn_load_assembly_from_file(tdn_file_t file, RuntimeAssembly* out_asse
     dotnet->file.read_file = tdn_host_read_file;
     dotnet->file.close_handle = tdn_host_close_file;
 
+    // if the host can map the file then use it in place
+    dotnet->file.mapped = tdn_host_map_file(file, &dotnet->file.mapped_size);
+
+    CHECK_AND_RETHROW(decode_assembly(dotnet));
+
+    *out_dotnet = dotnet;
+    dotnet = NULL;
+
+cleanup:
+    if (dotnet != NULL) {
+        dotnet_free_file(dotnet);
+        tdn_host_free(dotnet);
+    }
+
+    return err;
+}
+
+static tdn_err_t load_assembly_from_file(tdn_file_t file, RuntimeAssembly* out_assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    dotnet_file_t* dotnet = NULL;
+
     // call common code
+    CHECK_AND_RETHROW(open_assembly_file(file, &dotnet));
     CHECK_AND_RETHROW(load_assembly(dotnet, out_assembly));
 
 cleanup:
     // if we got an error free all the
     // native allocations
-    if (IS_ERROR(err)) {
+    if (IS_ERROR(err) && dotnet != NULL) {
+        dotnet_free_file(dotnet);
+        tdn_host_free(dotnet);
+    }
+
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading of multiple assemblies
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct pending_assembly {
+    const char* name;
+    uint16_t major_version;
+    dotnet_file_t* dotnet;
+} pending_assembly_t;
+
+static tdn_err_t decode_pending_assemblies(void* ctx, size_t start, size_t end) {
+    tdn_err_t err = TDN_NO_ERROR;
+    pending_assembly_t* pending = ctx;
+    tdn_file_t file = NULL;
+
+    for (size_t i = start; i < end; i++) {
+        CHECK(tdn_host_resolve_assembly(pending[i].name, pending[i].major_version, &file),
+            "Failed to get assembly `%s` - not found", pending[i].name);
+        CHECK_AND_RETHROW(open_assembly_file(file, &pending[i].dotnet));
+
+        tdn_host_close_file(file);
+        file = NULL;
+    }
+
+cleanup:
+    if (file != NULL) {
+        tdn_host_close_file(file);
+    }
+
+    return err;
+}
+
+static void queue_pending_assembly(pending_assembly_t** queue, const char* name, uint16_t major_version) {
+    // already loaded or decoded
+    if (shgeti(m_loaded_assemblies, name) >= 0 || shgeti(m_pending_assemblies, name) >= 0) {
+        return;
+    }
+
+    // already queued
+    for (int i = 0; i < arrlen(*queue); i++) {
+        if (strcmp((*queue)[i].name, name) == 0) {
+            return;
+        }
+    }
+
+    arrpush(*queue, ((pending_assembly_t){ .name = name, .major_version = major_version }));
+}
+
+static void queue_assembly_refs(pending_assembly_t** queue, dotnet_file_t* dotnet) {
+    for (int i = 0; i < dotnet->assembly_refs_count; i++) {
+        metadata_assembly_ref_t* assembly_ref = &dotnet->assembly_refs[i];
+        queue_pending_assembly(queue, assembly_ref_name(assembly_ref), assembly_ref->major_version);
+    }
+}
+
+/**
+ * Walk the reference graph one level at a time starting from the given level, the files
+ * of each level are read and decoded in parallel since they don't depend on each other,
+ * the decoded files are added to the pending assemblies
+ */
+static tdn_err_t decode_reference_graph(pending_assembly_t* level) {
+    tdn_err_t err = TDN_NO_ERROR;
+    pending_assembly_t* next = NULL;
+
+    if (m_pending_assemblies == NULL) {
+        sh_new_strdup(m_pending_assemblies);
+    }
+
+    while (arrlen(level) != 0) {
+        CHECK_AND_RETHROW(parallel_for(arrlen(level), 1, decode_pending_assemblies, level));
+
+        for (int i = 0; i < arrlen(level); i++) {
+            shput(m_pending_assemblies, level[i].name, level[i].dotnet);
+        }
+
+        // the names point into the decoded files, which stay alive while pending
+        for (int i = 0; i < arrlen(level); i++) {
+            dotnet_file_t* dotnet = level[i].dotnet;
+            level[i].dotnet = NULL;
+            queue_assembly_refs(&next, dotnet);
+        }
+
+        arrfree(level);
+        level = next;
+        next = NULL;
+    }
+
+cleanup:
+    // free whatever was decoded but never made pending
+    for (int i = 0; i < arrlen(level); i++) {
+        if (level[i].dotnet != NULL) {
+            dotnet_free_file(level[i].dotnet);
+            tdn_host_free(level[i].dotnet);
+        }
+    }
+    arrfree(level);
+    arrfree(next);
+
+    return err;
+}
+
+/**
+ * Free all the assemblies that were decoded but never committed
+ */
+static void free_pending_assemblies(void) {
+    for (int i = 0; i < shlen(m_pending_assemblies); i++) {
+        dotnet_free_file(m_pending_assemblies[i].value);
+        tdn_host_free(m_pending_assemblies[i].value);
+    }
+    shfree(m_pending_assemblies);
+}
+
+tdn_err_t tdn_load_assembly_from_file(tdn_file_t file, RuntimeAssembly* out_assembly) {
+    tdn_err_t err = TDN_NO_ERROR;
+    dotnet_file_t* dotnet = NULL;
+    pending_assembly_t* level = NULL;
+
+    CHECK_AND_RETHROW(open_assembly_file(file, &dotnet));
+
+    // read and decode everything it references in parallel, committing it
+    // then takes the references from the pending assemblies
+    queue_assembly_refs(&level, dotnet);
+    err = decode_reference_graph(level);
+    level = NULL;
+    CHECK_AND_RETHROW(err);
+
+    // the file itself is loaded as given, it is
+    // never looked up by its name
+    CHECK_AND_RETHROW(load_assembly(dotnet, out_assembly));
+    dotnet = NULL;
+
+cleanup:
+    if (dotnet != NULL) {
         dotnet_free_file(dotnet);
         tdn_host_free(dotnet);
     }
+    free_pending_assemblies();
+
+    return err;
+}
+
+tdn_err_t tdn_load_assemblies(const char** names, const uint16_t* major_versions, size_t count, RuntimeAssembly* out_assemblies) {
+    tdn_err_t err = TDN_NO_ERROR;
+    pending_assembly_t* level = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        queue_pending_assembly(&level, names[i], major_versions[i]);
+    }
+
+    err = decode_reference_graph(level);
+    level = NULL;
+    CHECK_AND_RETHROW(err);
+
+    // everything is decoded, now commit them into the type system, this is done
+    // one at a time and every assembly pulls in its references before itself
+    if (mCoreAssembly == NULL) {
+        CHECK_AND_RETHROW(load_pending_assembly("System.Private.CoreLib", NULL));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        CHECK_AND_RETHROW(load_pending_assembly(names[i], out_assemblies != NULL ? &out_assemblies[i] : NULL));
+    }
+
+cleanup:
+    free_pending_assemblies();
 
     return err;
 }
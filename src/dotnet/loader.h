@@ -3,6 +3,7 @@
 #include "tomatodotnet/except.h"
 #include "tomatodotnet/types/basic.h"
 #include "tomatodotnet/types/reflection.h"
+#include "tomatodotnet/types/type.h"
 #include "dotnet/metadata/metadata_tables.h"
 
 tdn_err_t tdn_parser_method_body(
@@ -11,4 +12,36 @@ tdn_err_t tdn_parser_method_body(
     RuntimeMethodBase methodBase
 );
 
+/**
+ * Parse the body of the method (IL, locals and exception clauses) if it has one
+ * and it was not parsed yet, bodies are only parsed once the method is jitted or
+ * reflection asks for them, the body is published only once it is complete
+ */
+tdn_err_t tdn_method_load_body(RuntimeMethodBase method);
+
 tdn_err_t tdn_type_init(RuntimeTypeInfo type);
+
+/**
+ * Link the parameters of a freshly parsed signature to their method, the
+ * names of the parameters are found through it on first use
+ */
+static inline void tdn_set_parameters_member(RuntimeMethodBase method) {
+    method->ReturnParameter->Member = (RuntimeMemberInfo)method;
+    for (int i = 0; i < method->Parameters->Length; i++) {
+        method->Parameters->Elements[i]->Member = (RuntimeMemberInfo)method;
+    }
+}
+
+/**
+ * Static fields whose storage is a single object reference, these are placed
+ * at the start of the static block so they can be scanned as a single range
+ */
+static inline bool tdn_is_static_reference_field(RuntimeFieldInfo field) {
+    return tdn_type_is_referencetype(field->FieldType) && field->FieldType->StackSize == sizeof(void*);
+}
+
+/**
+ * Lookup a type by its name in the type index, the scope is the assembly
+ * for top level and exported types, or the declaring type for nested types
+ */
+RuntimeTypeInfo tdn_type_index_lookup(Object scope, String namespace, String name);
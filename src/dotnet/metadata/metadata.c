@@ -1,10 +1,13 @@
 #include "metadata.h"
 
+#include <stdatomic.h>
 #include <util/alloc.h>
 
 #include "util/except.h"
 #include "util/string.h"
+#include "util/parallel.h"
 #include "sig.h"
+#include "dotnet/atom.h"
 
 // II.25.2.2.1
 #define IMAGE_FILE_RELOCS_STRIPPED 0x0001
@@ -66,7 +69,6 @@ typedef enum coded_index {
 
 typedef struct metadata_loader_context {
     dotnet_file_t* file;
-    metadata_table_info_t tables[64];
     bool coded_index_sizes[CODED_INDEX_MAX];
     uint8_t string_index_big;
     uint8_t guid_index_big;
@@ -356,13 +358,47 @@ static metadata_loader_op_t* m_table_ops[64] = {
             DONE },
 };
 
+/**
+ * Tables that the runtime only ever touches a few rows of, these are not expanded
+ * when the file is loaded, instead their rows are decoded on demand straight from
+ * the image with metadata_get_row
+ */
+static const uint64_t m_lazy_tables =
+    (1ull << METADATA_CONSTANT) |
+    (1ull << METADATA_CUSTOM_ATTRIBUTE) |
+    (1ull << METADATA_DECL_SECURITY) |
+    (1ull << METADATA_FIELD_LAYOUT) |
+    (1ull << METADATA_EVENT_MAP) |
+    (1ull << METADATA_EVENT) |
+    (1ull << METADATA_PROPERTY_MAP) |
+    (1ull << METADATA_PROPERTY) |
+    (1ull << METADATA_METHOD_SEMANTICS) |
+    (1ull << METADATA_MODULE_REF) |
+    (1ull << METADATA_FIELD_RVA) |
+    (1ull << METADATA_ASSEMBLY_REF_OS) |
+    (1ull << METADATA_FILE) |
+    (1ull << METADATA_EXPORTED_TYPE) |
+    (1ull << METADATA_MANIFEST_RESOURCE);
+
+/**
+ * Tables that are only ever reached through tokens while types are filled and methods
+ * are jitted, these are not expanded when the file is loaded either, instead a row
+ * is decoded the first time it is needed and kept, see metadata_get_row_ref
+ */
+static const uint64_t m_cached_tables =
+    (1ull << METADATA_PARAM) |
+    (1ull << METADATA_MEMBER_REF) |
+    (1ull << METADATA_STAND_ALONE_SIG) |
+    (1ull << METADATA_TYPE_SPEC) |
+    (1ull << METADATA_METHOD_SPEC);
+
 static size_t is_coded_index_size_big(metadata_loader_context_t* context, int index) {
     uint32_t max_row_count = 0;
     uint8_t* coded_index = m_coded_index_tables[index];
     for (int i = 0; i < coded_index[1]; i++) {
         uint8_t table_idx = coded_index[2 + i];
         if (table_idx == (uint8_t)-1) continue;
-        metadata_table_info_t* table = &context->tables[table_idx];
+        metadata_table_info_t* table = &context->file->tables[table_idx];
         if (max_row_count < table->row_count) {
             max_row_count = table->row_count;
         }
@@ -372,193 +408,273 @@ static size_t is_coded_index_size_big(metadata_loader_context_t* context, int in
 }
 
 static size_t is_table_index_big(metadata_loader_context_t* context, int table) {
-    return (context->tables[table].row_count > UINT16_MAX);
+    return (context->file->tables[table].row_count > UINT16_MAX);
 }
 
-static tdn_err_t expand_metadata_table(metadata_loader_context_t* context, int table, void* stream, size_t stream_size, size_t* row_size) {
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Column decoding
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Every kind of column has a decoder for each width it can have in the image, the decoder
+// of every column is selected once when the table layout is calculated, so decoding a row
+// is a straight run of calls without any checks of the heap and table sizes
+//
+
+static ALWAYS_INLINE tdn_err_t decode_table_index(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    token_t* new_token = entry;
+    new_token->table = op;
+    new_token->index = value;
+
+    // validate the index is valid
+    CHECK(value <= file->tables[op].row_count + 1);
+
+cleanup:
+    return err;
+}
+
+static ALWAYS_INLINE tdn_err_t decode_coded_index(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+    uint8_t* coded_index = m_coded_index_tables[op - GET_CODED_INDEX_START];
+    token_t* new_token = entry;
+
+    // get the ci table, and validate it is a good one
+    int bit_count = coded_index[0];
+    uint32_t token_table_mask = (1 << bit_count) - 1;
+    uint8_t ci_table = value & token_table_mask;
+    CHECK(ci_table < coded_index[1]);
+
+    // now resolve to the real table and validate it is inside of it
+    ci_table = coded_index[2 + ci_table];
+    CHECK(ci_table < 64);
+    new_token->table = ci_table;
+    new_token->index = value >> bit_count;
+    CHECK(new_token->index <= file->tables[ci_table].row_count + 1);
+
+cleanup:
+    return err;
+}
+
+static ALWAYS_INLINE tdn_err_t decode_uint(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    if (op == GET_UINT16) {
+        *(uint16_t*)entry = value;
+    } else {
+        *(uint32_t*)entry = value;
+    }
+    return TDN_NO_ERROR;
+}
+
+static ALWAYS_INLINE tdn_err_t decode_string(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK(value < file->strings_size);
+    *(const char**)entry = file->strings + value;
+
+cleanup:
+    return err;
+}
+
+static ALWAYS_INLINE tdn_err_t decode_blob(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK(value < file->blob_size);
+
+    // parse the compressed length
+    uint32_t blob_size = 0;
+    blob_entry_t new_blob = {
+        .data = file->blob + value,
+        .size = file->blob_size - value,
+    };
+    CHECK_AND_RETHROW(sig_parse_compressed_int(&new_blob, &blob_size));
+
+    // validate and set the length
+    CHECK(blob_size <= file->blob_size - value);
+    new_blob.size = blob_size;
+
+    *(blob_entry_t*)entry = new_blob;
+
+cleanup:
+    return err;
+}
+
+static ALWAYS_INLINE tdn_err_t decode_guid(dotnet_file_t* file, uint8_t op, uint32_t value, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    Guid** new_value = entry;
+    if (value == 0) {
+        *new_value = NULL;
+    } else {
+        value--;
+        CHECK(value < file->guids_count);
+        *new_value = &file->guids[value];
+    }
+
+cleanup:
+    return err;
+}
+
+#define DEFINE_COLUMN_DECODER(kind, width) \
+    static tdn_err_t decode_##kind##_##width(dotnet_file_t* file, uint8_t op, const uint8_t* column, void* entry) { \
+        return decode_##kind(file, op, *(const uint##width##_t*)column, entry); \
+    }
+
+DEFINE_COLUMN_DECODER(table_index, 16)
+DEFINE_COLUMN_DECODER(table_index, 32)
+DEFINE_COLUMN_DECODER(coded_index, 16)
+DEFINE_COLUMN_DECODER(coded_index, 32)
+DEFINE_COLUMN_DECODER(uint, 16)
+DEFINE_COLUMN_DECODER(uint, 32)
+DEFINE_COLUMN_DECODER(string, 16)
+DEFINE_COLUMN_DECODER(string, 32)
+DEFINE_COLUMN_DECODER(blob, 16)
+DEFINE_COLUMN_DECODER(blob, 32)
+DEFINE_COLUMN_DECODER(guid, 16)
+DEFINE_COLUMN_DECODER(guid, 32)
+
+#define COLUMN_DECODER(kind, big) \
+    ((big) ? decode_##kind##_32 : decode_##kind##_16)
+
+/**
+ * Calculate the layout of a table, this selects the size and decoder of every
+ * column once so decoding a row doesn't need to care about the heap and table sizes
+ */
+static tdn_err_t build_table_layout(metadata_loader_context_t* context, int table, metadata_raw_table_t* raw) {
     tdn_err_t err = TDN_NO_ERROR;
-    void* entries = NULL;
 
     metadata_loader_op_t* ops = m_table_ops[table];
     CHECK(ops != NULL);
 
-    // calculate both in file and in memory sizes of the table
     size_t in_file = 0;
     size_t in_memory = 0;
-    for (int i = 0; ops[i] != DONE; i++) {
+    int i;
+    for (i = 0; ops[i] != DONE; i++) {
+        CHECK(i < METADATA_MAX_COLUMNS);
+
+        bool big;
+        metadata_column_decode_t decode;
+        uint8_t expanded_size;
         switch (ops[i]) {
             case GET_TABLE_START ... GET_TABLE_END:
-                in_file += is_table_index_big(context, ops[i]) ? 4 : 2;
-                in_memory += sizeof(token_t);
+                big = is_table_index_big(context, ops[i]);
+                decode = COLUMN_DECODER(table_index, big);
+                expanded_size = sizeof(token_t);
                 break;
 
             case GET_CODED_INDEX_START ... GET_CODED_INDEX_END:
-                in_file += context->coded_index_sizes[ops[i] - GET_CODED_INDEX_START] ? 4 : 2;
-                in_memory += sizeof(token_t);
+                big = context->coded_index_sizes[ops[i] - GET_CODED_INDEX_START];
+                decode = COLUMN_DECODER(coded_index, big);
+                expanded_size = sizeof(token_t);
+                break;
+
+            case GET_UINT16: big = false; decode = decode_uint_16; expanded_size = sizeof(uint16_t); break;
+            case GET_UINT32: big = true; decode = decode_uint_32; expanded_size = sizeof(uint32_t); break;
+
+            case GET_STRING:
+                big = context->string_index_big;
+                decode = COLUMN_DECODER(string, big);
+                expanded_size = sizeof(const char*);
+                break;
+
+            case GET_BLOB:
+                big = context->blog_index_big;
+                decode = COLUMN_DECODER(blob, big);
+                expanded_size = sizeof(blob_entry_t);
                 break;
 
-            case GET_UINT16: in_file += 2; in_memory += sizeof(uint16_t); break;
-            case GET_UINT32: in_file += 4; in_memory += sizeof(uint32_t); break;
-            case GET_STRING: in_file += context->string_index_big ? 4 : 2; in_memory += sizeof(const char*); break;
-            case GET_BLOB: in_file += context->blog_index_big ? 4 : 2; in_memory += sizeof(blob_entry_t); break;
-            case GET_GUID: in_file += context->guid_index_big ? 4 : 2; in_memory += sizeof(Guid*); break;
+            case GET_GUID:
+                big = context->guid_index_big;
+                decode = COLUMN_DECODER(guid, big);
+                expanded_size = sizeof(Guid*);
+                break;
 
-            default: return -1;
+            default: CHECK_FAIL();
         }
+
+        raw->columns[i] = (metadata_column_t){
+            .decode = decode,
+            .op = ops[i],
+            .size = big ? 4 : 2,
+            .expanded_size = expanded_size,
+        };
+        in_file += raw->columns[i].size;
+        in_memory += expanded_size;
     }
 
-    size_t row_count = context->tables[table].row_count;
+    raw->columns_count = i;
+    raw->row_size = in_file;
+    raw->expanded_row_size = in_memory;
+
+cleanup:
+    return err;
+}
+
+/**
+ * Decode a single row from the image into its expanded form, validating
+ * all the indexes in it
+ */
+static tdn_err_t decode_metadata_row(dotnet_file_t* file, metadata_raw_table_t* raw, const uint8_t* row, void* entry) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    for (int i = 0; i < raw->columns_count; i++) {
+        metadata_column_t* column = &raw->columns[i];
+        CHECK_AND_RETHROW(column->decode(file, column->op, row, entry));
+        row += column->size;
+        entry += column->expanded_size;
+    }
+
+cleanup:
+    return err;
+}
+
+static tdn_err_t expand_metadata_table(dotnet_file_t* file, int table) {
+    tdn_err_t err = TDN_NO_ERROR;
+    void* entries = NULL;
 
-    // validate the stream is big enough
-    CHECK(stream_size >= in_file * row_count);
+    metadata_raw_table_t* raw = &file->raw_tables[table];
+    size_t row_count = file->tables[table].row_count;
 
     // allocate space for expanded part
-    entries = tdn_mallocz(in_memory * context->tables[table].row_count);
+    entries = tdn_mallocz(raw->expanded_row_size * row_count);
     CHECK_ERROR(entries != NULL, TDN_ERROR_OUT_OF_MEMORY);
 
-#define GET_INDEX(IS_BIG) \
-    ({ \
-        uint32_t ___value = 0; \
-        if (IS_BIG) { \
-            CHECK(stream_size >= 4); \
-            ___value = *(uint32_t*)stream; \
-            stream_size -= 4; \
-            stream += 4; \
-        } else { \
-            CHECK(stream_size >= 2); \
-            ___value = *(uint16_t*)stream; \
-            stream_size -= 2; \
-            stream += 2; \
-        } \
-        ___value; \
-    })
-
     // expand it all
-    void* entry = entries;
-    void* entry_current = entry;
-    void* stream_current = stream;
-    for (size_t e = 0; e < context->tables[table].row_count; e++) {
-        for (int i = 0; ops[i] != DONE; i++) {
-            switch (ops[i]) {
-                case GET_TABLE_START ... GET_TABLE_END: {
-                    uint32_t index = GET_INDEX(is_table_index_big(context, ops[i]));
-                    token_t* new_token = entry;
-                    entry += sizeof(token_t);
-                    new_token->table = ops[i];
-                    new_token->index = index;
-
-                    // validate the index is valid
-                    CHECK(index <= context->tables[ops[i]].row_count + 1);
-                } break;
-
-                case GET_CODED_INDEX_START ... GET_CODED_INDEX_END: {
-                    coded_index_t index = ops[i] - GET_CODED_INDEX_START;
-                    uint32_t token = GET_INDEX(context->coded_index_sizes[index]);
-                    uint8_t* coded_index = m_coded_index_tables[index];
-
-                    token_t* new_token = entry;
-                    entry += sizeof(token_t);
-
-                    // get the ci table, and validate it is a good one
-                    int bit_count = coded_index[0];
-                    uint32_t token_table_mask = (1 << bit_count) - 1;
-                    uint8_t ci_table = token & token_table_mask;
-                    CHECK(ci_table < coded_index[1]);
-
-                    // now resolve to the real table and validate it is inside of it
-                    ci_table = coded_index[2 + ci_table];
-                    CHECK(ci_table < 64);
-                    new_token->table = ci_table;
-                    new_token->index = token >> bit_count;
-                    CHECK(new_token->index <= context->tables[ci_table].row_count + 1);
-                } break;
-
-                case GET_UINT16: {
-                    uint16_t* new_value = entry;
-                    entry += 2;
-
-                    CHECK(stream_size >= 2);
-                    *new_value = *(uint16_t*)stream;
-                    stream_size -= 2;
-                    stream += 2;
-                } break;
-
-                case GET_UINT32: {
-                    uint32_t* new_value = entry;
-                    entry += 4;
-
-                    CHECK(stream_size >= 4);
-                    *new_value = *(uint32_t*)stream;
-                    stream_size -= 4;
-                    stream += 4;
-                } break;
-
-                case GET_STRING: {
-                    const char** new_value = entry;
-                    entry += sizeof(const char*);
-                    uint32_t index = GET_INDEX(context->string_index_big);
-
-                    CHECK(index < context->file->strings_size);
-                    *new_value = context->file->strings + index;
-                } break;
-
-                case GET_BLOB: {
-                    blob_entry_t* new_value = entry;
-                    entry += sizeof(blob_entry_t);
-                    uint32_t index = GET_INDEX(context->blog_index_big);
-                    CHECK(index < context->file->blob_size);
-
-                    // parse the compressed length
-                    uint32_t blob_size = 0;
-                    blob_entry_t new_blob = {
-                        .data = context->file->blob + index,
-                        .size = context->file->blob_size - index,
-                    };
-                    CHECK_AND_RETHROW(sig_parse_compressed_int(&new_blob, &blob_size));
-
-                    // validate and set the length
-                    CHECK(blob_size <= context->file->blob_size - index);
-                    new_blob.size = blob_size;
-
-                    *new_value = new_blob;
-                }; break;
-
-                case GET_GUID: {
-                    Guid** new_value = entry;
-                    entry += sizeof(Guid*);
-                    uint32_t index = GET_INDEX(context->guid_index_big);
-                    if (index == 0) {
-                        *new_value = NULL;
-                    } else {
-                        index--;
-                        CHECK(index < context->file->guids_count);
-                        *new_value = &context->file->guids[index];
-                    }
-                } break;
-
-                default: return -1;
-            }
-        }
-
-        // TODO: remove in non-debug, just makes sure
-        //       we are reading this correctly
-        entry_current += in_memory;
-        CHECK(entry_current == entry);
-        stream_current += in_file;
-        CHECK(stream_current == stream);
+    for (size_t e = 0; e < row_count; e++) {
+        CHECK_AND_RETHROW(decode_metadata_row(file, raw,
+            raw->rows + e * raw->row_size,
+            entries + e * raw->expanded_row_size));
     }
 
     // export the table
-    context->tables[table].entries = entries;
-
-    // output the row size
-    *row_size = in_file * row_count;
+    file->tables[table].entries = entries;
+    entries = NULL;
 
 cleanup:
-    if (IS_ERROR(err)) {
-        tdn_host_free(entries);
+    tdn_host_free(entries);
+
+    return err;
+}
+
+typedef struct expand_tables_job {
+    dotnet_file_t* file;
+    int tables[64];
+} expand_tables_job_t;
+
+/**
+ * Below this amount of rows the tables are expanded on the calling thread
+ */
+#define EXPAND_PARALLEL_MIN_ROWS 8192
+
+static tdn_err_t expand_metadata_tables(void* ctx, size_t start, size_t end) {
+    tdn_err_t err = TDN_NO_ERROR;
+    expand_tables_job_t* job = ctx;
+
+    for (size_t i = start; i < end; i++) {
+        CHECK_AND_RETHROW(expand_metadata_table(job->file, job->tables[i]));
     }
 
+cleanup:
     return err;
 }
 
@@ -581,8 +697,8 @@ static tdn_err_t dotnet_parse_metadata_tables(dotnet_file_t* file, void* stream,
     for (int i = 0; i < 64; i++) {
         if (header->Valid & (1ull << i)) {
             CHECK(size >= 4);
-            context.tables[i].row_count = *(uint32_t*)stream;
-            CHECK(context.tables[i].row_count <= (1 << 24));
+            file->tables[i].row_count = *(uint32_t*)stream;
+            CHECK(file->tables[i].row_count <= (1 << 24));
             size -= 4;
             stream += 4;
         }
@@ -593,32 +709,277 @@ static tdn_err_t dotnet_parse_metadata_tables(dotnet_file_t* file, void* stream,
         context.coded_index_sizes[i] = is_coded_index_size_big(&context, i);
     }
 
-    // actually expand the tables
+    // calculate the layout of the tables and where they are
     for (int i = 0; i < 64; i++) {
         if (header->Valid & (1ull << i)) {
-            size_t row_size;
-            CHECK_AND_RETHROW(expand_metadata_table(&context, i, stream, size, &row_size));
-            CHECK(size >= row_size);
-            size -= row_size;
-            stream += row_size;
+            metadata_raw_table_t* raw = &file->raw_tables[i];
+            CHECK_AND_RETHROW(build_table_layout(&context, i, raw));
+
+            size_t table_size = (size_t)raw->row_size * file->tables[i].row_count;
+            CHECK(size >= table_size);
+            raw->rows = stream;
+            size -= table_size;
+            stream += table_size;
+        }
+    }
+
+    // and now expand the tables that are used as a whole, every table
+    // only depends on the layout so they can be expanded in parallel
+    expand_tables_job_t job = { .file = file };
+    size_t tables_count = 0;
+    size_t total_rows = 0;
+    for (int i = 0; i < 64; i++) {
+        if ((header->Valid & (1ull << i)) && ((m_lazy_tables | m_cached_tables) & (1ull << i)) == 0) {
+            job.tables[tables_count++] = i;
+            total_rows += file->tables[i].row_count;
         }
     }
 
-    memcpy(file->tables, context.tables, sizeof(context.tables));
+    // small assemblies expand faster than threads can be started
+    size_t batch = total_rows < EXPAND_PARALLEL_MIN_ROWS ? tables_count : 1;
+    CHECK_AND_RETHROW(parallel_for(tables_count, batch, expand_metadata_tables, &job));
 
 cleanup:
     if (IS_ERROR(err)) {
         for (int i = 0; i < 64; i++) {
-            if (context.tables[i].entries != NULL) {
-                tdn_host_free(context.tables[i].entries);
-                context.tables[i].entries = NULL;
+            tdn_host_free(file->tables[i].entries);
+            file->tables[i].entries = NULL;
+        }
+    }
+
+    return err;
+}
+
+tdn_err_t metadata_get_row(dotnet_file_t* file, int table, uint32_t index, void* out_row) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK(table < 64);
+    CHECK(index != 0 && index <= file->tables[table].row_count);
+    metadata_raw_table_t* raw = &file->raw_tables[table];
+
+    if (file->tables[table].entries != NULL) {
+        // the table was expanded, just copy it
+        memcpy(out_row, file->tables[table].entries + (index - 1) * raw->expanded_row_size, raw->expanded_row_size);
+    } else {
+        CHECK_AND_RETHROW(decode_metadata_row(file, raw, raw->rows + (index - 1) * raw->row_size, out_row));
+    }
+
+cleanup:
+    return err;
+}
+
+typedef enum metadata_row_state {
+    METADATA_ROW_NOT_DECODED,
+    METADATA_ROW_DECODING,
+    METADATA_ROW_DECODED,
+} metadata_row_state_t;
+
+tdn_err_t metadata_get_row_ref(dotnet_file_t* file, int table, uint32_t index, void** out_row) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    CHECK(table < 64);
+    CHECK(index != 0 && index <= file->tables[table].row_count);
+    metadata_raw_table_t* raw = &file->raw_tables[table];
+    size_t row_count = file->tables[table].row_count;
+
+    // the table was expanded, just point into it
+    if (file->tables[table].entries != NULL) {
+        *out_row = file->tables[table].entries + (index - 1) * raw->expanded_row_size;
+        goto cleanup;
+    }
+
+    // only tables that are meant to be kept can be, the
+    // rest are decoded into a copy with metadata_get_row
+    CHECK(m_cached_tables & (1ull << table));
+
+    // allocate the rows on first use, someone might have done it in the
+    // meanwhile, in which case we free ours and use theirs
+    uint8_t* rows = atomic_load_explicit(&raw->cached_rows, memory_order_acquire);
+    if (rows == NULL) {
+        uint8_t* new_rows = tdn_mallocz((raw->expanded_row_size + 1) * row_count);
+        CHECK_ERROR(new_rows != NULL, TDN_ERROR_OUT_OF_MEMORY);
+        if (atomic_compare_exchange_strong(&raw->cached_rows, &rows, new_rows)) {
+            rows = new_rows;
+        } else {
+            tdn_host_free(new_rows);
+        }
+    }
+
+    // the state of every row is after all the rows
+    _Atomic(uint8_t)* state = (_Atomic(uint8_t)*)(rows + raw->expanded_row_size * row_count) + (index - 1);
+    void* row = rows + (index - 1) * raw->expanded_row_size;
+
+    uint8_t current = atomic_load_explicit(state, memory_order_acquire);
+    while (current != METADATA_ROW_DECODED) {
+        if (current == METADATA_ROW_NOT_DECODED) {
+            if (!atomic_compare_exchange_strong(state, &current, METADATA_ROW_DECODING)) {
+                continue;
             }
+
+            // we own the row, a row that fails to decode is
+            // left as is so the next user reports the error
+            tdn_err_t decode_err = decode_metadata_row(file, raw, raw->rows + (index - 1) * raw->row_size, row);
+            atomic_store_explicit(state,
+                IS_ERROR(decode_err) ? METADATA_ROW_NOT_DECODED : METADATA_ROW_DECODED,
+                memory_order_release);
+            CHECK_AND_RETHROW(decode_err);
+            break;
+        }
+
+        // someone else is decoding it, wait for them
+        CPU_RELAX();
+        current = atomic_load_explicit(state, memory_order_acquire);
+    }
+
+    *out_row = row;
+
+cleanup:
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sorted table lookups
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef uint32_t (*metadata_row_key_t)(const void* row);
+
+static uint32_t interface_impl_key(const void* row) {
+    return ((const metadata_interface_impl_t*)row)->class.index;
+}
+
+static uint32_t method_impl_key(const void* row) {
+    return ((const metadata_method_impl_t*)row)->class.index;
+}
+
+static bool is_table_sorted(metadata_table_info_t* table, size_t row_size, metadata_row_key_t get_key) {
+    for (uint32_t i = 1; i < table->row_count; i++) {
+        if (get_key(table->entries + (i - 1) * row_size) > get_key(table->entries + i * row_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Find the range of rows with the given key, returns the first row and
+ * outputs the amount of rows that have the key
+ */
+static void* find_sorted_range(void* entries, uint32_t row_count, size_t row_size, metadata_row_key_t get_key, uint32_t key, uint32_t* out_count) {
+    // lower bound of the key
+    uint32_t low = 0;
+    uint32_t high = row_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (get_key(entries + mid * row_size) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
 
+    // and now count all the entries with the same key
+    uint32_t end = low;
+    while (end < row_count && get_key(entries + end * row_size) == key) {
+        end++;
+    }
+
+    *out_count = end - low;
+    return entries + low * row_size;
+}
+
+/**
+ * Create a copy of the table that is sorted by the key, the original order is kept
+ * between rows with the same key, done with a counting sort since the keys are
+ * row indexes of another table, which has key_count rows
+ */
+static tdn_err_t create_sorted_copy(metadata_table_info_t* table, size_t row_size, metadata_row_key_t get_key, uint32_t key_count, void** out_entries) {
+    tdn_err_t err = TDN_NO_ERROR;
+    uint32_t* offsets = NULL;
+    void* entries = NULL;
+
+    // the keys come from the file, make sure they are in range
+    // of the owner table before using them as bucket indexes
+    for (uint32_t i = 0; i < table->row_count; i++) {
+        CHECK(get_key(table->entries + i * row_size) <= key_count);
+    }
+
+    offsets = tdn_mallocz(sizeof(uint32_t) * ((size_t)key_count + 2));
+    CHECK_ERROR(offsets != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+    entries = tdn_mallocz(row_size * table->row_count);
+    CHECK_ERROR(entries != NULL, TDN_ERROR_OUT_OF_MEMORY);
+
+    // count the rows of every key, and turn it into the start offsets
+    for (uint32_t i = 0; i < table->row_count; i++) {
+        offsets[get_key(table->entries + i * row_size) + 1]++;
+    }
+    for (uint32_t i = 1; i <= key_count + 1; i++) {
+        offsets[i] += offsets[i - 1];
+    }
+
+    for (uint32_t i = 0; i < table->row_count; i++) {
+        void* row = table->entries + i * row_size;
+        memcpy(entries + offsets[get_key(row)]++ * row_size, row, row_size);
+    }
+
+    *out_entries = entries;
+    entries = NULL;
+
+cleanup:
+    tdn_host_free(offsets);
+    tdn_host_free(entries);
+
+    return err;
+}
+
+/**
+ * The owner lookups depend on the tables being sorted, the standard says they
+ * should be (II.22) but does not require it, so files that don't follow it get
+ * a sorted copy of the table used only for the lookups
+ */
+static tdn_err_t index_owner_tables(dotnet_file_t* file) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    uint32_t type_def_count = file->tables[METADATA_TYPE_DEF].row_count;
+
+    metadata_table_info_t* interface_impls = &file->tables[METADATA_INTERFACE_IMPL];
+    if (!is_table_sorted(interface_impls, sizeof(metadata_interface_impl_t), interface_impl_key)) {
+        CHECK_AND_RETHROW(create_sorted_copy(interface_impls, sizeof(metadata_interface_impl_t),
+            interface_impl_key, type_def_count, (void**)&file->interface_impls_by_class));
+    }
+
+    metadata_table_info_t* method_impls = &file->tables[METADATA_METHOD_IMPL];
+    if (!is_table_sorted(method_impls, sizeof(metadata_method_impl_t), method_impl_key)) {
+        CHECK_AND_RETHROW(create_sorted_copy(method_impls, sizeof(metadata_method_impl_t),
+            method_impl_key, type_def_count, (void**)&file->method_impls_by_class));
+    }
+
+cleanup:
     return err;
 }
 
+metadata_interface_impl_t* metadata_find_interface_impls(dotnet_file_t* file, token_t class, uint32_t* out_count) {
+    if (class.table != METADATA_TYPE_DEF) {
+        *out_count = 0;
+        return NULL;
+    }
+
+    void* entries = file->interface_impls_by_class ?: file->interface_impls;
+    return find_sorted_range(entries, file->interface_impls_count, sizeof(metadata_interface_impl_t),
+                             interface_impl_key, class.index, out_count);
+}
+
+metadata_method_impl_t* metadata_find_method_impls(dotnet_file_t* file, token_t class, uint32_t* out_count) {
+    if (class.table != METADATA_TYPE_DEF) {
+        *out_count = 0;
+        return NULL;
+    }
+
+    void* entries = file->method_impls_by_class ?: file->method_impls;
+    return find_sorted_range(entries, file->method_impls_count, sizeof(metadata_method_impl_t),
+                             method_impl_key, class.index, out_count);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Dotnet initial metadata loader
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -635,10 +996,9 @@ tdn_err_t dotnet_load_file(dotnet_file_t* file) {
 
     // II.25.2.3.3 CLI Header
     IMAGE_DATA_DIRECTORY* com_descriptor = &file->file.header->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR];
-    IMAGE_COR20_HEADER* com_header = pe_image_address(&file->file, com_descriptor->VirtualAddress);
-    void* com_header_end = pe_image_address(&file->file, com_descriptor->VirtualAddress + com_descriptor->Size - 1);
-    CHECK(com_header != NULL && com_header_end != NULL && (void*)com_header < com_header_end);
     CHECK(com_descriptor->Size >= sizeof(IMAGE_COR20_HEADER));
+    IMAGE_COR20_HEADER* com_header = pe_image_range(&file->file, com_descriptor->VirtualAddress, com_descriptor->Size);
+    CHECK(com_header != NULL);
     CHECK(com_header->cb == sizeof(IMAGE_COR20_HEADER));
 
     // Check version
@@ -652,9 +1012,8 @@ tdn_err_t dotnet_load_file(dotnet_file_t* file) {
     CHECK((com_header->Flags & COMIMAGE_FLAGS_NATIVE_ENTRYPOINT) == 0);
 
     // II.24
-    void* metadata_root = pe_image_address(&file->file, com_header->MetaData.VirtualAddress);
-    void* metadata_root_end = pe_image_address(&file->file, com_header->MetaData.VirtualAddress + com_header->MetaData.Size - 1);
-    CHECK(metadata_root != NULL && metadata_root_end != NULL && metadata_root < metadata_root_end);
+    void* metadata_root = pe_image_range(&file->file, com_header->MetaData.VirtualAddress, com_header->MetaData.Size);
+    CHECK(metadata_root != NULL);
 
     // II.24.2.1
     CHECK(com_header->MetaData.Size > sizeof(metadata_root_before_version_t));
@@ -677,9 +1036,8 @@ tdn_err_t dotnet_load_file(dotnet_file_t* file) {
         CHECK(len < 33);
         len += 1;
 
-        void* start = pe_image_address(&file->file, com_header->MetaData.VirtualAddress + stream->offset);
-        void* end = pe_image_address(&file->file, com_header->MetaData.VirtualAddress + stream->offset + stream->size - 1);
-        CHECK(start != NULL && end != NULL && start <= end);
+        void* start = pe_image_range(&file->file, com_header->MetaData.VirtualAddress + stream->offset, stream->size);
+        CHECK(start != NULL);
         CHECK((stream->size % 4) == 0);
 
         // check which one it can be
@@ -710,6 +1068,7 @@ tdn_err_t dotnet_load_file(dotnet_file_t* file) {
 
     CHECK(md_stream_start != NULL);
     CHECK_AND_RETHROW(dotnet_parse_metadata_tables(file, md_stream_start, md_stream_size));
+    CHECK_AND_RETHROW(index_owner_tables(file));
 
 cleanup:
     return err;
@@ -721,6 +1080,18 @@ void dotnet_free_file(dotnet_file_t* file) {
     for (size_t i = 0; i < ARRAY_LENGTH(file->tables); i++) {
         tdn_host_free(file->tables[i].entries);
         file->tables[i].entries = NULL;
+        tdn_host_free(file->raw_tables[i].cached_rows);
+        file->raw_tables[i].cached_rows = NULL;
+    }
+
+    tdn_host_free(file->interface_impls_by_class);
+    tdn_host_free(file->method_impls_by_class);
+    file->interface_impls_by_class = NULL;
+    file->method_impls_by_class = NULL;
+
+    // the atoms may still reference names from the heap
+    if (file->strings != NULL) {
+        atom_release_heap(file->strings, file->strings_size);
     }
 
     file->us = NULL;
@@ -8,10 +8,46 @@ typedef struct metadata_table_info {
     void* entries;
 } metadata_table_info_t;
 
-typedef struct dotnet_file {
+#define METADATA_MAX_COLUMNS 9
+
+typedef struct dotnet_file dotnet_file_t;
+
+/**
+ * Decodes a single column of a row, there is one for every kind of column and width
+ */
+typedef tdn_err_t (*metadata_column_decode_t)(dotnet_file_t* file, uint8_t op, const uint8_t* column, void* entry);
+
+typedef struct metadata_column {
+    metadata_column_decode_t decode;
+    uint8_t op;
+    uint8_t size;
+    uint8_t expanded_size;
+} metadata_column_t;
+
+/**
+ * A table as it is in the image, the size and decoder of each column
+ * is selected once when the table stream is parsed
+ */
+typedef struct metadata_raw_table {
+    const uint8_t* rows;
+    uint32_t row_size;
+    uint32_t expanded_row_size;
+    int columns_count;
+    metadata_column_t columns[METADATA_MAX_COLUMNS];
+
+    // for tables whose rows are decoded on first use, the expanded rows
+    // followed by the decode state of each of them, allocated on first use
+    _Atomic(uint8_t*) cached_rows;
+} metadata_raw_table_t;
+
+struct dotnet_file {
     // the PE file of this dotnet file
     pe_file_t file;
 
+    // the tables in the image, rows of tables that are not
+    // expanded are decoded from here on demand
+    metadata_raw_table_t raw_tables[64];
+
     // the metadata tables of the file
     union {
         metadata_table_info_t tables[64];
@@ -120,7 +156,8 @@ typedef struct dotnet_file {
             // 0x26
             metadata_table_info_t _reserved_0x26;
             // 0x27
-            metadata_table_info_t _reserved_0x27;
+            uint32_t exported_types_count;
+            metadata_exported_type_t* exported_types;
             // 0x28
             metadata_table_info_t _reserved_0x28;
             // 0x29
@@ -151,8 +188,39 @@ typedef struct dotnet_file {
     size_t guids_count;
 
     int entry_point_token;
-} dotnet_file_t;
+
+    // copies of the tables sorted by the owner type, only
+    // created when the file does not have them sorted
+    metadata_interface_impl_t* interface_impls_by_class;
+    metadata_method_impl_t* method_impls_by_class;
+};
 
 tdn_err_t dotnet_load_file(dotnet_file_t* file);
 
+/**
+ * Get a single row of a table, works for both tables that were expanded at load
+ * time and ones that are only decoded on demand (like custom attributes), the
+ * index is 1-based like the index of a token
+ */
+tdn_err_t metadata_get_row(dotnet_file_t* file, int table, uint32_t index, void* out_row);
+
+/**
+ * Get a pointer to a row of a table that is either expanded at load time or decoded on
+ * first use and kept (like params and member refs), the row stays valid for as long
+ * as the file is loaded, the index is 1-based like the index of a token
+ */
+tdn_err_t metadata_get_row_ref(dotnet_file_t* file, int table, uint32_t index, void** out_row);
+
+/**
+ * Find all the interface impls of the given type, uses the table sorted
+ * by the class column, outputs the amount of entries found
+ */
+metadata_interface_impl_t* metadata_find_interface_impls(dotnet_file_t* file, token_t class, uint32_t* out_count);
+
+/**
+ * Find all the method impls of the given type, uses the table sorted
+ * by the class column, outputs the amount of entries found
+ */
+metadata_method_impl_t* metadata_find_method_impls(dotnet_file_t* file, token_t class, uint32_t* out_count);
+
 void dotnet_free_file(dotnet_file_t* file);
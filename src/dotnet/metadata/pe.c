@@ -3,6 +3,7 @@
 #include <util/alloc.h>
 
 #include "util/except.h"
+#include "util/string.h"
 
 typedef struct pe_loader_context {
     tdn_err_t (*read_file)(void* file, size_t offset, size_t size, void* buffer);
@@ -105,6 +106,52 @@ static void* loader_image_address(pe_loader_context_t* context, uintptr_t addres
     return context->image_address + address;
 }
 
+static tdn_err_t pe_mapped_read_file(void* _file, size_t offset, size_t size, void* buffer) {
+    tdn_err_t err = TDN_NO_ERROR;
+    pe_file_t* file = _file;
+
+    CHECK(file->mapped_size >= size);
+    CHECK(file->mapped_size - size >= offset);
+    memcpy(buffer, file->mapped + offset, size);
+
+cleanup:
+    return err;
+}
+
+/**
+ * Use a file that is mapped in memory in place, the headers are validated
+ * the same way but nothing is copied, instead addresses are translated
+ * through the section table on access
+ */
+static tdn_err_t pe_load_mapped_image(pe_file_t* pe_file) {
+    tdn_err_t err = TDN_NO_ERROR;
+
+    pe_loader_context_t loader_context = {
+        .handle = pe_file,
+        .read_file = pe_mapped_read_file,
+        .image_address = NULL
+    };
+    CHECK_AND_RETHROW(pe_get_image_info(&loader_context));
+
+    // the header validation made sure that the headers and the raw
+    // data of all the sections are inside of the mapping
+    IMAGE_NT_HEADERS32* header = (void*)pe_file->mapped + loader_context.pe_header_offset;
+    pe_file->sections = (void*)pe_file->mapped +
+                            loader_context.pe_header_offset +
+                            sizeof(uint32_t) +
+                            sizeof(IMAGE_FILE_HEADER) +
+                            header->FileHeader.SizeOfOptionalHeader;
+    pe_file->sections_count = header->FileHeader.NumberOfSections;
+    pe_file->size_of_headers = loader_context.size_of_headers;
+
+    pe_file->image = NULL;
+    pe_file->image_size = loader_context.image_size;
+    pe_file->header = header;
+
+cleanup:
+    return err;
+}
+
 tdn_err_t pe_load_image(pe_file_t* pe_file) {
     tdn_err_t err = TDN_NO_ERROR;
 
@@ -114,6 +161,13 @@ tdn_err_t pe_load_image(pe_file_t* pe_file) {
         .read_file = pe_file->read_file,
         .image_address = NULL
     };
+
+    // if we have a mapping use it directly
+    if (pe_file->mapped != NULL) {
+        CHECK_AND_RETHROW(pe_load_mapped_image(pe_file));
+        goto cleanup;
+    }
+
     CHECK_AND_RETHROW(pe_get_image_info(&loader_context));
 
     // allocate space for it
@@ -156,6 +210,9 @@ tdn_err_t pe_load_image(pe_file_t* pe_file) {
     pe_file->image = loader_context.image_address;
     pe_file->image_size = loader_context.image_size;
     pe_file->header = header;
+    pe_file->sections = first_section;
+    pe_file->sections_count = number_of_sections;
+    pe_file->size_of_headers = loader_context.size_of_headers;
 
 cleanup:
     if (IS_ERROR(err)) {
@@ -167,7 +224,55 @@ cleanup:
     return err;
 }
 
+void* pe_image_range(pe_file_t* pe_file, uintptr_t address, size_t size) {
+    // the image is fully loaded, so just check the range
+    if (pe_file->image != NULL) {
+        if (address > pe_file->image_size || size > pe_file->image_size - address) {
+            return NULL;
+        }
+        return pe_file->image + address;
+    }
+
+    // the headers are at the start of the file
+    if (address < pe_file->size_of_headers) {
+        if (size > pe_file->size_of_headers - address) {
+            return NULL;
+        }
+        return (void*)pe_file->mapped + address;
+    }
+
+    // search for the section that has this range, we only have
+    // the raw data of each section, anything beyond it is not
+    // accessible in place
+    for (size_t i = 0; i < pe_file->sections_count; i++) {
+        IMAGE_SECTION_HEADER* section = &pe_file->sections[i];
+
+        size_t section_size = section->Misc.VirtualSize;
+        if (section_size == 0 || section_size > section->SizeOfRawData) {
+            section_size = section->SizeOfRawData;
+        }
+
+        if (address < section->VirtualAddress || address - section->VirtualAddress > section_size) {
+            continue;
+        }
+
+        size_t offset = address - section->VirtualAddress;
+        if (size > section_size - offset) {
+            return NULL;
+        }
+
+        return (void*)pe_file->mapped + section->PointerToRawData + offset;
+    }
+
+    return NULL;
+}
+
 void pe_free_image(pe_file_t* pe_file) {
+    if (pe_file->mapped != NULL) {
+        tdn_host_unmap_file(pe_file->mapped, pe_file->mapped_size);
+        pe_file->mapped = NULL;
+    }
+
     tdn_host_free(pe_file->image);
     pe_file->image = NULL;
 }
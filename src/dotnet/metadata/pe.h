@@ -12,18 +12,27 @@ typedef struct pe_file {
     void (*close_handle)(void* handle);
     void* handle;
 
-    // the loaded image
+    // if set the file is mapped read-only in memory, and the
+    // image is used in place instead of being copied
+    const void* mapped;
+    size_t mapped_size;
+
+    // the loaded image, null when the file is mapped
     void* image;
     size_t image_size;
     IMAGE_NT_HEADERS32* header;
+
+    // the sections, used to translate addresses of a mapped file
+    IMAGE_SECTION_HEADER* sections;
+    size_t sections_count;
+    size_t size_of_headers;
 } pe_file_t;
 
-static inline void* pe_image_address(pe_file_t* context, uintptr_t address) {
-    if (address >= context->image_size) {
-        return NULL;
-    }
-    return context->image + address;
-}
+/**
+ * Get the address of the given rva range in the image, returns NULL if the
+ * range is not fully contained in the headers or in a single section
+ */
+void* pe_image_range(pe_file_t* pe_file, uintptr_t address, size_t size);
 
 tdn_err_t pe_load_image(pe_file_t* pe_file);
 
@@ -24,6 +24,9 @@ RuntimeTypeInfo tUInt32 = NULL;
 RuntimeTypeInfo tUInt64 = NULL;
 RuntimeTypeInfo tUIntPtr = NULL;
 
+RuntimeTypeInfo tSingle = NULL;
+RuntimeTypeInfo tDouble = NULL;
+
 RuntimeTypeInfo tArray = NULL;
 RuntimeTypeInfo tString = NULL;
 
@@ -46,6 +49,12 @@ RuntimeTypeInfo tUnsafe = NULL;
 RuntimeTypeInfo tMemoryMarshal = NULL;
 RuntimeTypeInfo tBuffer = NULL;
 RuntimeTypeInfo tBitOperations = NULL;
+RuntimeTypeInfo tSpanHelpers = NULL;
+RuntimeTypeInfo tMath = NULL;
+RuntimeTypeInfo tVector128 = NULL;
+RuntimeTypeInfo tVector256 = NULL;
+RuntimeTypeInfo tVector128Generic = NULL;
+RuntimeTypeInfo tVector256Generic = NULL;
 RuntimeTypeInfo tDebug = NULL;
 
 RuntimeTypeInfo tInAttribute = NULL;
@@ -105,6 +114,10 @@ RuntimeTypeInfo tdn_get_intermediate_type(RuntimeTypeInfo type) {
     type = tdn_get_verification_type(type);
 
     if (type == tSByte || type == tInt16) return tInt32;
+
+    // we use double as the F type, float32 values are kept in
+    // the higher precision until they are stored
+    if (type == tSingle) return tDouble;
     return type;
 }
 
@@ -23,6 +23,9 @@ extern RuntimeTypeInfo tUInt32;
 extern RuntimeTypeInfo tUInt64;
 extern RuntimeTypeInfo tUIntPtr;
 
+extern RuntimeTypeInfo tSingle;
+extern RuntimeTypeInfo tDouble;
+
 extern RuntimeTypeInfo tArray;
 extern RuntimeTypeInfo tString;
 
@@ -45,6 +48,12 @@ extern RuntimeTypeInfo tUnsafe;
 extern RuntimeTypeInfo tMemoryMarshal;
 extern RuntimeTypeInfo tBuffer;
 extern RuntimeTypeInfo tBitOperations;
+extern RuntimeTypeInfo tSpanHelpers;
+extern RuntimeTypeInfo tMath;
+extern RuntimeTypeInfo tVector128;
+extern RuntimeTypeInfo tVector256;
+extern RuntimeTypeInfo tVector128Generic;
+extern RuntimeTypeInfo tVector256Generic;
 extern RuntimeTypeInfo tDebug;
 
 extern RuntimeTypeInfo tInAttribute;
@@ -5,6 +5,7 @@
 #include "dotnet/metadata/sig.h"
 #include "dotnet/metadata/metadata.h"
 #include "dotnet/loader.h"
+#include "dotnet/atom.h"
 
 tdn_err_t tdn_assembly_lookup_type(
     RuntimeAssembly assembly,
@@ -27,17 +28,17 @@ tdn_err_t tdn_assembly_lookup_type(
         } break;
 
         case METADATA_TYPE_SPEC: {
-            CHECK(token.index != 0 && token.index <= assembly->Metadata->type_specs_count);
-            blob_entry_t entry = assembly->Metadata->type_specs[token.index - 1].signature;
-            CHECK_AND_RETHROW(sig_parse_type_spec(entry, assembly, typeArgs, methodArgs, type));
+            metadata_type_spec_t* spec;
+            CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_TYPE_SPEC, token.index, (void**)&spec));
+            CHECK_AND_RETHROW(sig_parse_type_spec(spec->signature, assembly, typeArgs, methodArgs, type));
         } break;
 
         default:
             CHECK_FAIL("tdn_assembly_lookup_type: called with invalid table %02x", token.table);
     }
 
-    // make sure the type is fully initialized
-    // TODO: initialize the size properly
+    // types are not filled here, this is used by signature parsing during
+    // load, they are filled once the jit actually needs them
 
 cleanup:
     return err;
@@ -91,8 +92,8 @@ tdn_err_t tdn_assembly_lookup_method(
         } break;
 
         case METADATA_METHOD_SPEC: {
-            CHECK(token.index != 0 && token.index <= assembly->Metadata->method_specs_count);
-            metadata_method_spec_t* spec = &assembly->Metadata->method_specs[token.index - 1];
+            metadata_method_spec_t* spec;
+            CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_METHOD_SPEC, token.index, (void**)&spec));
 
             // parse the generic arguments
             RuntimeTypeInfo_Array gen_args;
@@ -106,8 +107,8 @@ tdn_err_t tdn_assembly_lookup_method(
         } break;
 
         case METADATA_MEMBER_REF: {
-            CHECK(token.index != 0 && token.index <= assembly->Metadata->member_refs_count);
-            metadata_member_ref_t* ref = &assembly->Metadata->member_refs[token.index - 1];
+            metadata_member_ref_t* ref;
+            CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_MEMBER_REF, token.index, (void**)&ref));
 
             // get the enclosing type
             RuntimeTypeInfo parent = NULL;
@@ -119,8 +120,14 @@ tdn_err_t tdn_assembly_lookup_method(
             blob_entry_t blob = ref->signature;
             CHECK_AND_RETHROW(sig_parse_method_def(blob, assembly, parent->GenericArguments, NULL, true, &signature));
 
-            // now search for a method with that signature
+            // now search for a method with that signature, member names are
+            // atoms so if the name was never interned nothing can match it
             bool found = false;
+            String name = NULL;
+            if (!atom_lookup(ref->name, &name)) {
+                CHECK_FAIL("Failed to find member ref %T::%s", parent, ref->name);
+            }
+
             int method_count = parent->DeclaredMethods->Length;
             int ctor_count = parent->DeclaredConstructors->Length;
             for (int i = 0; i < method_count + ctor_count; i++) {
@@ -131,7 +138,7 @@ tdn_err_t tdn_assembly_lookup_method(
                     m = (RuntimeMethodBase)parent->DeclaredConstructors->Elements[i];
                 }
 
-                if (!tdn_compare_string_to_cstr(m->Name, ref->name)) {
+                if (m->Name != name) {
                     continue;
                 }
 
@@ -200,8 +207,8 @@ tdn_err_t tdn_assembly_lookup_field(
         *field = assembly->Fields->Elements[token.index - 1];
 
     } else if (token.table == METADATA_MEMBER_REF) {
-        CHECK(token.index != 0 && token.index <= assembly->Fields->Length);
-        metadata_member_ref_t* ref = &assembly->Metadata->member_refs[token.index - 1];
+        metadata_member_ref_t* ref;
+        CHECK_AND_RETHROW(metadata_get_row_ref(assembly->Metadata, METADATA_MEMBER_REF, token.index, (void**)&ref));
 
         // get the owner type
         RuntimeTypeInfo type;
@@ -212,11 +219,13 @@ tdn_err_t tdn_assembly_lookup_field(
         CHECK_AND_RETHROW(sig_parse_field_type(ref->signature, assembly, type->GenericArguments, methodArgs, &field_type));
 
         // search for a field with that name
+        String name = NULL;
+        CHECK(atom_lookup(ref->name, &name));
         RuntimeFieldInfo found = NULL;
         RuntimeFieldInfo_Array fields = type->DeclaredFields;
         for (int i = 0; i < fields->Length; i++) {
             RuntimeFieldInfo info = fields->Elements[i];
-            if (tdn_compare_string_to_cstr(info->Name, ref->name)) {
+            if (info->Name == name) {
                 // make sure the type matches
                 CHECK(generic_compare_type(info->FieldType, field_type));
                 found = info;
@@ -242,18 +251,17 @@ tdn_err_t tdn_assembly_lookup_type_by_cstr(
 ) {
     tdn_err_t err = TDN_NO_ERROR;
 
-    for (int i = 0; i < assembly->TypeDefs->Length; i++) {
-        RuntimeTypeInfo type = assembly->TypeDefs->Elements[i];
-        if (
-            tdn_compare_string_to_cstr(type->Namespace, namespace) &&
-            tdn_compare_string_to_cstr(type->Name, name)
-        ) {
-            *out_type = type;
-            goto cleanup;
-        }
-    }
-
-    CHECK_FAIL();
+    // type names are atoms, if any of the names was never
+    // interned then there can't be such a type
+    String namespace_atom = NULL;
+    String name_atom = NULL;
+    CHECK(atom_lookup(namespace, &namespace_atom));
+    CHECK(atom_lookup(name, &name_atom));
+
+    RuntimeTypeInfo type = tdn_type_index_lookup((Object)assembly, namespace_atom, name_atom);
+    CHECK(type != NULL);
+    CHECK_AND_RETHROW(tdn_type_init(type));
+    *out_type = type;
 
 cleanup:
     return err;
@@ -4,6 +4,7 @@
 #include "tomatodotnet/types/reflection.h"
 #include "dotnet/metadata/metadata.h"
 #include "util/except.h"
+#include "dotnet/generic_table.h"
 #include "util/stb_ds.h"
 #include "dotnet/gc/gc.h"
 #include "dotnet/loader.h"
@@ -28,11 +29,6 @@ static tdn_err_t create_generic_method(RuntimeMethodInfo base, RuntimeTypeInfo_A
     new_method->IsReadOnly = base->IsReadOnly;
     new_method->VTableOffset = VTABLE_INVALID;
 
-    // if it has a body copy it over
-    if (method_def->rva != 0) {
-        CHECK_AND_RETHROW(tdn_parser_method_body(assembly, method_def, (RuntimeMethodBase)new_method));
-    }
-
     // and finally get the signature
     method_signature_t signature = {};
     CHECK_AND_RETHROW(sig_parse_method_def(
@@ -42,6 +38,7 @@ static tdn_err_t create_generic_method(RuntimeMethodInfo base, RuntimeTypeInfo_A
             &signature));
     new_method->Parameters = signature.parameters;
     new_method->ReturnParameter = signature.return_parameter;
+    tdn_set_parameters_member((RuntimeMethodBase)new_method);
 
 cleanup:
     return err;
@@ -57,15 +54,8 @@ tdn_err_t tdn_method_make_generic(
     CHECK(base->GenericMethodDefinition == base);
 
     // check if already has one
-    size_t hash = stbds_hash_bytes(args->Elements, sizeof(RuntimeTypeInfo) * args->Length, 0);
-    int idx = hmgeti(base->GenericMethodInstances, hash);
-    if (idx == -1) {
-        // create it and set it incase we need it again
-        // for expansion
-        RuntimeMethodInfo new_method = GC_NEW(RuntimeMethodInfo);
-
-        hmput(base->GenericMethodInstances, hash, new_method);
-
+    RuntimeMethodInfo instance = generic_table_lookup(base, args);
+    if (instance == NULL) {
         // validate the make generic
         CHECK(base->GenericArguments->Length == args->Length);
         for (int i = 0; i < args->Length; i++) {
@@ -77,20 +67,25 @@ tdn_err_t tdn_method_make_generic(
                     args));
         }
 
-        // and now fill it up
-        CHECK_AND_RETHROW(create_generic_method(base, args, new_method));
-
-        // and out it goes
-        *method = new_method;
-    } else {
-        // found it! check we don't have a collision by accident
-        RuntimeMethodInfo instance = base->GenericMethodInstances[idx].value;
-        for (int i = 0; i < args->Length; i++) {
-            CHECK(instance->GenericArguments->Elements[i] == args->Elements[i]);
+        // create it and set it incase we need it again
+        // for expansion
+        RuntimeMethodInfo new_method = GC_NEW(RuntimeMethodInfo);
+        CHECK_AND_RETHROW(generic_table_insert(base, args, new_method, (void**)&instance));
+        if (instance != new_method) {
+            // someone else created it first
+            goto done;
         }
-        *method = instance;
+
+        // and now fill it up, only letting others see it once it is complete
+        err = create_generic_method(base, args, new_method);
+        generic_table_publish(base, args, new_method, !IS_ERROR(err));
+        CHECK_AND_RETHROW(err);
     }
 
+done:
+    // and out it goes
+    *method = instance;
+
 cleanup:
     return err;
 }
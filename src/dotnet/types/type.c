@@ -2,11 +2,13 @@
 #include "dotnet/gc/gc.h"
 #include "dotnet/loader.h"
 #include "util/except.h"
+#include "dotnet/generic_table.h"
 #include "dotnet/metadata/metadata_tables.h"
 #include "dotnet/types.h"
 #include "util/stb_ds.h"
 #include "dotnet/metadata/sig.h"
 #include "dotnet/metadata/metadata.h"
+#include "dotnet/atom.h"
 #include <stdatomic.h>
 
 bool tdn_type_is_valuetype(RuntimeTypeInfo type) {
@@ -252,7 +254,7 @@ static tdn_err_t expand_type_from_typedef(RuntimeTypeInfo type, RuntimeTypeInfo
         metadata_field_t* field = &assembly->Metadata->fields[type_def->field_list.index - 1 + i];
         RuntimeFieldInfo field_info = GC_NEW(RuntimeFieldInfo);
         field_info->DeclaringType = type;
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(field->name, &field_info->Name));
+        CHECK_AND_RETHROW(atom_intern(field->name, &field_info->Name));
         field_info->Attributes = (FieldAttributes){ .Attributes = field->flags };
         field_info->Module = type->Module;
         field_info->MetadataToken = ((token_t){ .table = METADATA_FIELD, .index = i + 1 }).token;
@@ -310,7 +312,6 @@ static tdn_err_t expand_type_from_typedef(RuntimeTypeInfo type, RuntimeTypeInfo
         base->Attributes = original_method->Attributes;
         base->MethodImplFlags = original_method->MethodImplFlags;
         base->VTableOffset = VTABLE_INVALID;
-        CHECK_AND_RETHROW(tdn_create_string_from_cstr(method_def->name, &base->Name));
 
         // if its generic setup the arguments and method definition
         if (original_method->GenericMethodDefinition != NULL) {
@@ -318,11 +319,6 @@ static tdn_err_t expand_type_from_typedef(RuntimeTypeInfo type, RuntimeTypeInfo
             base->GenericArguments = original_method->GenericArguments;
         }
 
-        // if it has a body copy it over
-        if (method_def->rva != 0) {
-            CHECK_AND_RETHROW(tdn_parser_method_body(assembly, method_def, base));
-        }
-
         // and finally get the signature
         method_signature_t signature = {};
         CHECK_AND_RETHROW(sig_parse_method_def(
@@ -332,6 +328,7 @@ static tdn_err_t expand_type_from_typedef(RuntimeTypeInfo type, RuntimeTypeInfo
                 &signature));
         base->Parameters = signature.parameters;
         base->ReturnParameter = signature.return_parameter;
+        tdn_set_parameters_member(base);
     }
 
     // the nested types are just copied over without
@@ -398,43 +395,29 @@ tdn_err_t tdn_type_make_generic(RuntimeTypeInfo base, RuntimeTypeInfo_Array args
     CHECK(tdn_is_generic_type_definition(base));
 
     // check if already has one
-    size_t hash = stbds_hash_bytes(args->Elements, sizeof(RuntimeTypeInfo) * args->Length, 0);
-    int idx = hmgeti(base->GenericTypeInstances, hash);
-    if (idx == -1) {
+    RuntimeTypeInfo instance = generic_table_lookup(base, args);
+    if (instance == NULL) {
         // create it and set it incase we need it again
         // for expansion
         RuntimeTypeInfo new_type = GC_NEW(RuntimeTypeInfo);
-
-        hmput(base->GenericTypeInstances, hash, new_type);
-
-        CHECK_AND_RETHROW(create_generic_type(base, args, new_type));
-
-        // check for generic arguments
-        bool has_generic_params = false;
-        for (int i = 0; i < args->Length; i++) {
-            if (tdn_has_generic_parameters(args->Elements[i])) {
-                has_generic_params = true;
-                break;
-            }
+        CHECK_AND_RETHROW(generic_table_insert(base, args, new_type, (void**)&instance));
+        if (instance != new_type) {
+            // someone else created it first
+            goto done;
         }
 
-        // if it does not then we can properly init the type instead
-        // of keeping it uninitialized
-        if (!has_generic_params) {
-            CHECK_AND_RETHROW(tdn_type_init(new_type));
-        }
+        // only let others see it once it is complete
+        err = create_generic_type(base, args, new_type);
+        generic_table_publish(base, args, new_type, !IS_ERROR(err));
+        CHECK_AND_RETHROW(err);
 
-        // and out it goes
-        *type = new_type;
-    } else {
-        // found it! check we don't have a collision by accident
-        RuntimeTypeInfo instance = base->GenericTypeInstances[idx].value;
-        for (int i = 0; i < args->Length; i++) {
-            CHECK(instance->GenericArguments->Elements[i] == args->Elements[i]);
-        }
-        *type = instance;
+        // the instance is filled on first use, same as any other type
     }
 
+done:
+    // and out it goes
+    *type = instance;
+
 cleanup:
     return err;
 }
@@ -0,0 +1,81 @@
+#include "arena.h"
+
+#include <tomatodotnet/host.h>
+#include <util/string.h>
+
+#include "defs.h"
+
+#define ARENA_ALIGNMENT     16
+#define ARENA_CHUNK_SIZE    (64 * 1024)
+
+struct arena_chunk {
+    // the next chunk in the list
+    arena_chunk_t* next;
+
+    // the amount of bytes used and available in the chunk
+    size_t used;
+    size_t size;
+
+    // the memory of the chunk
+    _Alignas(ARENA_ALIGNMENT) char data[];
+};
+
+static arena_chunk_t* arena_new_chunk(size_t size) {
+    arena_chunk_t* chunk = tdn_host_mallocz(sizeof(arena_chunk_t) + size, ARENA_ALIGNMENT);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->size = size;
+    return chunk;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = ALIGN_UP(size, ARENA_ALIGNMENT);
+
+    arena_chunk_t* chunk = arena->current;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        // big allocations get their own chunk, and we keep
+        // allocating from the current one
+        if (size > ARENA_CHUNK_SIZE / 4) {
+            arena_chunk_t* big = arena_new_chunk(size);
+            if (big == NULL) {
+                return NULL;
+            }
+            big->used = size;
+            big->next = arena->full;
+            arena->full = big;
+            return big->data;
+        }
+
+        // the current chunk is full, move to a new one
+        chunk = arena_new_chunk(ARENA_CHUNK_SIZE);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        if (arena->current != NULL) {
+            arena->current->next = arena->full;
+            arena->full = arena->current;
+        }
+        arena->current = chunk;
+    }
+
+    // the memory of a reused chunk is not clean
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void arena_reset(arena_t* arena) {
+    arena_chunk_t* chunk = arena->full;
+    while (chunk != NULL) {
+        arena_chunk_t* next = chunk->next;
+        tdn_host_free(chunk);
+        chunk = next;
+    }
+    arena->full = NULL;
+
+    if (arena->current != NULL) {
+        arena->current->used = 0;
+    }
+}
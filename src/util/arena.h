@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct arena_chunk arena_chunk_t;
+
+/**
+ * A bump allocator, everything allocated from it is released at once
+ */
+typedef struct arena {
+    // the chunk we are currently allocating from
+    arena_chunk_t* current;
+
+    // the chunks that are already full
+    arena_chunk_t* full;
+} arena_t;
+
+/**
+ * Allocate zeroed memory from the arena, aligned to 16 bytes
+ */
+void* arena_alloc(arena_t* arena, size_t size);
+
+/**
+ * Release everything that was allocated from the arena, the current chunk
+ * is kept around so the next user of the arena won't need to allocate again
+ */
+void arena_reset(arena_t* arena);
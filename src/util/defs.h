@@ -8,6 +8,8 @@
 
 #define PACKED __attribute__((packed))
 
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
 #define STATIC_ASSERT(x) _Static_assert(x, #x)
 
 #define CACHE_PADDED __attribute__((aligned(64)))
@@ -49,6 +51,15 @@ _result; \
 
 #define UNUSED(x) ((void)x)
 
+// hint the cpu that we are in a spin loop
+#if defined(__x86_64__) || defined(__i386__)
+    #define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+    #define CPU_RELAX() __asm__ volatile ("yield")
+#else
+    #define CPU_RELAX() do {} while (0)
+#endif
+
 #define  BIT0   0x00000001ULL
 #define  BIT1   0x00000002ULL
 #define  BIT2   0x00000004ULL
@@ -0,0 +1,103 @@
+#include "parallel.h"
+
+#include <tomatodotnet/host.h>
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "except.h"
+#include "defs.h"
+
+/**
+ * The max amount of worker threads we are going to start per job
+ */
+#define PARALLEL_MAX_THREADS 16
+
+/**
+ * Set while the thread is running a chunk of a parallel job, any parallel_for
+ * started from inside a chunk runs serially instead of starting more threads
+ */
+static _Thread_local bool m_in_parallel_job;
+
+typedef struct parallel_job {
+    parallel_func_t func;
+    void* ctx;
+    size_t count;
+    size_t chunk_size;
+    atomic_size_t next;
+    _Atomic(tdn_err_t) err;
+} parallel_job_t;
+
+static void parallel_worker(void* arg) {
+    parallel_job_t* job = arg;
+    bool was_in_job = m_in_parallel_job;
+    m_in_parallel_job = true;
+
+    for (;;) {
+        // no need to continue if someone already failed
+        if (atomic_load_explicit(&job->err, memory_order_relaxed) != TDN_NO_ERROR) {
+            break;
+        }
+
+        // take the next chunk
+        size_t start = atomic_fetch_add_explicit(&job->next, job->chunk_size, memory_order_relaxed);
+        if (start >= job->count) {
+            break;
+        }
+
+        size_t end = MIN(start + job->chunk_size, job->count);
+        tdn_err_t err = job->func(job->ctx, start, end);
+        if (IS_ERROR(err)) {
+            tdn_err_t expected = TDN_NO_ERROR;
+            atomic_compare_exchange_strong(&job->err, &expected, err);
+        }
+    }
+
+    m_in_parallel_job = was_in_job;
+}
+
+tdn_err_t parallel_for(size_t count, size_t chunk_size, parallel_func_t func, void* ctx) {
+    tdn_thread_t threads[PARALLEL_MAX_THREADS];
+    int thread_count = 0;
+
+    if (count == 0) {
+        return TDN_NO_ERROR;
+    }
+
+    if (chunk_size == 0) {
+        chunk_size = 1;
+    }
+
+    // not enough work to pay for starting a thread, or we are already one of
+    // the workers of an outer job and all the cpus are busy, just run it here
+    size_t chunks = (count + chunk_size - 1) / chunk_size;
+    size_t workers = MIN(MIN((size_t)tdn_host_cpu_count(), chunks), PARALLEL_MAX_THREADS + 1);
+    if (workers < 2 || m_in_parallel_job) {
+        return func(ctx, 0, count);
+    }
+
+    parallel_job_t job = {
+        .func = func,
+        .ctx = ctx,
+        .count = count,
+        .chunk_size = chunk_size,
+    };
+
+    // don't start more threads than there are chunks, the calling
+    // thread counts as one of the workers
+    for (size_t i = 1; i < workers; i++) {
+        tdn_thread_t thread = tdn_host_thread_start(parallel_worker, &job);
+        if (thread == NULL) {
+            break;
+        }
+        threads[thread_count++] = thread;
+    }
+
+    // help with the work and wait for everyone else
+    parallel_worker(&job);
+    for (int i = 0; i < thread_count; i++) {
+        tdn_host_thread_join(threads[i]);
+    }
+
+    return atomic_load(&job.err);
+}
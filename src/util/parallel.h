@@ -0,0 +1,24 @@
+#pragma once
+
+#include <tomatodotnet/except.h>
+
+#include <stddef.h>
+
+/**
+ * Handles all the items in the range [start, end)
+ */
+typedef tdn_err_t (*parallel_func_t)(void* ctx, size_t start, size_t end);
+
+/**
+ * Run the function over count items, the items are handed out in chunks
+ * to worker threads and the calling thread, returns once all the chunks
+ * are done with the first error that was hit
+ *
+ * Threads are started and joined on every call, so the chunk size must be
+ * the smallest amount of work that is worth a thread of its own, when there
+ * are less than two chunks the function runs on the calling thread only
+ *
+ * Calls made from inside a chunk of another parallel_for always run on the
+ * calling thread, only the outermost loop is spread across threads
+ */
+tdn_err_t parallel_for(size_t count, size_t chunk_size, parallel_func_t func, void* ctx);
@@ -2,6 +2,8 @@
 
 #define memcpy __builtin_memcpy
 #define memset __builtin_memset
+#define memmove __builtin_memmove
+#define memcmp __builtin_memcmp
 
 #define strcmp __builtin_strcmp
 #define strlen __builtin_strlen
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks the avx2 span and fill helpers against the scalar versions
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <dotnet/jit/jit_helpers.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static int m_failures = 0;
+
+#define EXPECT(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            m_failures++; \
+        } \
+    } while (0)
+
+#define BUFFER_SIZE 200
+
+static void check_span_helpers(void) {
+    uint8_t bytes[BUFFER_SIZE];
+    uint16_t chars[BUFFER_SIZE];
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        bytes[i] = i % 50 + 1;
+        chars[i] = i % 70 + 300;
+    }
+
+    // every length around the vector widths, with needles that
+    // are found at every position and ones that are never found
+    for (int length = 0; length < BUFFER_SIZE; length++) {
+        for (uint32_t value = 0; value < 60; value++) {
+            EXPECT(jit_index_of_any_byte(bytes, value, value, value, length) ==
+                   jit_index_of_any_byte_avx2(bytes, value, value, value, length),
+                   "index_of_any_byte value=%u length=%d", value, length);
+            EXPECT(jit_index_of_any_byte(bytes, value, value + 3, 7, length) ==
+                   jit_index_of_any_byte_avx2(bytes, value, value + 3, 7, length),
+                   "index_of_any_byte values=%u,%u,7 length=%d", value, value + 3, length);
+            EXPECT(jit_last_index_of_byte(bytes, value, length) ==
+                   jit_last_index_of_byte_avx2(bytes, value, length),
+                   "last_index_of_byte value=%u length=%d", value, length);
+            EXPECT(jit_index_of_any_char(chars, value + 300, value + 300, value + 300, length) ==
+                   jit_index_of_any_char_avx2(chars, value + 300, value + 300, value + 300, length),
+                   "index_of_any_char value=%u length=%d", value + 300, length);
+            EXPECT(jit_last_index_of_char(chars, value + 300, length) ==
+                   jit_last_index_of_char_avx2(chars, value + 300, length),
+                   "last_index_of_char value=%u length=%d", value + 300, length);
+        }
+    }
+
+    // a single difference at every position
+    uint8_t other[BUFFER_SIZE];
+    memcpy(other, bytes, sizeof(other));
+    for (int diff = 0; diff < BUFFER_SIZE; diff++) {
+        other[diff] ^= 1;
+        for (int length = 0; length < BUFFER_SIZE; length++) {
+            EXPECT(jit_sequence_equal(bytes, other, length) == jit_sequence_equal_avx2(bytes, other, length),
+                   "sequence_equal diff=%d length=%d", diff, length);
+        }
+        other[diff] ^= 1;
+    }
+}
+
+static void check_span_helpers_max_length(void) {
+    // the loop bounds must not overflow for lengths near INT32_MAX, the
+    // untouched pages all map the zero page so this costs no memory
+    size_t size = INT32_MAX;
+    uint8_t* bytes = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (bytes == MAP_FAILED) {
+        printf("skipping the max length check, could not map the buffer\n");
+        return;
+    }
+
+    bytes[size - 1] = 1;
+    EXPECT(jit_index_of_any_byte_avx2(bytes, 1, 1, 1, INT32_MAX) == INT32_MAX - 1,
+           "index_of_any_byte at the end of a max length span");
+    EXPECT(jit_index_of_any_byte_avx2(bytes, 2, 2, 2, INT32_MAX) == -1,
+           "index_of_any_byte not found in a max length span");
+    EXPECT(jit_last_index_of_byte_avx2(bytes, 1, INT32_MAX) == INT32_MAX - 1,
+           "last_index_of_byte at the end of a max length span");
+
+    munmap(bytes, size);
+}
+
+static void check_fill_helpers(void) {
+    // the guard elements on both sides must stay zero
+    for (size_t count = 0; count < 70; count++) {
+        uint16_t chars[80] = {};
+        uint32_t ints[80] = {};
+        uint64_t longs[80] = {};
+
+        jit_fill_2_avx2(chars + 1, count, 0xBEEF);
+        jit_fill_4_avx2(ints + 1, count, 0xDEADBEEF);
+        jit_fill_8_avx2(longs + 1, count, 0x1122334455667788ull);
+
+        for (size_t i = 0; i < 80; i++) {
+            bool filled = i >= 1 && i <= count;
+            EXPECT(chars[i] == (filled ? 0xBEEF : 0), "fill_2 count=%zu index=%zu", count, i);
+            EXPECT(ints[i] == (filled ? 0xDEADBEEF : 0), "fill_4 count=%zu index=%zu", count, i);
+            EXPECT(longs[i] == (filled ? 0x1122334455667788ull : 0), "fill_8 count=%zu index=%zu", count, i);
+        }
+    }
+}
+
+int main() {
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("skipping, the cpu has no avx2\n");
+        return 0;
+    }
+
+    check_span_helpers();
+    check_span_helpers_max_length();
+    check_fill_helpers();
+
+    if (m_failures != 0) {
+        printf("%d checks failed\n", m_failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}